@@ -0,0 +1,57 @@
+/ Counts in a loop while the timer and the input interrupt it, halts after
+/ 20 ticks. Runs both ways, see the README:
+/ polled, the interrupt cycle starts PIS at 001, which polls FGI;
+/ vectored with --vectors 2, it starts TZ, IZ or OZ from the table at 002.
+ORG 0
+ZRO, BUN ST
+BUN PIS
+HEX 40
+HEX 50
+HEX 60
+ORG 10
+ST, ION
+LP, ISZ CNT
+BUN LP
+BUN LP
+/ Timer routine.
+ORG 40
+TZ, HEX 0
+STA SAC
+ISZ TCK
+BUN TB
+HLT
+TB, LDA SAC
+ION
+BUN TZ I
+/ Input routine.
+ORG 50
+IZ, HEX 0
+STA SAC
+INP
+ISZ NIN
+LDA SAC
+ION
+BUN IZ I
+/ Output routine, unused with --no-output.
+ORG 60
+OZ, HEX 0
+ION
+BUN OZ I
+/ Polled routine, the input if FGI is set, the timer otherwise.
+PIS, STA SAC
+SKI
+BUN PT
+INP
+ISZ NIN
+BUN PB
+PT, ISZ TCK
+BUN PB
+HLT
+PB, LDA SAC
+ION
+BUN ZRO I
+SAC, HEX 0
+CNT, HEX 0
+NIN, HEX 0
+TCK, DEC -20
+END
@@ -5,12 +5,14 @@
 #include <emscripten.h>
 #include <emscripten/bind.h>
 
-#include <chrono>
-#include <memory>
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <unordered_map>
 
 #include "emulator/assembler.hpp"
 #include "emulator/emulator.hpp"
+#include "emulator/emulator_thread.hpp"
 #include "imgui.h"
 #include "ui/scheme.hpp"
 
@@ -30,26 +32,61 @@ class Application {
     std::string get_code() const;
 
   private:
-    void cycle_emulator();
+    using Command = EmulatorThread::Command;
+
+    // Starts Continue, stopping at the address too.
+    void continue_to(std::optional<std::uint16_t> address);
+    // Condition and hit count editor of the breakpoint at the address.
+    void render_breakpoint_rule(std::uint16_t address);
+    // Replaces the emulator with a newly assembled one.
+    void load_emulator(Emulator&& assembled);
 
     Assembler assembler;
-    std::unique_ptr<mano::Emulator> emulator;
+    // Runs the emulator, the windows show its last snapshot.
+    EmulatorThread emulator;
+    // Snapshot::executed the scheme last animated.
+    std::uint64_t animated_cycles = 0;
 
     mano::ui::Scheme scheme;
     std::string input_code;
     std::string user_input;
 
-    bool emulator_running = false;
+    // Counts the executed instructions per line, see Profiler.
+    bool profiling = false;
+    // Tracks the calls for Step Out, see CallTracker.
+    bool call_tracking = false;
+    // Source and line table the emulator was assembled from.
+    std::string assembled_code;
+    Assembler::LineTable assembled_lines{};
+    std::unordered_map<std::uint16_t, std::string> assembled_labels;
+    // Breakpoint condition being edited.
+    std::string condition_input;
+    std::string condition_error;
+    int condition_stop_hits = 1;
     double clock_rate = 0.0;
-    double clock_period = 0.0; 
+    // Run without the clock rate, see EmulatorThread::Command::SetMaxSpeed.
+    bool max_speed = false;
+    int frame_budget_ms = static_cast<int>(
+        EmulatorThread::DEFAULT_FRAME_BUDGET.count()
+    );
 
-    std::chrono::steady_clock::time_point last_frame_tp;
-    double elapsed_time = 0;
-    
+    // Unread input, refreshed from the snapshots unless it's being edited.
     std::string input_stream_string;
+    bool input_stream_editing = false;
+    // Snapshot input the string was last refreshed from.
+    std::uint64_t shown_input_version = 0;
+    std::uint64_t shown_input_consumed = 0;
     std::string output_stream_string;
     bool input_stream_open = false;
     bool output_stream_open = false;
+    // T-states per character, see Devices.
+    int input_latency = 0;
+    int output_latency = 0;
+    // T-states between the timer interrupts, 0 stops the timer.
+    int timer_period = 0;
+    // Vectored interrupts, see InterruptController.
+    bool vectored = false;
+    int vector_base = InterruptController::DEFAULT_VECTOR_BASE;
 
     SDL_Window* window = nullptr;
     SDL_GLContext gl_context = nullptr;
@@ -1,6 +1,7 @@
 #ifndef MANO_ASSEMBLER_HPP
 #define MANO_ASSEMBLER_HPP
 
+#include <array>
 #include <cctype>
 #include <cstdint>
 #include <charconv>
@@ -26,6 +27,32 @@ class Assembler {
         return errors;
     }
 
+    // Source line of every memory word, 0 for the words no line assembled.
+    using LineTable = std::array<std::uint32_t, MEMORY_SIZE>;
+
+    /*
+     * Line table of the last assemble call, lines start from 1.
+     * */
+    const LineTable& get_line_table() const {
+        return line_table;
+    }
+
+    /*
+     * Address of every label of the last assemble call, to its name.
+     * */
+    std::unordered_map<std::uint16_t, std::string> get_labels() const;
+
+    /*
+     * Lines of the code without their line breaks, line n of the line table
+     * is at index n - 1.
+     * */
+    static std::vector<std::string_view> split_lines(std::string_view code);
+
+    /*
+     * The text without its leading and trailing spaces and tabs.
+     * */
+    static std::string_view trim(std::string_view text);
+
     struct Error {
         std::string message;
         std::size_t line;
@@ -83,6 +110,7 @@ class Assembler {
 
   private:
     Memory memory;
+    LineTable line_table{};
 
     std::string_view code;
     std::size_t index;
@@ -0,0 +1,120 @@
+#ifndef MANO_BLOCK_CACHE_HPP
+#define MANO_BLOCK_CACHE_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "emulator/instructions.hpp"
+#include "emulator/memory.hpp"
+#include "emulator/native_code.hpp"
+
+namespace mano {
+
+class Bus;
+class Cpu;
+
+/*
+ * Caches straight-line runs of instructions, decoded once and keyed by their
+ * start address. Blocks end after any instruction that may branch, skip,
+ * halt or touch the interrupt and I/O flags, and before every execution
+ * breakpoint of the bus (see Emulator::set_breakpoint).
+ *
+ * With translation on, the leading instructions of a block up to the first
+ * I/O instruction are translated to machine code once the block ran
+ * HOT_RUNS times, see NativeCode. Translated blocks continue straight into
+ * each other, except into one at an execution breakpoint, until they reach
+ * an address without translated code. I/O instructions, the interrupt
+ * cycle and undefined opcodes always go through the Cpu. So do whole blocks
+ * while a read watchpoint is set, the code reads memory without checking
+ * them, or a watchpoint has a condition, which reads the registers the code
+ * keeps to itself. A write into cached code drops the blocks it covers and
+ * stops the running one after the writing instruction, so self-modifying
+ * code only runs translated once it stops changing. Without a code
+ * generator for the host the blocks all go through the Cpu.
+ * */
+class BlockCache {
+  public:
+    static constexpr std::size_t MAX_BLOCK_LENGTH = 32;
+    // Runs of a block before it's translated.
+    static constexpr std::size_t HOT_RUNS = 8;
+
+    explicit BlockCache(bool translate_blocks = false) :
+        translate(translate_blocks && NativeCode::is_supported()),
+        native_code(&BlockCache::write_native) {}
+
+    struct Operation {
+        std::uint16_t ir;
+        Instr instr;
+    };
+
+    struct Block {
+        std::vector<Operation> operations;
+        // Number of leading operations the native code can run.
+        std::size_t native_length = 0;
+        // T-states of those operations.
+        std::size_t native_cycles = 0;
+        // Runs before it's translated, see HOT_RUNS.
+        std::size_t runs = 0;
+        NativeCode::Block native = nullptr;
+    };
+
+    /*
+     * Runs whole instructions from the cached blocks until the CPU halts,
+     * stops at a breakpoint, needs a stamp (see InterruptController::note)
+     * or at least cycle_budget T-states are executed. Falls back to
+     * Cpu::step_instruction for the interrupt cycle and undefined opcodes.
+     * Returns the number of T-states that were executed.
+     * */
+    std::size_t run(Cpu& cpu, Bus& bus, std::size_t cycle_budget);
+
+    /*
+     * Drops every block that covers the address.
+     * Bus calls this on every memory write while the cache is attached.
+     * */
+    void invalidate(std::uint16_t address) {
+        if (coverage[address] != 0) {
+            drop_blocks(address);
+        }
+    }
+
+    void clear();
+
+    bool is_translating() const {
+        return translate;
+    }
+
+  private:
+    Block& get_block(std::uint16_t address, Bus& bus);
+
+    void translate_block(Block& block, std::uint16_t address, Bus& bus);
+    std::size_t run_native(
+        Cpu& cpu,
+        Bus& bus,
+        NativeCode::Block native,
+        std::size_t cycles,
+        std::size_t cycle_budget
+    );
+    // NativeCode::WriteHandler, the state's context is a NativeContext.
+    static bool write_native(
+        NativeCode::State* state,
+        std::uint32_t address,
+        std::uint32_t value
+    );
+
+    void drop_blocks(std::uint16_t address);
+    void drop(std::uint16_t start);
+
+    // Decoded blocks by their start address, empty if not cached.
+    std::array<Block, MEMORY_SIZE> blocks;
+    // Number of cached blocks covering each address.
+    std::array<std::uint8_t, MEMORY_SIZE> coverage {};
+
+    std::size_t invalidation_count = 0;
+    bool translate;
+    NativeCode native_code;
+};
+
+} // namespace mano
+
+#endif
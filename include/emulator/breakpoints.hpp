@@ -0,0 +1,196 @@
+#ifndef MANO_BREAKPOINTS_HPP
+#define MANO_BREAKPOINTS_HPP
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+#include "emulator/condition.hpp"
+#include "emulator/cpu.hpp"
+#include "emulator/memory.hpp"
+
+namespace mano {
+
+class Bus;
+
+/*
+ * Breakpoints and watchpoints of an Emulator, see Emulator::set_breakpoint.
+ *
+ * Every kind is a bitmap of the 4096 words, so the bus and the engines pay
+ * a single bit test per access and the execution breakpoints a single one
+ * per instruction (per block for the block engines, which end their blocks
+ * before every breakpoint).
+ *
+ * Execution breakpoints stop at the instruction boundary before the
+ * instruction runs, watchpoints after the instruction that read or wrote
+ * the word. Instruction fetches don't count as reads, indirect pointers do.
+ * Register watchpoints stop once the register holds a different value at
+ * an instruction boundary.
+ *
+ * A breakpoint or memory watchpoint can have a rule, a compiled Condition
+ * and a hit count to stop at. Rules are only looked up once the bitmap
+ * fires, the accesses without a breakpoint never see them. The conditions
+ * of the read watchpoints see the state before the read returns its value,
+ * the ones of the write watchpoints the state right after the write.
+ *
+ * The temporary breakpoint, used to run to an address or the first of two,
+ * shares the execution bitmap and goes away at the first stop of the
+ * emulator, whatever stopped it.
+ * */
+class Breakpoints {
+  public:
+    enum class Kind {
+        Execute,
+        Read,
+        Write,
+        Register,
+    };
+
+    struct Hit {
+        Kind kind;
+        // Address of the word, or the Registers::Id of the register.
+        std::uint16_t address;
+    };
+
+    struct Rule {
+        // Stops only when it holds.
+        std::optional<Condition> condition;
+        // Stops from this hit on, the ones before only count.
+        std::uint64_t stop_hits = 1;
+        // Times the breakpoint fired with its condition holding.
+        std::uint64_t hits = 0;
+    };
+
+    bool has_execute(std::uint16_t address) const {
+        return execute[address];
+    }
+    bool has_read(std::uint16_t address) const {
+        return read[address];
+    }
+    bool has_write(std::uint16_t address) const {
+        return write[address];
+    }
+    bool has_register(Registers::Id reg) const {
+        return (watched_registers >> reg) & 1u;
+    }
+    bool has_registers() const {
+        return watched_registers != 0;
+    }
+    bool has_read_watchpoints() const {
+        return read.any();
+    }
+    /*
+     * Whether a read or write watchpoint has a condition, which must see
+     * the registers of the instruction making the access.
+     * */
+    bool has_watch_conditions() const {
+        return watch_conditions != 0;
+    }
+
+    /*
+     * Use Emulator::set_breakpoint, it drops the cached blocks.
+     * */
+    void set(Kind kind, std::uint16_t address, bool enabled);
+
+    /*
+     * Use Emulator::set_temporary_breakpoint, it drops the cached blocks.
+     * */
+    void set_temporary(
+        std::optional<std::uint16_t> address,
+        std::optional<std::uint16_t> second = {}
+    );
+
+    bool is_temporary(std::uint16_t address) const {
+        return temporary[0] == address || temporary[1] == address;
+    }
+
+    /*
+     * Whether the user set a breakpoint at the address, unlike has_execute
+     * doesn't see the temporary one.
+     * */
+    bool has_breakpoint(std::uint16_t address) const {
+        return breakpoints[address];
+    }
+
+    /*
+     * Replaces the rule of the breakpoint or memory watchpoint,
+     * set drops it along with the breakpoint.
+     * */
+    void set_rule(Kind kind, std::uint16_t address, Rule rule);
+
+    /*
+     * Rule of the breakpoint, nullptr if it has no rule and never fired.
+     * */
+    const Rule* get_rule(Kind kind, std::uint16_t address) const;
+
+    /*
+     * Called once the bitmap of the kind fired for the address, counts the
+     * hit and returns whether its rule stops the emulator, setting hit.
+     * */
+    bool check(Kind kind, std::uint16_t address, const Cpu& cpu, const Bus& bus);
+
+    /*
+     * Sets hit and drops the temporary breakpoint.
+     * */
+    void stop(Hit stop_hit);
+
+    /*
+     * Remembers the values of the watched registers to compare against.
+     * */
+    void snapshot_registers(const Registers& registers);
+
+    /*
+     * Returns the first watched register that changed since the last
+     * snapshot, and takes a new one.
+     * */
+    std::optional<Registers::Id> find_register_change(
+        const Registers& registers
+    );
+
+    void clear();
+
+    bool empty() const {
+        return execute.none() && read.none() && write.none()
+               && watched_registers == 0;
+    }
+
+    /*
+     * Changes whenever the breakpoints, the rules, their hit counts or hit
+     * may have, so a copy is only taken when it's out of date.
+     * */
+    std::uint64_t get_version() const {
+        return version;
+    }
+
+    // What stopped the emulator last, see Cpu::break_pending.
+    std::optional<Hit> hit;
+
+  private:
+    // The breakpoints and the temporary one.
+    std::bitset<MEMORY_SIZE> execute;
+    std::bitset<MEMORY_SIZE> breakpoints;
+    std::array<std::optional<std::uint16_t>, 2> temporary{};
+    std::bitset<MEMORY_SIZE> read;
+    std::bitset<MEMORY_SIZE> write;
+    // Bit per Registers::Id.
+    std::uint8_t watched_registers = 0;
+    std::array<std::uint16_t, Registers::REGISTER_COUNT> register_values{};
+
+    static std::uint32_t get_key(Kind kind, std::uint16_t address) {
+        return (static_cast<std::uint32_t>(kind) << 16) | (address & 0xFFF);
+    }
+
+    // Rules and hit counts by get_key.
+    std::unordered_map<std::uint32_t, Rule> rules;
+    // Rules of the read and write watchpoints with a condition.
+    std::size_t watch_conditions = 0;
+    std::uint64_t version = 0;
+
+    void count_watch_conditions();
+};
+
+} // namespace mano
+
+#endif
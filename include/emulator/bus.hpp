@@ -4,16 +4,19 @@
 #include <array>
 #include <cstdint>
 
+#include "emulator/block_cache.hpp"
+#include "emulator/breakpoints.hpp"
+#include "emulator/journal.hpp"
+#include "emulator/memory.hpp"
+#include "emulator/trace.hpp"
+
 namespace mano {
 
 class Cpu;
 
-static constexpr std::size_t MEMORY_SIZE = 4096;
-using Memory = std::array<std::uint16_t, MEMORY_SIZE>;
-
 class Bus {
 public:
-    Bus(Cpu& cpu_ref, Memory& memory_ref) : cpu(cpu_ref), memory(memory_ref) {}
+    Bus(Cpu& cpu_ref, PagedMemory& memory_ref) : cpu(cpu_ref), memory(memory_ref) {}
        
     enum class Selection : std::size_t {
         AR = 0,
@@ -31,11 +34,57 @@ public:
      * Reads the AR register and stores the M[AR]
      * */
     void read_memory();
+    /*
+     * Same as read_memory for the instruction fetch,
+     * which the read watchpoints don't see.
+     * */
+    void fetch_memory();
     /*
      * Reads the AR register and writes value to the M[AR].
      * */
     void write_memory();
+
+    /*
+     * Reads M[address] without going through the memory unit or recording
+     * the transfer. Used by the instruction level engine.
+     * */
+    std::uint16_t read(std::uint16_t address) {
+        if (breakpoints && breakpoints->has_read(address)) {
+            watch_hit(Breakpoints::Kind::Read, address);
+        }
+        return memory[address];
+    }
+    /*
+     * Same as read for the instruction fetch and the engines that decode
+     * ahead, which the read watchpoints don't see.
+     * */
+    std::uint16_t fetch(std::uint16_t address) const {
+        return memory[address];
+    }
+    /*
+     * Writes value to the M[address] without going through the memory unit
+     * or recording the transfer. Used by the instruction level engine.
+     * */
+    void write(std::uint16_t address, std::uint16_t value) {
+        if (journal) {
+            journal->record_write(address, memory[address]);
+        }
+        memory.write(address, value);
+        if (trace) {
+            trace->record_write(address, value);
+        }
+        if (block_cache) {
+            block_cache->invalidate(address);
+        }
+        if (breakpoints && breakpoints->has_write(address)) {
+            watch_hit(Breakpoints::Kind::Write, address);
+        }
+    }
    
+    const PagedMemory& get_memory() const {
+        return memory;
+    }
+
     /*
      * Loads the value in the source to the dest.
      * */
@@ -45,9 +94,19 @@ public:
     Selection last_source = Selection::None;
     std::uint16_t transfer_value = 0;
 
+    // Notified on every memory write while attached.
+    BlockCache* block_cache = nullptr;
+    Journal* journal = nullptr;
+    TraceRecorder* trace = nullptr;
+    // Checked on every memory access while attached.
+    Breakpoints* breakpoints = nullptr;
+
 private:
+    // Stops the emulator after the current instruction.
+    void watch_hit(Breakpoints::Kind kind, std::uint16_t address);
+
     Cpu& cpu;
-    Memory& memory;
+    PagedMemory& memory;
     std::uint16_t memory_io = 0;
 };
 }
@@ -0,0 +1,135 @@
+#ifndef MANO_CALL_TRACKER_HPP
+#define MANO_CALL_TRACKER_HPP
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "emulator/memory.hpp"
+
+namespace mano {
+
+class Cpu;
+
+/*
+ * Rebuilds the calls of the program while attached to an Emulator,
+ * see Emulator::set_call_tracking.
+ *
+ * BSA SUB calls the subroutine whose return word is SUB, and the interrupt
+ * cycle calls the one whose return word is 0. BUN SUB I returns from the
+ * innermost call through the same return word and unwinds any frame above
+ * it; other indirect branches, like jump tables, don't touch the stack.
+ *
+ * Every instruction's T-states go to the subroutine on top of the shadow
+ * stack (exclusive) and to every subroutine in it (inclusive, counted once
+ * for recursive calls). The call that runs first, before any BSA, is the
+ * root.
+ * */
+class CallTracker {
+  public:
+    // Calls deeper than this are not tracked, a BSA used as a plain jump
+    //     never returns.
+    static constexpr std::size_t MAX_DEPTH = 256;
+
+    struct Frame {
+        // Return word of the subroutine, 0 for interrupts.
+        std::uint16_t subroutine;
+        std::uint16_t return_address;
+        bool interrupt;
+        // Observed T-states when the call was made.
+        std::uint64_t entry_cycle;
+        // Call path of the frame, see get_folded_stacks.
+        std::uint32_t path;
+
+        bool operator==(const Frame&) const = default;
+    };
+
+    struct Totals {
+        std::uint64_t calls = 0;
+        std::uint64_t inclusive_cycles = 0;
+        std::uint64_t exclusive_cycles = 0;
+
+        bool operator==(const Totals&) const = default;
+    };
+
+    CallTracker();
+
+    /*
+     * Called by Emulator around every dispatch while attached.
+     * */
+    void begin(const Cpu& cpu);
+    void end(const Cpu& cpu, std::size_t cycles);
+
+    /*
+     * Drops the instruction being tracked, the CPU state it started from
+     * was undone.
+     * */
+    void cancel() {
+        in_instruction = false;
+    }
+
+    void clear();
+
+    const std::vector<Frame>& get_stack() const {
+        return stack;
+    }
+
+    /*
+     * Totals per return word, the interrupt handler is the one of 0.
+     * Inclusive cycles of the calls still on the stack are not added yet.
+     * */
+    const std::array<Totals, MEMORY_SIZE>& get_subroutines() const {
+        return subroutines;
+    }
+
+    const Totals& get_root() const {
+        return root;
+    }
+
+    /*
+     * Exclusive T-states of every call path in the folded stack format read
+     * by flame graph tools, a "main;SUB;SB2 1234" line per path. Subroutines
+     * are named by the label of their return word, or its address.
+     * */
+    std::string get_folded_stacks(
+        const std::unordered_map<std::uint16_t, std::string>& labels
+    ) const;
+
+  private:
+    struct Path {
+        std::uint32_t parent;
+        std::uint16_t subroutine;
+        bool interrupt;
+        std::uint64_t cycles;
+    };
+
+    void call(
+        std::uint16_t subroutine,
+        std::uint16_t return_address,
+        bool is_interrupt
+    );
+    void ret(std::size_t frame);
+    Totals& get_totals(const Frame& frame);
+
+    std::vector<Frame> stack;
+    std::array<Totals, MEMORY_SIZE> subroutines{};
+    Totals root;
+    // Frames of every subroutine on the stack, for recursive calls.
+    std::array<std::uint32_t, MEMORY_SIZE> active{};
+
+    // Tree of the call paths, the root path first.
+    std::vector<Path> paths;
+    std::unordered_map<std::uint64_t, std::uint32_t> children;
+
+    std::uint64_t cycles = 0;
+    bool in_instruction = false;
+    bool interrupt = false;
+    std::uint16_t pc = 0;
+    std::uint64_t instruction_cycles = 0;
+};
+
+} // namespace mano
+
+#endif
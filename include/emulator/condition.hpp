@@ -0,0 +1,158 @@
+#ifndef MANO_CONDITION_HPP
+#define MANO_CONDITION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mano {
+
+class Bus;
+class Cpu;
+
+/*
+ * Breakpoint condition compiled to the bytecode of a small stack machine,
+ * see ConditionCompiler. Evaluating it reads the registers and memory
+ * without going through the watchpoints and never allocates.
+ * */
+class Condition {
+  public:
+    static constexpr std::size_t MAX_STACK = 16;
+
+    enum class Op : std::uint16_t {
+        // Followed by the value.
+        Push,
+        // Followed by the Registers::Id.
+        Register,
+        // Followed by the Flag.
+        Flag,
+        // Replaces the address on top with M[address].
+        Load,
+        Not,
+        Negate,
+        Invert,
+        Add,
+        Subtract,
+        And,
+        Or,
+        Xor,
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        // Replaces the top with 1 when it isn't 0.
+        Bool,
+        // Followed by the target, pop the top and jump if it's 0 or not 0.
+        JumpIfFalse,
+        JumpIfTrue,
+        // Followed by the target.
+        Jump,
+    };
+
+    enum class Flag : std::uint16_t {
+        E,
+        S,
+        I,
+        FGI,
+        FGO,
+        FGT,
+        IEN,
+        R,
+        SC,
+    };
+
+    bool evaluate(const Cpu& cpu, const Bus& bus) const;
+
+    const std::vector<std::uint16_t>& get_code() const {
+        return code;
+    }
+
+    const std::string& get_source() const {
+        return source;
+    }
+
+  private:
+    friend class ConditionCompiler;
+
+    std::vector<std::uint16_t> code;
+    std::string source;
+};
+
+/*
+ * Compiles conditions like "AC == 0x10 && M[SUM] > 5".
+ *
+ * Operands are 16-bit words: numbers (decimal or 0x hex), the registers
+ * (AR, PC, DR, AC, IR, TR, OUTR, INPR), the flags (E, S, I, FGI, FGO, FGT,
+ * IEN, R and SC for the sequence counter) in any case, labels as written for
+ * their address and M[...] for a memory word. Arithmetic wraps around,
+ * < <= > >= compare as two's complement like the data of the programs,
+ * so "AC < 0" works.
+ *
+ * From the loosest to the tightest binding: ||, &&, the comparisons,
+ * |, ^, &, + and -, then the unary !, - and ~. Unlike C the bitwise
+ * operators bind tighter than the comparisons.
+ * */
+class ConditionCompiler {
+  public:
+    std::optional<Condition> compile(
+        std::string_view text,
+        const std::unordered_map<std::uint16_t, std::string>& labels
+    );
+
+    /*
+     * Why the last compile call failed.
+     * */
+    const std::string& get_error() const {
+        return error;
+    }
+
+  private:
+    using Op = Condition::Op;
+
+    // Parentheses, M[...] and unary operators inside each other, the parser
+    //     recurses for each.
+    static constexpr std::size_t MAX_NESTING = 64;
+
+    bool parse_or();
+    bool parse_and();
+    bool parse_comparison();
+    bool parse_bit_or();
+    bool parse_bit_xor();
+    bool parse_bit_and();
+    bool parse_additive();
+    bool parse_unary();
+    bool parse_primary();
+    bool parse_name(std::string_view name);
+
+    void skip_spaces();
+    // Consumes the operator if the text continues with it.
+    bool accept(std::string_view op);
+
+    void emit(Op op, int stack_change);
+    void emit(Op op, std::uint16_t operand, int stack_change);
+    // Emits a jump and returns where its target goes.
+    std::size_t emit_jump(Op op, int stack_change);
+    void patch_jump(std::size_t target);
+
+    bool fail(std::string message);
+
+    const std::unordered_map<std::uint16_t, std::string>* labels = nullptr;
+    std::string_view text;
+    std::size_t index = 0;
+
+    std::vector<std::uint16_t> code;
+    std::size_t depth = 0;
+    std::size_t nesting = 0;
+    bool too_deep = false;
+    std::string error;
+};
+
+} // namespace mano
+
+#endif
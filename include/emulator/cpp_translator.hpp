@@ -0,0 +1,50 @@
+#ifndef MANO_CPP_TRANSLATOR_HPP
+#define MANO_CPP_TRANSLATOR_HPP
+
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <string>
+#include <utility>
+
+#include "emulator/instructions.hpp"
+#include "emulator/memory.hpp"
+
+namespace mano {
+
+/*
+ * Translates an assembled memory image into a standalone C++ program.
+ * Every word that decodes to an instruction gets its own label and jumps
+ * between them use computed gotos, so the host compiler sees the program
+ * as ordinary code. Each label first checks that the word in memory is
+ * still the one it was translated from, words changed by self-modifying
+ * stores are run by an embedded interpreter instead.
+ *
+ * The program reads the input device from stdin, writes the output device
+ * to stdout and prints the final state to stderr when the CPU halts.
+ * Computed gotos need GCC or Clang.
+ * */
+class CppTranslator {
+  public:
+    std::string translate(const Memory& memory);
+
+  private:
+    template<typename... Args>
+    void emit(std::format_string<Args...> str, Args&&... args) {
+        std::format_to(
+            std::back_inserter(output),
+            str,
+            std::forward<Args>(args)...
+        );
+    }
+
+    void emit_instruction(std::uint16_t address, std::uint16_t ir, Instr instr);
+    void emit_jump(std::uint16_t target);
+
+    const Memory* image = nullptr;
+    std::string output;
+};
+
+} // namespace mano
+
+#endif
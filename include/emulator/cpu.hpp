@@ -4,6 +4,7 @@
 #include <cstdint>
 
 #include "emulator/instructions.hpp"
+#include "emulator/interrupt_controller.hpp"
 
 namespace mano {
 
@@ -128,9 +129,33 @@ private:
 
 class Cpu {
   public:
+    // Longest instruction, ISZ, takes 7 T-states.
+    static constexpr std::size_t MAX_INSTRUCTION_CYCLES = 7;
+    // RT0 to RT2.
+    static constexpr std::size_t INTERRUPT_CYCLES = 3;
+
     void cycle_once(Bus& bus);
     void cycle(Bus& bus, std::size_t cycle_count);
 
+    /*
+     * Executes the rest of the current instruction in a single dispatch,
+     * including the indirect fetch, or the whole interrupt cycle when R is set.
+     * Leaves the CPU in the same state as the equivalent cycle_once calls,
+     * but skips the per T-state bookkeeping done for the UI
+     * (cycle name, ALU operation and the bus transfer trace).
+     * Returns the number of T-states that were executed.
+     * */
+    std::size_t step_instruction(Bus& bus);
+
+    /*
+     * Executes ir as the instruction fetched from M[PC], decode must be
+     * Instruction::decode(ir). Lets the engines that cache the decoded
+     * instructions skip the fetch, only valid at the start of an instruction
+     * while the CPU is running and R is not set.
+     * Returns the number of T-states that were executed.
+     * */
+    std::size_t execute(Bus& bus, std::uint16_t ir, Instr decode);
+
 
     std::size_t get_sequence_counter() const {
         return sequence_counter;
@@ -140,6 +165,33 @@ class Cpu {
         return cycle_name;
     }
 
+    /*
+     * The pending register of the interrupt controller, a bit per
+     * InterruptController::Source with its flag set.
+     * */
+    std::uint8_t get_pending_interrupts() const {
+        return static_cast<std::uint8_t>(
+            fgt | (fgi << InterruptController::Input)
+            | (fgo << InterruptController::Output)
+        );
+    }
+
+    /*
+     * Whether R is set at the end of the instruction, interrupts are
+     * enabled and the flag of an unmasked source is set.
+     * */
+    bool has_interrupt_request() const {
+        return ien && (get_pending_interrupts() & interrupts.mask) != 0;
+    }
+
+    /*
+     * Moves the sequencer back to an earlier T-state, see Journal.
+     * */
+    void restore_sequence(std::size_t counter, std::string_view name) {
+        sequence_counter = counter;
+        cycle_name = name;
+    }
+
     Registers registers;
     Alu alu;
 
@@ -150,13 +202,34 @@ class Cpu {
     bool indirect = false;
     bool fgi = false;
     bool fgo = false;
+    // Timer flag, set when the timer of Devices expires and cleared by the
+    //     interrupt cycle.
+    bool fgt = false;
     bool ien = false;
     // Interrupt flag
     bool r = false;
-
-    Instruction instruction;
+    // Set by INP and OUT, Emulator::run returns early so the caller can
+    //     service the devices. The interrupt cycles and the IONs that enable
+    //     the interrupts only leave a stamp, see InterruptController::note.
+    bool io_pending = false;
+    // Set when the last Emulator call stopped at a breakpoint or
+    //     a watchpoint, see Breakpoints.
+    bool break_pending = false;
+    // SKI and SKO that found their flag clear, the polls of a busy-wait.
+    //     Only count up, reverse_step leaves them.
+    std::uint64_t input_polls = 0;
+    std::uint64_t output_polls = 0;
+
+    // Last decoded instruction, see Instruction::from_instr for its details.
+    Instr instruction = Instr::Undefined;
+    InterruptController interrupts;
 
   private:
+    void enable_interrupts();
+    // Start and end of the interrupt cycle, dispatch returns the address
+    //     PC is saved at.
+    std::uint16_t dispatch(Bus& bus);
+    void acknowledge();
 
     std::size_t sequence_counter = 0;
 
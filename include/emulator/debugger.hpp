@@ -0,0 +1,32 @@
+#ifndef MANO_DEBUGGER_HPP
+#define MANO_DEBUGGER_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "emulator/emulator.hpp"
+
+namespace mano {
+
+/*
+ * Where stepping over the next instruction stops when it's a BSA, the two
+ * words after it: the return address, and the word a subroutine returning
+ * with a skip (ISZ of its entry word) lands on. See
+ * Emulator::set_temporary_breakpoint. nullopt for the other instructions,
+ * which are stepped over by running them.
+ * */
+std::optional<std::array<std::uint16_t, 2>>
+find_step_over_target(const Emulator& emulator);
+
+/*
+ * Where stepping out of the innermost call stops, its return address on
+ * the shadow stack of the call tracker (see Emulator::set_call_tracking).
+ * nullopt without call tracking, the memory alone can't tell which
+ * subroutine PC is in, and when no call made while tracking is running.
+ * */
+std::optional<std::uint16_t> find_step_out_target(const Emulator& emulator);
+
+} // namespace mano
+
+#endif
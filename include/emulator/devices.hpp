@@ -0,0 +1,201 @@
+#ifndef MANO_DEVICES_HPP
+#define MANO_DEVICES_HPP
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <vector>
+
+#include "emulator/interrupt_controller.hpp"
+#include "emulator/ring_buffer.hpp"
+
+namespace mano {
+
+class Cpu;
+
+/*
+ * Input and output ports of one machine, run from a queue of timestamped
+ * events instead of being polled between the instructions.
+ *
+ * The ports have their own clock, advance moves it by the T-states the CPU
+ * ran. A port whose flag INP, OUT or anything else cleared starts a
+ * transfer, which ends with an event the latency of the port later: the
+ * input port loads the next character into INPR and sets FGI, the output
+ * port takes OUTR and sets FGO. Nothing is done between the events, so the
+ * CPU can run up to get_cycles_to_event at once.
+ *
+ * The interval timer sets FGT every timer period, which raises R through
+ * the interrupt cycle like the other flags. For every source of the
+ * InterruptController the devices time how long its flag waits for the
+ * interrupt cycle that serves it, and how long the service routine runs
+ * from RT0 until its ION.
+ * */
+class Devices {
+  public:
+    static constexpr std::uint64_t NO_EVENT =
+        std::numeric_limits<std::uint64_t>::max();
+
+    struct Event {
+        enum class Kind {
+            // The input port loads INPR.
+            Input,
+            // The output port took OUTR.
+            Output,
+            // The timer expires.
+            Timer,
+        };
+
+        std::uint64_t cycle;
+        Kind kind;
+    };
+
+    struct InterruptStats {
+        // Interrupt cycles that served the source, and the T-states from
+        //     its flag being set to their RT0.
+        std::uint64_t interrupts = 0;
+        std::uint64_t latency_cycles = 0;
+        std::uint64_t max_latency = 0;
+        // Service routines that reached their ION, and the T-states from
+        //     RT0 to the end of the ION.
+        std::uint64_t services = 0;
+        std::uint64_t service_cycles = 0;
+    };
+
+    struct Stats {
+        std::uint64_t input_characters = 0;
+        std::uint64_t output_characters = 0;
+        // T-states the port had a transfer in flight.
+        std::uint64_t input_busy_cycles = 0;
+        std::uint64_t output_busy_cycles = 0;
+        // Timer expiries, and the ones FGT was still set for.
+        std::uint64_t timer_ticks = 0;
+        std::uint64_t missed_ticks = 0;
+        // Indexed by InterruptController::Source.
+        std::array<InterruptStats, InterruptController::SOURCE_COUNT>
+            interrupts{};
+    };
+
+    /*
+     * T-states the CPU spent polling the port, counting every SKI (or SKO)
+     * that found its flag clear, see Cpu::input_polls, as an iteration of
+     * the SKI, BUN loop.
+     * */
+    static std::uint64_t get_input_wait_cycles(const Cpu& cpu);
+    static std::uint64_t get_output_wait_cycles(const Cpu& cpu);
+
+    /*
+     * Characters per 1000 T-states.
+     * */
+    static double get_rate(std::uint64_t characters, std::uint64_t cycles) {
+        if (cycles == 0) {
+            return 0.0;
+        }
+        return static_cast<double>(characters) * 1000.0
+               / static_cast<double>(cycles);
+    }
+
+    // Characters waiting for the input port, and every nonzero character
+    //     the output port took.
+    RingBuffer<char> input;
+    RingBuffer<char> output;
+    // The output port holds its transfer while output is this long.
+    std::size_t output_capacity = std::numeric_limits<std::size_t>::max();
+    // A closed port doesn't touch its flag.
+    bool input_open = true;
+    bool output_open = true;
+    // T-states from the start of a transfer to its event, 0 completes it
+    //     before the next instruction.
+    std::uint64_t input_latency = 0;
+    std::uint64_t output_latency = 0;
+
+    std::uint64_t get_cycles() const {
+        return cycles;
+    }
+
+    const Stats& get_stats() const {
+        return stats;
+    }
+
+    std::uint64_t get_timer_period() const {
+        return timer_period;
+    }
+
+    /*
+     * Restarts the timer to expire every period T-states, 0 stops it, and
+     * forgets the interrupts being timed.
+     * */
+    void set_timer_period(std::uint64_t period);
+
+    /*
+     * T-states until the next event, NO_EVENT when none is scheduled.
+     * */
+    std::uint64_t get_cycles_to_event() const {
+        if (events.empty()) {
+            return NO_EVENT;
+        }
+        return events.top().cycle - cycles;
+    }
+
+    /*
+     * Moves the clock by the T-states the CPU ran since the last call and
+     * runs the events that are due. Starts the transfer asked for by an
+     * INP or OUT, see Cpu::io_pending, which it clears, and times the
+     * interrupts from the stamps the call left, see
+     * InterruptController::note.
+     * */
+    void advance(Cpu& cpu, std::uint64_t elapsed);
+
+    /*
+     * Starts the transfers of the ports whose flag is clear, for after
+     * the flags, the open ports, input or output changed outside of advance.
+     * A flag set outside of the devices is timed from here.
+     * */
+    void update(Cpu& cpu);
+
+  private:
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            return a.cycle > b.cycle;
+        }
+    };
+
+    void schedule(const Cpu& cpu);
+    void run_events(Cpu& cpu);
+    void complete_input(Cpu& cpu);
+    void complete_output(Cpu& cpu);
+    void end_output();
+    void expire_timer(Cpu& cpu, std::uint64_t cycle);
+    // Forgets the flags the CPU cleared, times the ones set outside of
+    //     the devices from now on.
+    void note_flags(const Cpu& cpu);
+    // Counts the interrupt cycle of the stamp, or the end of the routine
+    //     for an ION, which ended on the cycle.
+    void time_interrupt(
+        const InterruptController::Stamp& stamp,
+        std::uint64_t end
+    );
+
+    std::priority_queue<Event, std::vector<Event>, Later> events;
+    std::uint64_t cycles = 0;
+    Stats stats;
+    // The port has a transfer in flight since the cycle.
+    bool input_busy = false;
+    bool output_busy = false;
+    std::uint64_t input_start = 0;
+    std::uint64_t output_start = 0;
+    // The output transfer ended while output was full.
+    bool output_blocked = false;
+    std::uint64_t timer_period = 0;
+    // Cycle the flag of each source was set at, while it's set.
+    std::array<std::optional<std::uint64_t>, InterruptController::SOURCE_COUNT>
+        raised{};
+    // RT0 of the service routine that hasn't reached its ION.
+    std::optional<std::uint64_t> service_start;
+    InterruptController::Source service_source = InterruptController::Timer;
+};
+
+} // namespace mano
+
+#endif
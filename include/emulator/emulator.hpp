@@ -1,28 +1,556 @@
 #ifndef MANO_EMULATOR_HPP
 #define MANO_EMULATOR_HPP
 
+#include <algorithm>
+#include <memory>
+
 #include "cpu.hpp"
 #include "bus.hpp"
+#include "block_cache.hpp"
+#include "breakpoints.hpp"
+#include "call_tracker.hpp"
+#include "idle_loop.hpp"
+#include "journal.hpp"
+#include "profiler.hpp"
+#include "sampler.hpp"
+#include "trace.hpp"
 
 namespace mano {
 
 class Emulator {
   public:
-    Emulator(Memory emulator_memory) : memory(emulator_memory), bus(cpu, memory)  {}
-    Emulator(Emulator&& emulator) : cpu(emulator.cpu), memory(std::move(emulator.memory)), bus(cpu, memory) {}
+    // run looks for an idle loop at least this often.
+    static constexpr std::size_t IDLE_CHECK_CYCLES = 1 << 14;
+
+    enum class Engine {
+        // One whole instruction per dispatch, see Cpu::step_instruction.
+        Instruction,
+        // Predecoded straight-line runs of instructions, see BlockCache.
+        BasicBlock,
+        // Basic blocks translated to machine code once they're hot, see
+        //     BlockCache. Runs as BasicBlock without a code generator for
+        //     the host, see NativeCode.
+        Native,
+    };
+
+    Emulator(const Memory& emulator_memory) : memory(emulator_memory), bus(cpu, memory)  {}
+    Emulator(Emulator&& emulator) : cpu(emulator.cpu), memory(std::move(emulator.memory)), bus(cpu, memory), engine(emulator.engine), block_cache(std::move(emulator.block_cache)), journal(std::move(emulator.journal)), breakpoints(std::move(emulator.breakpoints)), profiler(std::move(emulator.profiler)), call_tracker(std::move(emulator.call_tracker)), trace(emulator.trace), sampler(emulator.sampler) {
+        bus.block_cache = block_cache.get();
+        bus.journal = journal.get();
+        bus.breakpoints = breakpoints.get();
+        bus.trace = trace;
+    }
 
     const auto& get_memory() const {
         return memory;
     }
+
+    /*
+     * Returns a copy of the machine that shares the memory pages with this
+     * one until either of them writes to a page, see PagedMemory.
+     * The copy runs on the same engine, its block cache is only built when
+     * it first runs. It has no journal, breakpoints or instruction
+     * observers.
+     * */
+    Emulator fork() {
+        Emulator emulator(cpu, memory.fork());
+        emulator.engine = engine;
+        return emulator;
+    }
      
     void cycle() {
+        if (journal) {
+            journal->begin(cpu);
+        }
+        cpu.interrupts.clear_stamps();
+        arm_breakpoints();
+        begin_observers();
         cpu.cycle_once(bus);
+        stamp_interrupts(1);
+        end_observers(1);
+        check_breakpoints();
+        sample(1);
+        if (journal) {
+            journal->end(cpu, 1);
+        }
+    }
+
+    std::size_t step_instruction() {
+        cpu.interrupts.clear_stamps();
+        arm_breakpoints();
+        if (journal) {
+            journal->begin(cpu);
+            const auto cycles = step();
+            stamp_interrupts(cycles);
+            check_breakpoints();
+            journal->end(cpu, cycles);
+            sample(cycles);
+            return cycles;
+        }
+        const auto cycles = step();
+        stamp_interrupts(cycles);
+        check_breakpoints();
+        sample(cycles);
+        return cycles;
+    }
+
+    /*
+     * Runs whole instructions until the CPU halts, executes an INP or OUT
+     * (see Cpu::io_pending), stops at a breakpoint (see Cpu::break_pending)
+     * or at least cycle_budget T-states are executed. A breakpoint at the
+     * instruction it starts from doesn't stop it. The interrupt cycles and
+     * enabling IONs get stamped with their T-state for Devices, it only
+     * returns early once InterruptController::stamps is full.
+     * The iterations of an idle loop nothing in the budget can end are
+     * counted without running them, see find_idle_loop.
+     * Returns the number of T-states that were executed.
+     * */
+    std::size_t run(std::size_t cycle_budget) {
+        if (journal) {
+            // Recorded as a single entry.
+            journal->begin(cpu);
+            const auto cycles = run_engine(cycle_budget);
+            journal->end(cpu, cycles);
+            return cycles;
+        }
+        return run_engine(cycle_budget);
+    }
+
+    /*
+     * The idle loop the CPU waits in, see mano::find_idle_loop.
+     * nullopt while a breakpoint, a register watchpoint, an instruction
+     * observer or the sampler would see the difference between running the
+     * loop and skipping it.
+     * */
+    std::optional<IdleLoop> find_idle_loop() const {
+        if (has_observers() || sampler
+            || (breakpoints && breakpoints->has_registers())) {
+            return {};
+        }
+        const auto loop = mano::find_idle_loop(cpu, memory);
+        if (loop && breakpoints) {
+            const auto pc = cpu.registers.get(Registers::PC);
+            for (std::size_t i = 0; i < loop->length; ++i) {
+                if (breakpoints->has_execute(
+                        static_cast<std::uint16_t>((pc + i) & 0xFFF)
+                    )) {
+                    return {};
+                }
+            }
+        }
+        return loop;
+    }
+
+    /*
+     * Records every following cycle, step_instruction and run call
+     * so they can be undone with reverse_step.
+     * */
+    void set_journal(bool enabled) {
+        if (enabled && !journal) {
+            journal = std::make_unique<Journal>();
+        } else if (!enabled) {
+            journal.reset();
+        }
+        bus.journal = journal.get();
+    }
+
+    const Journal* get_journal() const {
+        return journal.get();
+    }
+
+    /*
+     * Stops cycle, step_instruction and run at the instruction boundary
+     * before the instruction at address, see Breakpoints.
+     * */
+    void set_breakpoint(std::uint16_t address, bool enabled) {
+        use_breakpoints().set(Breakpoints::Kind::Execute, address, enabled);
+        // The blocks end before the breakpoints.
+        if (block_cache) {
+            block_cache->invalidate(address & 0xFFF);
+        }
+    }
+
+    /*
+     * Stops at the address, or the second one, once, then drops them along
+     * with any other stop, nullopt drops them now. For running to an
+     * address, see debugger.hpp.
+     * */
+    void set_temporary_breakpoint(
+        std::optional<std::uint16_t> address,
+        std::optional<std::uint16_t> second = {}
+    ) {
+        if (!address && !second && !breakpoints) {
+            return;
+        }
+        use_breakpoints().set_temporary(address, second);
+        if (block_cache) {
+            for (const auto target : {address, second}) {
+                if (target) {
+                    block_cache->invalidate(*target & 0xFFF);
+                }
+            }
+        }
+    }
+
+    /*
+     * Stops cycle, step_instruction and run after an access to the memory
+     * word, or once the register (a Registers::Id) changes,
+     * see Breakpoints. While a register is watched run executes one
+     * instruction per dispatch like with a trace recorder.
+     * */
+    void set_watchpoint(
+        Breakpoints::Kind kind,
+        std::uint16_t address,
+        bool enabled
+    ) {
+        if (kind == Breakpoints::Kind::Execute) {
+            set_breakpoint(address, enabled);
+            return;
+        }
+        use_breakpoints().set(kind, address, enabled);
+    }
+
+    /*
+     * Gives the breakpoint or memory watchpoint a condition and a hit count
+     * to stop at, see Breakpoints::Rule.
+     * */
+    void set_breakpoint_rule(
+        Breakpoints::Kind kind,
+        std::uint16_t address,
+        Breakpoints::Rule rule
+    ) {
+        use_breakpoints().set_rule(kind, address, std::move(rule));
+    }
+
+    void clear_breakpoints() {
+        breakpoints.reset();
+        bus.breakpoints = nullptr;
+        // Merge the blocks split by the breakpoints again.
+        if (block_cache) {
+            block_cache->clear();
+        }
+    }
+
+    const Breakpoints* get_breakpoints() const {
+        return breakpoints.get();
+    }
+
+    /*
+     * Whether the next instruction to run has a breakpoint.
+     * */
+    bool is_at_breakpoint() const {
+        return breakpoints && cpu.start_stop && !cpu.r
+               && cpu.get_sequence_counter() == 0
+               && breakpoints->has_execute(cpu.registers.get(Registers::PC));
+    }
+
+    /*
+     * Counts every following instruction per address, see Profiler.
+     * Disabling it drops the counters.
+     * While enabled run executes one instruction per dispatch like
+     * with a trace recorder.
+     * */
+    void set_profiling(bool enabled) {
+        if (enabled && !profiler) {
+            profiler = std::make_unique<Profiler>();
+        } else if (!enabled) {
+            profiler.reset();
+        }
+    }
+
+    const Profiler* get_profiler() const {
+        return profiler.get();
+    }
+
+    /*
+     * Rebuilds the subroutine calls of every following instruction,
+     * see CallTracker. Disabling it drops the call stack and the totals.
+     * While enabled run executes one instruction per dispatch like
+     * with a trace recorder.
+     * */
+    void set_call_tracking(bool enabled) {
+        if (enabled && !call_tracker) {
+            call_tracker = std::make_unique<CallTracker>();
+        } else if (!enabled) {
+            call_tracker.reset();
+        }
+    }
+
+    const CallTracker* get_call_tracker() const {
+        return call_tracker.get();
+    }
+
+    /*
+     * Records every following instruction to the recorder, nullptr detaches
+     * it. The recorder isn't owned and must outlive the attachment.
+     * While attached run executes one instruction per dispatch whatever the
+     * engine, the basic blocks don't stop between instructions.
+     * */
+    void set_trace(TraceRecorder* recorder) {
+        trace = recorder;
+        bus.trace = trace;
+    }
+
+    /*
+     * Samples the CPU every sampler interval T-states, nullptr detaches it.
+     * The sampler isn't owned and must outlive the attachment.
+     * Unlike the instruction observers it leaves run on the selected engine,
+     * the samples get the call stack depth while call tracking is enabled.
+     * The CPU state has no depth to sample, only the tracker knows it, and
+     * the tracker runs one instruction per dispatch: a BSA heavy loop took
+     * about 1.5 times as long on the native engine with it, and twice as
+     * long on the instruction engine.
+     * */
+    void set_sampler(Sampler* attached_sampler) {
+        sampler = attached_sampler;
+    }
+
+    /*
+     * Undoes the last recorded cycle, step_instruction or run call.
+     * Returns the number of T-states that were undone,
+     * 0 when there is nothing left to undo.
+     * */
+    std::size_t reverse_step() {
+        if (!journal) {
+            return 0;
+        }
+        bus.journal = nullptr;
+        bus.trace = nullptr;
+        bus.breakpoints = nullptr;
+        const auto cycles = journal->undo(cpu, bus);
+        bus.journal = journal.get();
+        bus.trace = trace;
+        bus.breakpoints = breakpoints.get();
+        // The instruction observers only go forward, the undone
+        //     instructions stay in them.
+        if (trace) {
+            trace->cancel();
+        }
+        if (profiler) {
+            profiler->cancel();
+        }
+        if (call_tracker) {
+            call_tracker->cancel();
+        }
+        // The last transfer shown by the UI didn't happen yet.
+        bus.last_dest = Bus::Selection::None;
+        bus.last_source = Bus::Selection::None;
+        return cycles;
+    }
+
+    /*
+     * Selects the engine used by run. The block engines build their cache
+     * the first time run uses it.
+     * */
+    void set_engine(Engine new_engine) {
+        if (new_engine == engine) {
+            return;
+        }
+        engine = new_engine;
+        block_cache.reset();
+        bus.block_cache = nullptr;
+    }
+
+    Engine get_engine() const {
+        return engine;
     }
 
   public:
     Cpu cpu;
-    Memory memory;
+    PagedMemory memory;
     Bus bus;
+
+  private:
+    std::size_t run_engine(std::size_t cycle_budget) {
+        cpu.io_pending = false;
+        cpu.interrupts.clear_stamps();
+        arm_breakpoints();
+        // Stops the engine at every sample that falls in the budget,
+        //     otherwise now and then to skip an idle loop.
+        std::size_t cycles = 0;
+        while (cycles < cycle_budget && cpu.start_stop && !cpu.io_pending
+               && !cpu.break_pending) {
+            std::size_t slice = 0;
+            if (sampler) {
+                slice = static_cast<std::size_t>(std::min<std::uint64_t>(
+                    cycle_budget - cycles,
+                    sampler->get_cycles_to_sample()
+                ));
+            } else {
+                cycles += skip_idle_loop(cycle_budget - cycles);
+                slice = std::min(cycle_budget - cycles, IDLE_CHECK_CYCLES);
+            }
+            const auto executed = run_slice(slice);
+            sample(executed);
+            if (executed == 0) {
+                break;
+            }
+            cycles += executed;
+            if (!stamp_interrupts(cycles)) {
+                break;
+            }
+        }
+        return cycles;
+    }
+
+    // Gives the interrupt cycle or ION the engine stopped at its T-state,
+    //     returns false once there's no room for another stamp.
+    bool stamp_interrupts(std::size_t cycles) {
+        auto& interrupts = cpu.interrupts;
+        if (interrupts.stamp_pending) {
+            interrupts.stamp_pending = false;
+            interrupts.stamps[interrupts.stamp_count - 1].cycles = cycles;
+        }
+        return interrupts.stamp_count < InterruptController::MAX_STAMPS;
+    }
+
+    // No device is serviced before run returns, so only the partial
+    //     iteration at the end of the budget is left to run.
+    std::size_t skip_idle_loop(std::size_t cycle_budget) {
+        const auto loop = find_idle_loop();
+        if (!loop || cycle_budget < 2 * loop->cycles) {
+            return 0;
+        }
+        // The first iteration leaves the registers as all the others do.
+        std::size_t cycles = 0;
+        for (std::size_t i = 0; i < loop->length; ++i) {
+            cycles += cpu.step_instruction(bus);
+        }
+        const auto skipped = (cycle_budget - cycles) / loop->cycles;
+        // Still counts the polls of the skipped iterations.
+        if (loop->poll == IdleLoop::Poll::Input) {
+            cpu.input_polls += skipped;
+        } else if (loop->poll == IdleLoop::Poll::Output) {
+            cpu.output_polls += skipped;
+        }
+        return cycles + skipped * loop->cycles;
+    }
+
+    std::size_t run_slice(std::size_t cycle_budget) {
+        // The basic blocks don't stop between instructions for the observers
+        //     and the register watchpoints.
+        if (engine != Engine::Instruction && !has_observers()
+            && !(breakpoints && breakpoints->has_registers())) {
+            if (!block_cache) {
+                block_cache =
+                    std::make_unique<BlockCache>(engine == Engine::Native);
+                bus.block_cache = block_cache.get();
+            }
+            return block_cache->run(cpu, bus, cycle_budget);
+        }
+        std::size_t cycles = 0;
+        while (cycles < cycle_budget && cpu.start_stop && !cpu.io_pending
+               && !cpu.interrupts.stamp_pending && !cpu.break_pending) {
+            cycles += step();
+            check_breakpoints();
+        }
+        return cycles;
+    }
+
+    std::size_t step() {
+        if (has_observers()) {
+            begin_observers();
+            const auto cycles = cpu.step_instruction(bus);
+            end_observers(cycles);
+            return cycles;
+        }
+        return cpu.step_instruction(bus);
+    }
+
+    Breakpoints& use_breakpoints() {
+        if (!breakpoints) {
+            breakpoints = std::make_unique<Breakpoints>();
+            breakpoints->snapshot_registers(cpu.registers);
+            bus.breakpoints = breakpoints.get();
+        }
+        return *breakpoints;
+    }
+
+    // Clears the last stop and compares the watched registers from here.
+    void arm_breakpoints() {
+        cpu.break_pending = false;
+        if (breakpoints && cpu.get_sequence_counter() == 0) {
+            breakpoints->snapshot_registers(cpu.registers);
+        }
+    }
+
+    // Stops at an instruction boundary with a breakpoint or a changed
+    //     register, the watchpoints of the bus stop by themselves.
+    void check_breakpoints() {
+        if (!breakpoints || cpu.break_pending
+            || cpu.get_sequence_counter() != 0) {
+            return;
+        }
+        if (breakpoints->has_registers()) {
+            if (const auto reg =
+                    breakpoints->find_register_change(cpu.registers)) {
+                breakpoints->stop(Breakpoints::Hit{
+                    Breakpoints::Kind::Register,
+                    static_cast<std::uint16_t>(*reg),
+                });
+                cpu.break_pending = true;
+                return;
+            }
+        }
+        if (is_at_breakpoint()
+            && breakpoints->check(
+                Breakpoints::Kind::Execute,
+                cpu.registers.get(Registers::PC),
+                cpu,
+                bus
+            )) {
+            cpu.break_pending = true;
+        }
+    }
+
+    void sample(std::size_t cycles) {
+        if (sampler) {
+            sampler->advance(cpu, call_tracker.get(), cycles);
+        }
+    }
+
+    // Instruction level observers, the trace recorder, the profiler
+    //     and the call tracker.
+    bool has_observers() const {
+        return trace || profiler || call_tracker;
+    }
+
+    void begin_observers() {
+        if (trace) {
+            trace->begin(cpu);
+        }
+        if (profiler) {
+            profiler->begin(cpu);
+        }
+        if (call_tracker) {
+            call_tracker->begin(cpu);
+        }
+    }
+
+    void end_observers(std::size_t cycles) {
+        if (trace) {
+            trace->end(cpu, cycles);
+        }
+        if (profiler) {
+            profiler->end(cpu, cycles);
+        }
+        if (call_tracker) {
+            call_tracker->end(cpu, cycles);
+        }
+    }
+
+    Emulator(const Cpu& emulator_cpu, PagedMemory&& emulator_memory) :
+        cpu(emulator_cpu), memory(std::move(emulator_memory)), bus(cpu, memory) {}
+
+    Engine engine = Engine::Instruction;
+    // Built by run_slice, only for the block engines.
+    std::unique_ptr<BlockCache> block_cache;
+    std::unique_ptr<Journal> journal;
+    std::unique_ptr<Breakpoints> breakpoints;
+    std::unique_ptr<Profiler> profiler;
+    std::unique_ptr<CallTracker> call_tracker;
+    TraceRecorder* trace = nullptr;
+    Sampler* sampler = nullptr;
 };
 
 } // namespace mano
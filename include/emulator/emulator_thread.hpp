@@ -0,0 +1,298 @@
+#ifndef MANO_EMULATOR_THREAD_HPP
+#define MANO_EMULATOR_THREAD_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(MANO_THREADS)
+    #include <thread>
+#endif
+
+#include "emulator/breakpoints.hpp"
+#include "emulator/condition.hpp"
+#include "emulator/devices.hpp"
+#include "emulator/emulator.hpp"
+#include "emulator/spsc_queue.hpp"
+#include "emulator/triple_buffer.hpp"
+
+namespace mano {
+
+/*
+ * Runs an Emulator for the UI, away from the frames.
+ *
+ * Built with MANO_THREADS the emulator gets its own thread, otherwise
+ * poll runs it on the caller for at most a frame. Either way the UI only
+ * talks to it through send, a lock-free queue of Commands, reads its state
+ * from the last published Snapshot and takes the output with drain_output.
+ *
+ * The emulator runs in one of the Modes until it's stopped or, for
+ * Continue, until it halts or hits a breakpoint. The input and output
+ * streams are the ports of its Devices, which only run when one of their
+ * events is due: the output goes through a queue the UI drains, a full
+ * queue leaves FGO clear until there's room.
+ * A program polling the streams in an idle loop (see find_idle_loop) skips
+ * the iterations at the clock rate, and at full speed waits without running
+ * until a command or the drained output can end the loop.
+ * */
+class EmulatorThread {
+  public:
+    static constexpr std::size_t COMMAND_CAPACITY = 256;
+    static constexpr std::size_t OUTPUT_CAPACITY = 4096;
+    // Hottest addresses in the Snapshot while profiling.
+    static constexpr std::size_t HOT_ADDRESS_COUNT = 5;
+    static constexpr auto DEFAULT_FRAME_BUDGET = std::chrono::milliseconds(8);
+
+    enum class Mode {
+        Idle,
+        // Cycles at the clock rate, or at full speed, see SetMaxSpeed.
+        Running,
+        // Steps backwards through the journal at the clock rate.
+        Reversing,
+        // Runs at full speed until a breakpoint or a halt.
+        Continuing,
+    };
+
+    struct Command {
+        enum class Kind {
+            // Replaces the emulator.
+            Load,
+            // One T-state.
+            Cycle,
+            // T-states until the next instruction starts.
+            StepBig,
+            // Runs a BSA call at full speed, steps any other instruction.
+            StepOver,
+            // Runs at full speed until the innermost tracked call returns.
+            StepOut,
+            ReverseStep,
+            Run,
+            Reverse,
+            // Continues to target too, when it's set.
+            Continue,
+            Stop,
+            SetClockRate,
+            // Run ignores the clock rate and runs as fast as it can.
+            SetMaxSpeed,
+            // Longest poll runs per frame, value is in milliseconds.
+            SetFrameBudget,
+            // Sets the breakpoint or watchpoint of the breakpoint kind.
+            SetBreakpoint,
+            SetBreakpointRule,
+            SetProfiling,
+            // Step out needs the calls tracked, see find_step_out_target.
+            SetCallTracking,
+            // Sets the register at address (a Registers::Id) to value.
+            SetRegister,
+            SetFlag,
+            // Replaces the unread input with text, consumed is the input
+            //     count of the snapshot the text came from.
+            SetInput,
+            SetInputOpen,
+            SetOutputOpen,
+            // T-states a port takes per character, see Devices.
+            SetInputLatency,
+            SetOutputLatency,
+            // T-states between the timer interrupts, 0 stops the timer.
+            SetTimerPeriod,
+            // Mask register of the InterruptController.
+            SetInterruptMask,
+            // Vectored interrupts with the vector table at address.
+            SetVectored,
+        };
+
+        Kind kind = Kind::Stop;
+        std::uint16_t address = 0;
+        std::uint16_t value = 0;
+        bool enabled = false;
+        double clock_rate = 0.0;
+        Breakpoints::Kind breakpoint = Breakpoints::Kind::Execute;
+        Condition::Flag flag = Condition::Flag::S;
+        std::optional<std::uint16_t> target{};
+        std::optional<Breakpoints::Rule> rule{};
+        std::string text{};
+        std::uint64_t consumed = 0;
+        std::unique_ptr<Emulator> emulator{};
+    };
+
+    struct HotAddress {
+        std::uint16_t address;
+        std::uint64_t cycles;
+    };
+
+    struct Snapshot {
+        Cpu cpu;
+        // Shares the pages with the emulator, see PagedMemory::fork. Only
+        //     the emulator's side replaces it, the UI just reads it.
+        PagedMemory memory{Memory{}};
+        // Last bus transfer, see Bus::last_source.
+        Bus::Selection last_source = Bus::Selection::None;
+        Bus::Selection last_dest = Bus::Selection::None;
+        std::uint16_t transfer_value = 0;
+        Breakpoints breakpoints;
+        // Taken at this change of the breakpoints, see publish.
+        std::uint64_t breakpoints_changes = 0;
+        // T-states in the journal.
+        std::uint64_t history = 0;
+        bool profiling = false;
+        std::uint64_t profile_cycles = 0;
+        std::vector<HotAddress> hot_addresses;
+        // Input not read yet when input_consumed was input_base, see
+        //     get_unread_input. The text only changes with input_version.
+        std::string input;
+        std::uint64_t input_base = 0;
+        std::uint64_t input_version = 0;
+        // Characters read so far.
+        std::uint64_t input_consumed = 0;
+        Mode mode = Mode::Idle;
+        // T-states run and undone so far, changes whenever the CPU does.
+        std::uint64_t executed = 0;
+        bool max_speed = false;
+        // T-states per second lately, 0 while idle.
+        double achieved_rate = 0.0;
+        // Idle loop the full speed modes wait in.
+        std::optional<IdleLoop> waiting;
+        Devices::Stats device_stats;
+        // T-states on the clock of the devices.
+        std::uint64_t device_cycles = 0;
+
+        std::string_view get_unread_input() const {
+            const auto read = std::min<std::uint64_t>(
+                input_consumed - input_base,
+                input.size()
+            );
+            return std::string_view(input).substr(
+                static_cast<std::size_t>(read)
+            );
+        }
+    };
+
+    EmulatorThread();
+    ~EmulatorThread();
+
+    EmulatorThread(const EmulatorThread&) = delete;
+    EmulatorThread& operator=(const EmulatorThread&) = delete;
+
+    /*
+     * Queues the command, returns false when the queue is full.
+     * */
+    bool send(Command command);
+
+    /*
+     * Handles the commands and runs the emulator for at most the frame
+     * budget when it has no thread, does nothing otherwise.
+     * */
+    void poll();
+
+    /*
+     * Takes the last published snapshot, returns false when it's the same
+     * one as before.
+     * */
+    bool update() {
+        return snapshots.update();
+    }
+
+    const Snapshot& get_snapshot() const {
+        return snapshots.get_front();
+    }
+
+    /*
+     * Appends the characters written to OUTR since the last call.
+     * */
+    void drain_output(std::string& output);
+
+    bool is_threaded() const;
+
+  private:
+    // T-states per run call at full speed, sized to end at the deadline
+    //     from the measured time per T-state.
+    static constexpr std::size_t MIN_BATCH_CYCLES = 64;
+    static constexpr std::size_t MAX_BATCH_CYCLES = 1 << 16;
+    // Longest the commands wait while the emulator runs.
+    static constexpr auto SLICE_TIME = std::chrono::milliseconds(4);
+    // The thread publishes at most this often while running.
+    static constexpr auto PUBLISH_PERIOD = std::chrono::milliseconds(8);
+    // Period the achieved rate is averaged over.
+    static constexpr auto RATE_PERIOD = std::chrono::milliseconds(250);
+
+    using Clock = std::chrono::steady_clock;
+
+    // Handles the commands, then runs the mode until the deadline.
+    void service(Clock::time_point deadline);
+    void handle(Command& command);
+    void run_clocked(Clock::time_point deadline);
+    // Runs at full speed, returns false once the emulator halts or stops
+    //     at a breakpoint. Returns early when the program starts waiting.
+    bool run_batches(Clock::time_point deadline);
+    // The idle loop only a command or the drained output can end.
+    std::optional<IdleLoop> find_wait() const;
+    // Runs the whole iterations of the idle loop that fit in the T-states,
+    //     returns 0 unless the CPU waits in one.
+    std::uint64_t skip_idle_loop(std::uint64_t cycles);
+    // Continues until the emulator stops, or reaches either target.
+    void continue_to(
+        std::optional<std::uint16_t> target,
+        std::optional<std::uint16_t> second = {}
+    );
+    void stop();
+
+    void cycle();
+    // Counts the T-states the emulator ran and moves the devices with them.
+    void advance(std::uint64_t cycles);
+    // Hands the output of the devices to the UI queue while there's room.
+    void flush_output();
+    // Forgets the bus transfer and ALU inputs shown for the last T-state.
+    void clear_transfers();
+    void publish();
+
+    std::unique_ptr<Emulator> emulator;
+    Mode mode = Mode::Idle;
+    double clock_rate = 1.0;
+    double elapsed_time = 0.0;
+    Clock::time_point last_tick;
+    bool max_speed = false;
+    Clock::duration frame_budget = DEFAULT_FRAME_BUDGET;
+    // Measured nanoseconds per T-state at full speed.
+    double cycle_time = 10.0;
+    // Where the achieved rate is measured from.
+    std::uint64_t rate_executed = 0;
+    Clock::time_point rate_start;
+    double achieved_rate = 0.0;
+    Devices devices;
+    // Set by run_batches when only a command or draining the output can end
+    //     the idle loop, the thread sleeps until then.
+    std::optional<IdleLoop> waiting;
+    std::uint64_t executed = 0;
+    // Something changed since the last publish.
+    bool changed = false;
+    // Breakpoints::get_version of the emulator's breakpoints when last
+    //     published, and the times it changed or the emulator was replaced.
+    std::uint64_t breakpoints_version = 0;
+    std::uint64_t breakpoints_changes = 0;
+    // Bumped by SetInput, see Snapshot::input_version.
+    std::uint64_t input_version = 0;
+    Clock::time_point last_publish;
+
+    SpscQueue<Command, COMMAND_CAPACITY> commands;
+    SpscQueue<char, OUTPUT_CAPACITY> output;
+    TripleBuffer<Snapshot> snapshots;
+
+#if defined(MANO_THREADS)
+    void run_thread();
+
+    // Bumped by send and drain_output, the idle thread waits on it.
+    std::atomic<std::uint32_t> wakeups = 0;
+    std::atomic<bool> quit = false;
+    std::thread thread;
+#endif
+};
+
+} // namespace mano
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef MANO_IDLE_LOOP_HPP
+#define MANO_IDLE_LOOP_HPP
+
+#include <cstddef>
+#include <optional>
+
+#include "emulator/memory.hpp"
+
+namespace mano {
+
+class Cpu;
+
+/*
+ * Loop that waits for a device without changing anything, one of
+ *
+ *     WAIT, SKI            WAIT, SKO            WAIT, BUN WAIT
+ *           BUN WAIT             BUN WAIT
+ *
+ * After its first iteration every following one leaves the CPU as it was,
+ * so the iterations up to the next time a device sets FGI or FGO can be
+ * skipped at once, see Emulator::run.
+ * */
+struct IdleLoop {
+    enum class Poll {
+        // The BUN to itself.
+        None,
+        // SKI, counted by Cpu::input_polls.
+        Input,
+        // SKO, counted by Cpu::output_polls.
+        Output,
+    };
+
+    // Instructions of the loop, 1 or 2.
+    std::size_t length;
+    // T-states of one iteration.
+    std::size_t cycles;
+    Poll poll;
+    // Setting the flag ends the loop, through the skip or an interrupt.
+    bool input;
+    bool output;
+};
+
+/*
+ * The idle loop the CPU runs, starting with any of its instructions.
+ * nullopt unless the CPU is at an instruction boundary of such a loop and
+ * only a device can end it, the flag the loop polls is clear and no
+ * interrupt is pending or can be raised with the flags as they are.
+ * */
+std::optional<IdleLoop>
+find_idle_loop(const Cpu& cpu, const PagedMemory& memory);
+
+} // namespace mano
+
+#endif
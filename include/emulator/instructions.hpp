@@ -9,7 +9,7 @@
 
 namespace mano {
 
-enum class Instr: std::size_t {
+enum class Instr: std::uint8_t {
     AND,
     ADD,
     LDA,
@@ -22,7 +22,9 @@ enum class Instr: std::size_t {
     CMA,
     CME,
     CIR,
-    CIL, INC, SPA, SNA, SZA, SZE, HLT, INP, OUT, SKI, SKO, ION, IOF
+    CIL, INC, SPA, SNA, SZA, SZE, HLT, INP, OUT, SKI, SKO, ION, IOF,
+    // Opcodes that don't match any instruction.
+    Undefined
 };
 
 struct Instruction {
@@ -53,6 +55,42 @@ struct Instruction {
 
     static constexpr std::optional<Instruction> from_mnemonic(const std::string_view mnemonic);
     static constexpr std::optional<Instruction> from_opcode(const std::uint16_t opcode); 
+
+    /*
+     * Returns the instruction in the opcode with a single table lookup,
+     * Instr::Undefined if the opcode is not a valid instruction.
+     * */
+    static constexpr Instr decode(const std::uint16_t opcode);
+    /*
+     * Returns the table entry holding the mnemonic, description and
+     * the cycle name of the instr.
+     * */
+    static constexpr const Instruction& from_instr(const Instr instr);
+
+    static constexpr bool is_mri(const Instr instr) {
+        return instr <= Instr::ISZ;
+    }
+
+    /*
+     * Returns the number of T-states the instruction takes,
+     * fetch and decode included.
+     * */
+    static constexpr std::size_t get_cycle_count(const Instr instr) {
+        switch (instr) {
+            case Instr::AND:
+            case Instr::ADD:
+            case Instr::LDA:
+            case Instr::BSA:
+                return 6;
+            case Instr::STA:
+            case Instr::BUN:
+                return 5;
+            case Instr::ISZ:
+                return 7;
+            default:
+                return 4;
+        }
+    }
 };
 
 
@@ -89,6 +127,48 @@ constexpr std::array<Instruction, 25> INSTRUCTIONS = {
 };
 
 
+inline constexpr Instruction UNDEFINED_INSTRUCTION = {
+    Instr::Undefined, "Undefined", 0xFFFF, false, "", "Undefined instruction"
+};
+
+// Instructions are stored in the same order as the Instr enum.
+static_assert([] {
+    for (std::size_t i = 0; i < INSTRUCTIONS.size(); ++i) {
+        if (static_cast<std::size_t>(INSTRUCTIONS[i].instr) != i) {
+            return false;
+        }
+    }
+    return true;
+}());
+
+/*
+ * Maps every 16 bit IR value to its instruction.
+ * */
+inline constexpr std::array<Instr, 0x10000> DECODE_TABLE = [] {
+    std::array<Instr, 0x10000> table {};
+    for (std::size_t opcode = 0; opcode < table.size(); ++opcode) {
+        // Bits 12-14 select the MRI instructions, 7 is reserved
+        //     for the register reference and input-output instructions.
+        const std::size_t index = (opcode >> 12) & 0x7;
+        table[opcode] = index <= 6 ? INSTRUCTIONS[index].instr : Instr::Undefined;
+    }
+    for (std::size_t i = 7; i < INSTRUCTIONS.size(); ++i) {
+        table[INSTRUCTIONS[i].opcode] = INSTRUCTIONS[i].instr;
+    }
+    return table;
+}();
+
+constexpr Instr Instruction::decode(const std::uint16_t opcode) {
+    return DECODE_TABLE[opcode];
+}
+
+constexpr const Instruction& Instruction::from_instr(const Instr instr) {
+    if (instr == Instr::Undefined) {
+        return UNDEFINED_INSTRUCTION;
+    }
+    return INSTRUCTIONS[static_cast<std::size_t>(instr)];
+}
+
 constexpr std::optional<Instruction> Instruction::from_mnemonic(const std::string_view mnemonic_str) {
     for (const auto& instruction: INSTRUCTIONS) {
         if (instruction.mnemonic == mnemonic_str) {
@@ -101,20 +181,13 @@ constexpr std::optional<Instruction> Instruction::from_mnemonic(const std::strin
 
 
 constexpr std::optional<Instruction> Instruction::from_opcode(const std::uint16_t opcode) {
-    // First check the non MRI instructions.
-    for (std::size_t i = 7; i < INSTRUCTIONS.size(); ++i) {
-        if (INSTRUCTIONS[i].opcode == opcode) {
-            return INSTRUCTIONS[i];
-        }
-    }
-    // Then try MRI instructions.
-    std::size_t index = (opcode >> 12) & 0x7;   
-    if (index <= 6) {
-        Instruction instruction = INSTRUCTIONS[index];
-        instruction.opcode = opcode;
-        return instruction;    
+    const Instr instr = decode(opcode);
+    if (instr == Instr::Undefined) {
+        return {};
     }
-    return {};
+    Instruction instruction = from_instr(instr);
+    instruction.opcode = opcode;
+    return instruction;
 }
 
 } // namespace mano
@@ -0,0 +1,104 @@
+#ifndef MANO_INTERRUPT_CONTROLLER_HPP
+#define MANO_INTERRUPT_CONTROLLER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace mano {
+
+/*
+ * Interrupt controller of the Cpu.
+ *
+ * Every source has a bit in the pending register, which is its flag, and
+ * in the mask register, a clear mask bit keeps the source from raising R.
+ * The sources are prioritized in the order of Source, the timer first.
+ *
+ * Without vectors the interrupt cycle saves PC at 0 and starts the routine
+ * at 1, which polls the flags to find the source. Vectored, it reads the
+ * vector of the highest priority source from the table at vector_base,
+ * saves PC at the vector and starts the routine after it, like BSA, so
+ * every source has a routine of its own that returns with BUN vector I.
+ * */
+struct InterruptController {
+    enum Source : std::uint8_t {
+        // FGT, the interrupt cycle that takes the tick clears it.
+        Timer,
+        // FGI and FGO, cleared by INP and OUT.
+        Input,
+        Output,
+    };
+
+    // An interrupt cycle, or an ION that enabled the interrupts.
+    struct Stamp {
+        // T-states into the Emulator call at its end.
+        std::uint64_t cycles;
+        // Source the interrupt cycle served, nullopt for the ION.
+        std::optional<Source> source;
+    };
+
+    static constexpr std::size_t SOURCE_COUNT = 3;
+    // Emulator::run returns once it has this many stamps.
+    static constexpr std::size_t MAX_STAMPS = 4;
+    static constexpr std::uint8_t ALL_SOURCES = (1 << SOURCE_COUNT) - 1;
+    // Right after the polling routine's BUN at 1.
+    static constexpr std::uint16_t DEFAULT_VECTOR_BASE = 0x002;
+
+    static constexpr std::uint8_t get_bit(Source source) {
+        return static_cast<std::uint8_t>(1 << source);
+    }
+
+    /*
+     * The highest priority source with its bit set, nullopt if none is.
+     * */
+    static constexpr std::optional<Source> select(std::uint8_t sources) {
+        for (std::size_t i = 0; i < SOURCE_COUNT; ++i) {
+            if (sources & (1 << i)) {
+                return static_cast<Source>(i);
+            }
+        }
+        return {};
+    }
+
+    static constexpr std::string_view get_name(Source source) {
+        constexpr std::string_view names[] = {"Timer", "Input", "Output"};
+        return names[source];
+    }
+
+    bool vectored = false;
+    std::uint8_t mask = ALL_SOURCES;
+    std::uint16_t vector_base = DEFAULT_VECTOR_BASE;
+    // Source the last interrupt cycle served, the highest priority one
+    //     even without vectors.
+    std::optional<Source> dispatched;
+
+    /*
+     * Notes the end of an interrupt cycle that served the source, or of an
+     * ION that enabled the interrupts for nullopt. The engines stop at it
+     * for Emulator to stamp its T-state, and go on unless stamps is full.
+     * Devices::advance takes the stamps to time the interrupts.
+     * */
+    void note(std::optional<Source> source) {
+        if (stamp_count < MAX_STAMPS) {
+            stamps[stamp_count] = Stamp{0, source};
+            stamp_count += 1;
+            stamp_pending = true;
+        }
+    }
+
+    void clear_stamps() {
+        stamp_count = 0;
+        stamp_pending = false;
+    }
+
+    // The last stamp has no T-states yet.
+    bool stamp_pending = false;
+    std::array<Stamp, MAX_STAMPS> stamps{};
+    std::size_t stamp_count = 0;
+};
+
+} // namespace mano
+
+#endif
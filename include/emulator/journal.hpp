@@ -0,0 +1,146 @@
+#ifndef MANO_JOURNAL_HPP
+#define MANO_JOURNAL_HPP
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <string_view>
+#include <vector>
+
+#include "emulator/instructions.hpp"
+#include "emulator/memory.hpp"
+
+namespace mano {
+
+class Bus;
+class Cpu;
+
+/*
+ * Undo log of the emulator. Every entry keeps the registers that changed,
+ * the flags, the sequence counter and the old value of every memory word
+ * that was written while it was recorded, so stepping back is a constant
+ * cost per entry and never replays the program.
+ *
+ * Changes made between two recorded dispatches, by the input and output
+ * devices or the register editor, are kept as entries of zero T-states.
+ * An entry saves only the first write of every word, so even a long run
+ * call saves at most a word and its address per memory word. Entries are
+ * kept in chunks, the oldest chunk is dropped once more than capacity
+ * entries or VALUE_CAPACITY saved words are recorded, which bounds the
+ * journal to about 45 MB with the default capacity.
+ * */
+class Journal {
+  public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 1 << 18;
+
+    explicit Journal(std::size_t entry_capacity = DEFAULT_CAPACITY) :
+        capacity(entry_capacity) {}
+
+    /*
+     * Called by Emulator around every dispatch while the journal is attached.
+     * */
+    void begin(const Cpu& cpu);
+    void end(const Cpu& cpu, std::size_t cycles);
+
+    /*
+     * Bus calls this before every memory write while the journal is attached.
+     * */
+    void record_write(std::uint16_t address, std::uint16_t old_value) {
+        // Undoing the first write of the word restores it.
+        if (recording && saved[address % MEMORY_SIZE] != entry_stamp) {
+            saved[address % MEMORY_SIZE] = entry_stamp;
+            auto& chunk = chunks.back();
+            chunk.values.push_back(address);
+            chunk.values.push_back(old_value);
+            value_count += 2;
+            write_count += 1;
+        }
+    }
+
+    /*
+     * Undoes the last recorded dispatch, and the device changes made after it.
+     * The bus must not have the journal attached.
+     * Returns the number of T-states that were undone, 0 when the journal
+     * is empty.
+     * */
+    std::size_t undo(Cpu& cpu, Bus& bus);
+
+    void clear();
+
+    bool empty() const {
+        return entry_count == 0;
+    }
+
+    /*
+     * T-states that can be undone.
+     * */
+    std::uint64_t get_cycles() const {
+        return cycles;
+    }
+
+  private:
+    // Architectural state of the Cpu.
+    struct State {
+        std::array<std::uint16_t, 8> registers{};
+        std::uint16_t flags = 0;
+        std::uint8_t sequence_counter = 0;
+        Instr instruction = Instr::Undefined;
+        std::string_view cycle_name;
+
+        bool operator==(const State&) const = default;
+    };
+
+    struct Entry {
+        std::string_view cycle_name;
+        std::uint64_t cycles;
+        std::uint32_t write_count;
+        std::uint8_t changed_registers;
+        std::uint16_t flags;
+        std::uint8_t sequence_counter;
+        Instr instruction;
+    };
+
+    struct Chunk {
+        std::vector<Entry> entries;
+        // Memory writes as address, old value pairs followed by the old
+        //     values of the changed registers, for every entry in order.
+        std::vector<std::uint16_t> values;
+        std::uint64_t cycles = 0;
+    };
+
+    static constexpr std::size_t CHUNK_ENTRIES = 1 << 12;
+    // Saved words per chunk and in all of them, the chunks grow past
+    //     CHUNK_VALUES by at most an entry.
+    static constexpr std::size_t CHUNK_VALUES = 1 << 20;
+    static constexpr std::size_t VALUE_CAPACITY = 1 << 24;
+
+    static State capture(const Cpu& cpu);
+    static void restore(Cpu& cpu, const State& state);
+
+    // Records the change from the last recorded state made outside of
+    //     a dispatch, if any.
+    void record_external(const State& state);
+    void push(const State& before, const State& after, std::size_t entry_cycles);
+    void reserve_entry();
+
+    std::deque<Chunk> chunks;
+    std::size_t capacity;
+    std::size_t entry_count = 0;
+    // Saved words in all the chunks.
+    std::size_t value_count = 0;
+    std::uint64_t cycles = 0;
+
+    State last;
+    bool has_last = false;
+    State before;
+    bool recording = false;
+    std::uint32_t write_count = 0;
+    // Stamp of the recorded entry in saved, bumped by begin.
+    std::uint32_t entry_stamp = 0;
+    // Stamp of the last entry that saved the word.
+    std::array<std::uint32_t, MEMORY_SIZE> saved{};
+};
+
+} // namespace mano
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef MANO_LANE_ENGINE_HPP
+#define MANO_LANE_ENGINE_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "emulator/cpu.hpp"
+#include "emulator/instructions.hpp"
+#include "emulator/memory.hpp"
+
+namespace mano {
+
+/*
+ * Runs up to LANE_COUNT independent copies of a program side by side, with
+ * the CPU state stored as one array per register (struct of arrays).
+ *
+ * Every dispatch picks the lane with the lowest PC and executes its
+ * instruction on every lane that sits on the same word, the other lanes are
+ * masked off and wait, so lanes that diverge on a skip or a branch join again
+ * when they reach the same address. The register and flag updates are
+ * branch free selects over the arrays, AVX2 blends when the compiler targets
+ * AVX2 (see MANO_AVX2) and plain loops for the compiler to vectorize
+ * otherwise. Memory accesses stay per lane since every lane has its own
+ * memory, forks of the image that share its pages until written.
+ *
+ * Undefined opcodes, and the last lane still running, fall back to
+ * Cpu::step_instruction for that lane alone.
+ * Lanes always stop at instruction boundaries.
+ * */
+class LaneEngine {
+  public:
+    static constexpr std::size_t LANE_COUNT = 16;
+
+    template <typename T>
+    using Lanes = std::array<T, LANE_COUNT>;
+
+    /*
+     * Every lane starts from the memory image like a new Emulator,
+     * lanes past lane_count start halted.
+     * */
+    explicit LaneEngine(const Memory& memory, std::size_t lane_count = LANE_COUNT);
+
+    /*
+     * Runs every lane until it halts, executes an INP or OUT (see io_pending)
+     * or its cycle count reaches cycle_limit.
+     * Lanes with io_pending set don't run, clear it after servicing the devices.
+     * */
+    void run(std::uint64_t cycle_limit);
+
+    /*
+     * Copies the lane out to a Cpu and back, at an instruction boundary.
+     * */
+    Cpu get_cpu(std::size_t lane) const;
+    void set_cpu(std::size_t lane, const Cpu& cpu);
+
+    const PagedMemory& get_memory(std::size_t lane) const {
+        return memory[lane];
+    }
+
+    std::size_t get_lane_count() const {
+        return lane_count;
+    }
+
+    // Registers
+    Lanes<std::uint16_t> ar{};
+    Lanes<std::uint16_t> pc{};
+    Lanes<std::uint16_t> dr{};
+    Lanes<std::uint16_t> ac{};
+    Lanes<std::uint16_t> ir{};
+    Lanes<std::uint16_t> tr{};
+    Lanes<std::uint16_t> outr{};
+    Lanes<std::uint16_t> inpr{};
+
+    // Flags, same meaning as the Cpu ones.
+    Lanes<std::uint8_t> e{};
+    Lanes<std::uint8_t> start_stop{};
+    Lanes<std::uint8_t> indirect{};
+    Lanes<std::uint8_t> fgi{};
+    Lanes<std::uint8_t> fgo{};
+    Lanes<std::uint8_t> ien{};
+    Lanes<std::uint8_t> r{};
+    Lanes<std::uint8_t> io_pending{};
+
+    Lanes<Instr> instruction{};
+    // T-states executed by each lane.
+    Lanes<std::uint64_t> cycles{};
+
+  private:
+    /*
+     * Executes the fetched word on the lanes in the mask,
+     * decode must be Instruction::decode(word) and not Undefined.
+     * */
+    void execute(const Lanes<std::uint8_t>& mask, std::uint16_t word, Instr decode);
+    void interrupt(const Lanes<std::uint8_t>& mask);
+    /*
+     * Runs a single lane on a Cpu over the lane's own memory until it halts,
+     * executes an INP or OUT or reaches cycle_limit.
+     * */
+    void run_lane(std::size_t lane, std::uint64_t cycle_limit);
+
+    std::vector<PagedMemory> memory;
+    std::size_t lane_count;
+};
+
+} // namespace mano
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef MANO_LOCKSTEP_HPP
+#define MANO_LOCKSTEP_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "emulator/emulator.hpp"
+
+namespace mano {
+
+/*
+ * Runs a program on one of the faster engines next to the T-state engine
+ * and compares their architectural state after every dispatch of the faster
+ * one. Dispatch sizes are varied so both the whole block and the per
+ * instruction paths are covered.
+ * */
+class Lockstep {
+  public:
+    Lockstep(const Memory& memory, Emulator::Engine engine);
+
+    /*
+     * Runs both emulators for at least cycle_budget T-states or until they
+     * halt. Returns a description of the first difference, if any.
+     * */
+    std::optional<std::string> run(std::size_t cycle_budget);
+
+    /*
+     * Compares everything the program can observe, the T-state bookkeeping
+     * for the UI is not included.
+     * */
+    static std::optional<std::string>
+    compare(const Emulator& expected, const Emulator& actual);
+
+    std::uint64_t get_cycles() const {
+        return cycles;
+    }
+
+    const Emulator& get_emulator() const {
+        return emulator;
+    }
+
+  private:
+    Emulator reference;
+    Emulator emulator;
+
+    std::uint64_t cycles = 0;
+    std::size_t dispatch_count = 0;
+};
+
+} // namespace mano
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef MANO_MEMORY_HPP
+#define MANO_MEMORY_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+namespace mano {
+
+static constexpr std::size_t MEMORY_SIZE = 4096;
+using Memory = std::array<std::uint16_t, MEMORY_SIZE>;
+
+/*
+ * Memory split in pages that forks share until one of them writes to
+ * the page (copy on write), so forking copies PAGE_COUNT pointers instead
+ * of the whole memory.
+ * Neither a PagedMemory nor its forks are thread safe. Whether a page is
+ * still shared is read from its use count, which doesn't synchronize with
+ * the other threads, so every fork that writes or is destroyed has to stay
+ * on the thread of the memory it was forked from. Another thread may only
+ * read a fork it got through a synchronizing handoff and hands back the same
+ * way, as EmulatorThread does with the memory of its snapshots.
+ * */
+class PagedMemory {
+  public:
+    static constexpr std::size_t PAGE_SIZE = 256;
+    static constexpr std::size_t PAGE_COUNT = MEMORY_SIZE / PAGE_SIZE;
+
+    explicit PagedMemory(const Memory& image);
+
+    PagedMemory(PagedMemory&&) = default;
+    PagedMemory& operator=(PagedMemory&&) = default;
+    // Use fork, copying would share the pages without the bookkeeping.
+    PagedMemory(const PagedMemory&) = delete;
+    PagedMemory& operator=(const PagedMemory&) = delete;
+
+    /*
+     * Returns a copy that shares every page with this one.
+     * */
+    PagedMemory fork();
+
+    std::uint16_t operator[](std::size_t address) const {
+        return words[address / PAGE_SIZE][address % PAGE_SIZE];
+    }
+
+    void write(std::size_t address, std::uint16_t value) {
+        const auto page = address / PAGE_SIZE;
+        if (!(owned_pages & (1u << page))) {
+            detach(page);
+        }
+        words[page][address % PAGE_SIZE] = value;
+    }
+
+    /*
+     * Word pointer of every page, for the generated code that reads the
+     * memory without the page lookup, see NativeCode. The array stays put
+     * until the memory is moved, its pointers change with the writes.
+     * */
+    const std::uint16_t* const* get_pages() const {
+        return words.data();
+    }
+
+    static constexpr std::size_t size() {
+        return MEMORY_SIZE;
+    }
+
+    /*
+     * Flat copy of the whole memory.
+     * */
+    Memory get_image() const;
+
+    /*
+     * Number of pages still shared with a fork.
+     * */
+    std::size_t get_shared_page_count() const;
+
+  private:
+    using Page = std::array<std::uint16_t, PAGE_SIZE>;
+
+    PagedMemory() = default;
+
+    // Gives the page a private copy before the first write.
+    void detach(std::size_t page);
+
+    std::array<std::shared_ptr<Page>, PAGE_COUNT> pages;
+    // pages[i]->data(), skips the shared_ptr on every access.
+    std::array<std::uint16_t*, PAGE_COUNT> words{};
+    // Bit per page, set when no fork shares it.
+    std::uint32_t owned_pages = 0;
+};
+
+} // namespace mano
+
+#endif
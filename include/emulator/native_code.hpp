@@ -0,0 +1,128 @@
+#ifndef MANO_NATIVE_CODE_HPP
+#define MANO_NATIVE_CODE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "emulator/memory.hpp"
+
+namespace mano {
+
+/*
+ * Translates straight-line runs of instructions to x86-64 machine code,
+ * see BlockCache.
+ *
+ * The generated code keeps AC, DR, AR, PC and E in host registers, reads
+ * memory straight from the pages of the PagedMemory and calls the write
+ * handler for every write, which does what Bus::write does and says whether
+ * the code has to stop. PC is only computed where a block can leave, it's
+ * known when the block is built everywhere else. Only the instructions a
+ * block can run without the Cpu are translated: no I/O, ION, IOF or
+ * undefined opcodes.
+ *
+ * A block that ends without halting continues to the block linked at the
+ * new PC, without going back to the caller, as long as the T-states of that
+ * block still fit in the limit. It stops at every address without a linked
+ * block, after a HLT and after a write the handler stops it at.
+ *
+ * Code is only generated on x86-64 hosts with the System V calling
+ * convention, everywhere else (wasm, Windows, other CPUs) is_supported
+ * returns false and translate nullptr. The code lives in an arena that is
+ * made writable while translating and executable otherwise, translate
+ * returns nullptr once it's full until the next clear, which drops every
+ * block it returned along with the links.
+ * */
+class NativeCode {
+  public:
+    // Bytes of machine code, the blocks of a few hundred instructions take
+    //     a few tens of KB.
+    static constexpr std::size_t CODE_CAPACITY = 1 << 20;
+
+    using Block = const std::uint8_t*;
+
+    /*
+     * Registers passed in and out of the generated code.
+     * */
+    struct State {
+        // PagedMemory::get_pages of the memory the code reads.
+        const std::uint16_t* const* pages;
+        // Passed back to the write handler.
+        void* context;
+        // Linked blocks by their address, filled in by run.
+        const Block* links;
+        // T-states run, the code adds the ones of every block it enters
+        //     and never goes past cycle_limit.
+        std::size_t cycles;
+        std::size_t cycle_limit;
+        std::uint16_t ac;
+        std::uint16_t dr;
+        std::uint16_t ar;
+        std::uint16_t pc;
+        // Word of the last instruction executed, only written.
+        std::uint16_t ir;
+        std::uint8_t e;
+    };
+
+    /*
+     * Writes value to M[address], returns true when the code has to stop
+     * after the writing instruction.
+     * */
+    using WriteHandler =
+        bool (*)(State* state, std::uint32_t address, std::uint32_t value);
+
+    explicit NativeCode(WriteHandler write_handler);
+    ~NativeCode();
+
+    NativeCode(const NativeCode&) = delete;
+    NativeCode& operator=(const NativeCode&) = delete;
+
+    static bool is_supported();
+
+    /*
+     * Translates the instructions starting at address, every one of them
+     * must be translatable and only the last one may branch, skip or halt.
+     * Returns nullptr when the arena is full.
+     * */
+    Block translate(std::uint16_t address, std::span<const std::uint16_t> words);
+
+    /*
+     * Lets the blocks continue to the block at the address,
+     * nullptr makes them stop there.
+     * */
+    void link(std::uint16_t address, Block block) {
+        links[address] = block;
+    }
+
+    /*
+     * Runs the block and the ones it continues to from the state, which
+     * must leave room in cycle_limit for the whole block.
+     * */
+    void run(State& state, Block block);
+
+    /*
+     * Drops every block and link, the arena is reused from its start.
+     * */
+    void clear();
+
+  private:
+    // Maps the arena and generates the code every block shares.
+    bool allocate();
+    // Copies the code to the end of the arena, nullptr when it's full.
+    Block emit(std::span<const std::uint8_t> bytes);
+
+    WriteHandler write;
+    std::uint8_t* code = nullptr;
+    std::size_t code_size = 0;
+    // Code at the start of the arena: the entry from run, the exit back to
+    //     it and the dispatch to the block linked at PC.
+    std::size_t shared_size = 0;
+    Block exit = nullptr;
+    Block dispatch = nullptr;
+    std::array<Block, MEMORY_SIZE> links{};
+};
+
+} // namespace mano
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef MANO_PROFILER_HPP
+#define MANO_PROFILER_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "emulator/memory.hpp"
+
+namespace mano {
+
+class Cpu;
+
+/*
+ * Execution counters per address, filled while attached to an Emulator,
+ * see Emulator::set_profiling.
+ *
+ * The data reads and writes are worked out from the instruction once it
+ * completes instead of counting Bus accesses, so neither the bus nor the
+ * engines change and an emulator without a profiler runs exactly as before.
+ * Instructions are counted from their next boundary on.
+ * */
+class Profiler {
+  public:
+    using Counters = std::array<std::uint64_t, MEMORY_SIZE>;
+
+    /*
+     * Called by Emulator around every dispatch while attached.
+     * */
+    void begin(const Cpu& cpu);
+    void end(const Cpu& cpu, std::size_t cycles);
+
+    /*
+     * Drops the instruction being counted, the CPU state it started from
+     * was undone.
+     * */
+    void cancel() {
+        in_instruction = false;
+    }
+
+    void clear();
+
+    /*
+     * Addresses that executed at least one instruction, the most T-states
+     * first, at most count of them.
+     * */
+    std::vector<std::uint16_t> get_hot_addresses(std::size_t count) const;
+
+    // Instructions executed from each address.
+    Counters executions{};
+    // T-states of those instructions, the fetch and the indirect cycle
+    //     included.
+    Counters cycles{};
+    // Data accesses to each word, instruction fetches not included.
+    Counters reads{};
+    Counters writes{};
+
+    std::uint64_t interrupts = 0;
+    std::uint64_t interrupt_cycles = 0;
+    // T-states of every counted instruction and interrupt cycle.
+    std::uint64_t total_cycles = 0;
+
+  private:
+    bool in_instruction = false;
+    bool interrupt = false;
+    std::uint16_t pc = 0;
+    std::uint64_t instruction_cycles = 0;
+};
+
+} // namespace mano
+
+#endif
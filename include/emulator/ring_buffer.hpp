@@ -0,0 +1,80 @@
+#ifndef MANO_RING_BUFFER_HPP
+#define MANO_RING_BUFFER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace mano {
+
+/*
+ * Queue over a power of two array that wraps around, both ends are O(1).
+ * Unlike SpscQueue it's for a single thread and grows when it's full,
+ * doubling the array.
+ * */
+template <typename T>
+class RingBuffer {
+  public:
+    void push(T value) {
+        if (count == slots.size()) {
+            grow();
+        }
+        slots[(head + count) & (slots.size() - 1)] = std::move(value);
+        ++count;
+    }
+
+    std::optional<T> pop() {
+        if (count == 0) {
+            return {};
+        }
+        std::optional<T> value = std::move(slots[head]);
+        head = (head + 1) & (slots.size() - 1);
+        --count;
+        return value;
+    }
+
+    // Index 0 is the oldest value.
+    const T& operator[](std::size_t index) const {
+        return slots[(head + index) & (slots.size() - 1)];
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+    // Drops the newest values past the size.
+    void truncate(std::size_t size) {
+        count = std::min(count, size);
+    }
+
+  private:
+    static constexpr std::size_t MIN_CAPACITY = 16;
+
+    void grow() {
+        std::vector<T> grown(std::max(slots.size() * 2, MIN_CAPACITY));
+        for (std::size_t i = 0; i < count; ++i) {
+            grown[i] = std::move(slots[(head + i) & (slots.size() - 1)]);
+        }
+        slots = std::move(grown);
+        head = 0;
+    }
+
+    std::vector<T> slots;
+    std::size_t head = 0;
+    std::size_t count = 0;
+};
+
+} // namespace mano
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef MANO_SAMPLER_HPP
+#define MANO_SAMPLER_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "emulator/memory.hpp"
+
+namespace mano {
+
+class CallTracker;
+class Cpu;
+
+/*
+ * Statistical profiler, takes a sample of the CPU every interval T-states
+ * give or take jitter, see Emulator::set_sampler.
+ *
+ * Emulator::run splits its budget at the next sample and runs the engine in
+ * between untouched, so sampling works with every engine and costs one extra
+ * dispatch per sample. Samples land on the first instruction boundary after
+ * they are due, the jitter keeps them from locking onto a loop of the same
+ * period.
+ *
+ * Samples go to a ring buffer that is drained into the report when it fills
+ * up or when drain is called.
+ * */
+class Sampler {
+  public:
+    static constexpr std::uint64_t DEFAULT_INTERVAL = 10000;
+    static constexpr std::size_t RING_SIZE = 1024;
+
+    struct Sample {
+        // T-states run through the emulator before the sample.
+        std::uint64_t cycle;
+        // Address of the instruction the CPU is about to run.
+        std::uint16_t pc;
+        // Depth of the shadow call stack, when a CallTracker is attached.
+        //     Mano has no stack pointer to read it from, so the depth costs
+        //     the tracker on every instruction, see Emulator::set_sampler.
+        std::optional<std::uint16_t> depth;
+        bool ien;
+        bool r;
+    };
+
+    struct Report {
+        std::uint64_t samples = 0;
+        // Samples per PC.
+        std::array<std::uint64_t, MEMORY_SIZE> pc{};
+        // Samples per call stack depth, only the samples that had one.
+        std::vector<std::uint64_t> depth;
+        // Samples taken with IEN set and with an interrupt pending.
+        std::uint64_t ien = 0;
+        std::uint64_t r = 0;
+    };
+
+    /*
+     * Samples are interval T-states apart on average, every gap is drawn
+     * uniformly within jitter of it.
+     * */
+    explicit Sampler(
+        std::uint64_t sample_interval = DEFAULT_INTERVAL,
+        std::uint64_t sample_jitter = DEFAULT_INTERVAL / 2,
+        std::uint64_t seed = 1
+    );
+
+    /*
+     * T-states left until the next sample is due.
+     * */
+    std::uint64_t get_cycles_to_sample() const {
+        return next_sample - cycles;
+    }
+
+    /*
+     * Called by Emulator with the T-states it ran, takes a sample if one
+     * is due.
+     * */
+    void advance(
+        const Cpu& cpu,
+        const CallTracker* call_tracker,
+        std::uint64_t executed
+    ) {
+        cycles += executed;
+        if (cycles >= next_sample) {
+            sample(cpu, call_tracker);
+        }
+    }
+
+    /*
+     * Moves the buffered samples into the report.
+     * */
+    void drain();
+
+    const Report& get_report() const {
+        return report;
+    }
+
+    /*
+     * Samples not drained yet, oldest first.
+     * */
+    std::vector<Sample> get_pending() const;
+
+  private:
+    void sample(const Cpu& cpu, const CallTracker* call_tracker);
+    std::uint64_t next_gap();
+
+    std::uint64_t interval;
+    std::uint64_t jitter;
+    // xorshift64 state.
+    std::uint64_t random;
+
+    std::uint64_t cycles = 0;
+    std::uint64_t next_sample = 0;
+
+    std::array<Sample, RING_SIZE> ring{};
+    std::size_t ring_start = 0;
+    std::size_t ring_count = 0;
+
+    Report report;
+};
+
+} // namespace mano
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef MANO_SPSC_QUEUE_HPP
+#define MANO_SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace mano {
+
+/*
+ * Bounded lock-free queue between exactly one producer thread and one
+ * consumer thread. push fails instead of waiting when the queue is full,
+ * pop returns nullopt when it's empty.
+ *
+ * The slots are constructed once, push and pop move the values in and out,
+ * so a value that owns memory is handed over without allocating.
+ * */
+template <typename T, std::size_t CAPACITY>
+class SpscQueue {
+  public:
+    static_assert(
+        (CAPACITY & (CAPACITY - 1)) == 0,
+        "The capacity must be a power of two"
+    );
+
+    bool push(T value) {
+        const auto tail = tail_index.load(std::memory_order_relaxed);
+        if (tail - head_index.load(std::memory_order_acquire) == CAPACITY) {
+            return false;
+        }
+        slots[tail % CAPACITY] = std::move(value);
+        tail_index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> pop() {
+        const auto head = head_index.load(std::memory_order_relaxed);
+        if (head == tail_index.load(std::memory_order_acquire)) {
+            return {};
+        }
+        std::optional<T> value = std::move(slots[head % CAPACITY]);
+        head_index.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    /*
+     * Whether the queue looked empty, exact only on the consumer thread.
+     * */
+    bool empty() const {
+        return head_index.load(std::memory_order_acquire)
+               == tail_index.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::array<T, CAPACITY> slots{};
+    // Both only grow, the producer owns the tail and the consumer the head.
+    //     Kept on separate cache lines so they don't bounce between cores.
+    alignas(64) std::atomic<std::size_t> head_index = 0;
+    alignas(64) std::atomic<std::size_t> tail_index = 0;
+};
+
+} // namespace mano
+
+#endif
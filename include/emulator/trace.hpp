@@ -0,0 +1,206 @@
+#ifndef MANO_TRACE_HPP
+#define MANO_TRACE_HPP
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <vector>
+
+namespace mano {
+
+class Cpu;
+
+/*
+ * One executed instruction, or interrupt cycle, of a trace.
+ * */
+struct TraceRecord {
+    // T-states executed before the instruction since the recording started.
+    std::uint64_t cycle = 0;
+    // Address of the instruction, the return address for interrupt cycles.
+    std::uint16_t pc = 0;
+    std::uint16_t ir = 0;
+    // AC and E after the instruction.
+    std::uint16_t ac = 0;
+    bool e = false;
+    bool interrupt = false;
+    // Effective address of memory reference instructions.
+    std::optional<std::uint16_t> address;
+    // Memory word written by the instruction, at most one per instruction.
+    std::optional<std::uint16_t> write_address;
+    std::uint16_t write_value = 0;
+
+    bool operator==(const TraceRecord&) const = default;
+};
+
+/*
+ * Trace file layout, every integer is little endian:
+ *
+ *     "MANOTRC1"
+ *     block*
+ *
+ * and every block:
+ *
+ *     u32 size of the records in bytes
+ *     u32 record count
+ *     u64 cycle of the first record
+ *     record*
+ *
+ * A record is a flags byte followed by the fields the flags don't make
+ * redundant, as varints (LEB128) of the difference with the previous record
+ * of the block. Blocks are decoded on their own, a reader only ever holds
+ * one of them.
+ * */
+namespace trace_format {
+
+inline constexpr char MAGIC[8] = {'M', 'A', 'N', 'O', 'T', 'R', 'C', '1'};
+inline constexpr std::size_t BLOCK_HEADER_SIZE = 16;
+// Largest encoded record, every field present at its widest.
+inline constexpr std::size_t MAX_RECORD_SIZE = 32;
+
+enum Flags : std::uint8_t {
+    INTERRUPT = 1 << 0,
+    E = 1 << 1,
+    // The effective address follows, as the difference with IR(0 ~ 11).
+    ADDRESS = 1 << 2,
+    // PC is the previous PC plus one and is left out.
+    PC_NEXT = 1 << 3,
+    // AC didn't change and is left out.
+    AC_SAME = 1 << 4,
+    WRITE = 1 << 5,
+    // The written address is the effective address and is left out.
+    WRITE_ADDRESS = 1 << 6,
+    // The written value is AC and is left out.
+    WRITE_AC = 1 << 7,
+};
+
+} // namespace trace_format
+
+/*
+ * Receives the encoded blocks of a TraceRecorder.
+ * */
+class TraceSink {
+  public:
+    virtual ~TraceSink() = default;
+
+    /*
+     * Takes the contents of block, leaving an empty buffer in its place for
+     * the recorder to fill next, so a sink can keep writing the previous
+     * block in the meantime.
+     * */
+    virtual void write(std::vector<std::uint8_t>& block) = 0;
+};
+
+/*
+ * Encodes every instruction the emulator executes while it's attached, see
+ * Emulator::set_trace. Records start at the next instruction boundary and
+ * blocks are handed to the sink as they fill up.
+ * */
+class TraceRecorder {
+  public:
+    static constexpr std::size_t BLOCK_SIZE = 1 << 16;
+
+    explicit TraceRecorder(TraceSink& trace_sink);
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    /*
+     * Called by Emulator around every dispatch while attached.
+     * */
+    void begin(const Cpu& cpu);
+    void end(const Cpu& cpu, std::size_t cycles);
+
+    /*
+     * Bus calls this on every memory write while attached.
+     * */
+    void record_write(std::uint16_t address, std::uint16_t value) {
+        if (in_instruction) {
+            record.write_address = address;
+            record.write_value = value;
+        }
+    }
+
+    /*
+     * Drops the instruction being recorded, the CPU state it started from
+     * was undone.
+     * */
+    void cancel() {
+        in_instruction = false;
+    }
+
+    /*
+     * Hands the current block to the sink, call it before closing the sink.
+     * */
+    void flush();
+
+    std::uint64_t get_record_count() const {
+        return record_count;
+    }
+
+  private:
+    void encode(const TraceRecord& next);
+    void start_block();
+
+    TraceSink& sink;
+    std::vector<std::uint8_t> block;
+    std::uint32_t block_records = 0;
+
+    // Last record of the block, the next one is encoded against it.
+    TraceRecord previous;
+    TraceRecord record;
+    bool in_instruction = false;
+
+    std::uint64_t cycles = 0;
+    std::uint64_t record_count = 0;
+};
+
+/*
+ * Streams the records of a trace file, holding one block at a time.
+ * */
+class TraceReader {
+  public:
+    explicit TraceReader(std::istream& trace_input);
+
+    /*
+     * Whether the stream starts like a trace file.
+     * */
+    bool is_valid() const {
+        return valid;
+    }
+
+    /*
+     * Decodes the next record. Returns nothing at the end of the trace,
+     * or at the first truncated or corrupt block.
+     * */
+    std::optional<TraceRecord> next();
+
+    /*
+     * Continues reading at the block starting at offset, an offset returned
+     * by get_block_offset.
+     * */
+    void seek(std::uint64_t offset);
+
+    /*
+     * Offset in the stream of the block holding the last record returned
+     * by next.
+     * */
+    std::uint64_t get_block_offset() const {
+        return block_offset;
+    }
+
+  private:
+    bool read_block();
+
+    std::istream& input;
+    bool valid = false;
+    std::uint64_t block_offset = 0;
+
+    std::vector<std::uint8_t> block;
+    std::size_t position = 0;
+    std::uint32_t block_records = 0;
+    TraceRecord previous;
+};
+
+} // namespace mano
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef MANO_TRACE_INDEX_HPP
+#define MANO_TRACE_INDEX_HPP
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "emulator/memory.hpp"
+#include "emulator/trace.hpp"
+
+namespace mano {
+
+/*
+ * Side index of a trace file: for every memory word the cycles of the
+ * instructions that wrote it, and for every address the cycles at which an
+ * instruction was executed from it, plus the offset of every trace block.
+ *
+ * Every list is a sorted array of cycles split in chunks of CHUNK_ENTRIES,
+ * only the first cycle of each chunk is kept in memory. A query is a binary
+ * search over the chunks followed by reading and searching a single chunk,
+ * so it costs a few kilobytes of reading whatever the length of the trace.
+ *
+ * Index file layout, every integer is little endian:
+ *
+ *     "MANOIDX1"
+ *     chunk*                   u64 cycle per entry
+ *     u64 block count
+ *     block*                   u64 offset, u64 first cycle
+ *     list[2 * MEMORY_SIZE]    u64 entry count, u64 chunk count,
+ *                                  then per chunk u64 offset, u64 first cycle
+ *     u64 offset of the block count
+ *     "MANOIDX1"
+ *
+ * Write lists come first, then visit lists.
+ * */
+class TraceIndex {
+  public:
+    static constexpr std::size_t CHUNK_ENTRIES = 512;
+
+    /*
+     * Builds the index of the trace in a single streaming pass.
+     * Returns false if the trace is corrupt or writing the index failed.
+     * */
+    static bool build(std::istream& trace, std::ostream& index);
+
+    /*
+     * Loads the chunk directory, the chunks are read by every query.
+     * */
+    explicit TraceIndex(std::istream& index_input);
+
+    bool is_valid() const {
+        return valid;
+    }
+
+    /*
+     * Cycle of the last instruction that wrote M[address] before cycle.
+     * */
+    std::optional<std::uint64_t> find_last_write(
+        std::uint16_t address,
+        std::uint64_t cycle
+    );
+
+    /*
+     * Cycle of the first instruction executed from address at cycle
+     * or later. Interrupt cycles don't count as visits.
+     * */
+    std::optional<std::uint64_t> find_next_visit(
+        std::uint16_t address,
+        std::uint64_t cycle
+    );
+
+    std::uint64_t get_write_count(std::uint16_t address) const {
+        return writes[address % MEMORY_SIZE].entry_count;
+    }
+
+    std::uint64_t get_visit_count(std::uint16_t address) const {
+        return visits[address % MEMORY_SIZE].entry_count;
+    }
+
+    /*
+     * Reads the record of the instruction at cycle from the trace,
+     * decoding a single block.
+     * */
+    std::optional<TraceRecord> read_record(
+        std::istream& trace,
+        std::uint64_t cycle
+    ) const;
+
+  private:
+    struct Chunk {
+        std::uint64_t offset;
+        std::uint64_t first_cycle;
+    };
+
+    struct List {
+        std::uint64_t entry_count = 0;
+        std::vector<Chunk> chunks;
+    };
+
+    /*
+     * Entries of the chunk of the list, empty if it can't be read.
+     * */
+    const std::vector<std::uint64_t>& read_chunk(
+        const List& list,
+        std::size_t chunk
+    );
+
+    std::istream& input;
+    bool valid = false;
+
+    std::vector<Chunk> blocks;
+    std::array<List, MEMORY_SIZE> writes;
+    std::array<List, MEMORY_SIZE> visits;
+
+    // Last chunk read, queries that repeat on the same list often hit it.
+    std::uint64_t cached_offset = UINT64_MAX;
+    std::vector<std::uint64_t> cached_entries;
+};
+
+} // namespace mano
+
+#endif
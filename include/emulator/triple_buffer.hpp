@@ -0,0 +1,62 @@
+#ifndef MANO_TRIPLE_BUFFER_HPP
+#define MANO_TRIPLE_BUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace mano {
+
+/*
+ * Hands the latest value from one writer thread to one reader thread
+ * without locks or waiting.
+ *
+ * The writer fills get_back and publishes it, the reader calls update and
+ * reads get_front. Each side owns one of the three buffers and the third is
+ * swapped in between, so neither side ever sees a half written value.
+ * The reader skips the values published between two of its updates.
+ * */
+template <typename T>
+class TripleBuffer {
+  public:
+    T& get_back() {
+        return buffers[back];
+    }
+
+    void publish() {
+        back = middle.exchange(
+            static_cast<std::uint8_t>(back | FRESH),
+            std::memory_order_acq_rel
+        ) & INDEX_MASK;
+    }
+
+    /*
+     * Takes the last published value as the front one, returns false when
+     * nothing was published since the last call.
+     * */
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T& get_front() const {
+        return buffers[front];
+    }
+
+  private:
+    static constexpr std::uint8_t INDEX_MASK = 0x3;
+    // Set in middle while it holds a value the reader hasn't taken.
+    static constexpr std::uint8_t FRESH = 0x4;
+
+    std::array<T, 3> buffers{};
+    std::uint8_t back = 0;
+    std::atomic<std::uint8_t> middle = 1;
+    std::uint8_t front = 2;
+};
+
+} // namespace mano
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef MANO_HEADLESS_BATCH_HPP
+#define MANO_HEADLESS_BATCH_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "headless/runner.hpp"
+
+namespace mano::headless {
+
+struct BatchJob {
+    // Assembly source, already normalized by read_source.
+    std::string code;
+    RunOptions options;
+};
+
+struct BatchResult {
+    // Assembler errors, the program was not run when not empty.
+    std::vector<std::string> errors;
+    bool halted = false;
+    bool timed_out = false;
+    std::uint64_t cycles = 0;
+    std::uint16_t ac = 0;
+    bool e = false;
+    std::uint16_t pc = 0;
+    std::string output;
+    // FNV-1a hash of the final memory, see memory_digest.
+    std::uint64_t memory_digest = 0;
+};
+
+/*
+ * 64 bit FNV-1a hash of the memory words, low byte first.
+ * */
+std::uint64_t memory_digest(const Memory& memory);
+
+/*
+ * Assembles and runs a single job on the calling thread.
+ * */
+BatchResult run_job(const BatchJob& job);
+
+/*
+ * Runs every job on its own Emulator across thread_count worker threads,
+ * zero uses one per hardware thread. Jobs are spread over per worker queues
+ * and idle workers steal from the others, so long running programs don't
+ * hold up the rest of the batch.
+ * Results are in the same order as the jobs.
+ * */
+std::vector<BatchResult>
+run_batch(const std::vector<BatchJob>& jobs, std::size_t thread_count = 0);
+
+/*
+ * Runs the same program once per input on LaneEngine groups, spread over
+ * the worker threads like run_batch. Meant for input sweeps where most runs
+ * take the same path through the program.
+ * Results are in the same order as the inputs.
+ * */
+std::vector<BatchResult> run_sweep(
+    const std::string& code,
+    const std::vector<std::string>& inputs,
+    const RunOptions& options,
+    std::size_t thread_count = 0
+);
+
+} // namespace mano::headless
+
+#endif
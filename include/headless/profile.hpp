@@ -0,0 +1,54 @@
+#ifndef MANO_HEADLESS_PROFILE_HPP
+#define MANO_HEADLESS_PROFILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "emulator/assembler.hpp"
+#include "emulator/call_tracker.hpp"
+#include "emulator/profiler.hpp"
+#include "emulator/sampler.hpp"
+
+namespace mano::headless {
+
+/*
+ * Text report of a profile: the instructions that took the most T-states
+ * with their source lines, at most max_lines of them, then the read and
+ * write counts of every memory word that was accessed.
+ * code and lines must be the source and the line table it was assembled
+ * with.
+ * */
+std::string format_profile(
+    const Profiler& profiler,
+    const Assembler::LineTable& lines,
+    std::string_view code,
+    std::size_t max_lines
+);
+
+/*
+ * Text report of the subroutines, the calls and the inclusive and
+ * exclusive T-states of each, the most inclusive T-states first.
+ * */
+std::string format_calls(
+    const CallTracker& tracker,
+    const std::unordered_map<std::uint16_t, std::string>& labels
+);
+
+/*
+ * Text report of a sampling profile: the addresses with the most samples
+ * with their source lines, at most max_lines of them, the share of samples
+ * with interrupts enabled and pending, and the call depth histogram when
+ * it was sampled.
+ * */
+std::string format_samples(
+    const Sampler::Report& samples,
+    const Assembler::LineTable& lines,
+    std::string_view code,
+    std::size_t max_lines
+);
+
+} // namespace mano::headless
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef MANO_HEADLESS_RUNNER_HPP
+#define MANO_HEADLESS_RUNNER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "emulator/devices.hpp"
+#include "emulator/emulator.hpp"
+#include "emulator/lane_engine.hpp"
+
+namespace mano::headless {
+
+struct RunOptions {
+    std::uint64_t cycle_budget = 1'000'000'000;
+    // Wall clock limit, zero disables it.
+    std::chrono::milliseconds timeout{0};
+    Emulator::Engine engine = Emulator::Engine::Native;
+    // Characters fed to INPR, one per INP.
+    std::string input;
+    // T-states the ports take per character, see Devices.
+    std::uint64_t input_latency = 0;
+    std::uint64_t output_latency = 0;
+    // T-states between the timer interrupts, 0 leaves the timer off.
+    std::uint64_t timer_period = 0;
+    // A closed output port leaves FGO clear, for the programs that only
+    //     take the timer interrupts.
+    bool output_open = true;
+    // Interrupt controller of the CPU, see InterruptController.
+    std::uint8_t interrupt_mask = InterruptController::ALL_SOURCES;
+    std::optional<std::uint16_t> vector_base;
+};
+
+struct RunResult {
+    bool halted = false;
+    bool timed_out = false;
+    std::uint64_t cycles = 0;
+    // Every nonzero character written to OUTR.
+    std::string output;
+    // Device statistics and the interrupt timing.
+    Devices::Stats devices;
+    // See Devices::get_input_wait_cycles.
+    std::uint64_t input_wait_cycles = 0;
+    std::uint64_t output_wait_cycles = 0;
+};
+
+/*
+ * Engine from its command line name: instruction, block or native.
+ * */
+std::optional<Emulator::Engine> parse_engine(std::string_view name);
+
+/*
+ * Reads an assembly file and normalizes it the same way the code editor
+ * does, upper case with tabs replaced by 2 spaces.
+ * */
+std::optional<std::string> read_source(const std::string& path);
+
+/*
+ * Runs the emulator until it halts or the cycle budget or the timeout runs
+ * out, with the input and output devices attached. The output device is
+ * ready at the start and the input device holds the next character until
+ * INP consumes it, like the UI terminal.
+ * */
+RunResult run(Emulator& emulator, const RunOptions& options);
+
+/*
+ * Same as run for every lane of the engine, lane i reads inputs[i].
+ * Only the first inputs.size() lanes are run, options.input,
+ * options.engine, the latencies, the timer and the interrupt controller are
+ * ignored, the results have no device statistics.
+ * */
+std::vector<RunResult> run_lanes(
+    LaneEngine& engine,
+    const std::vector<std::string>& inputs,
+    const RunOptions& options
+);
+
+} // namespace mano::headless
+
+#endif
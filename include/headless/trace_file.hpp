@@ -0,0 +1,61 @@
+#ifndef MANO_HEADLESS_TRACE_FILE_HPP
+#define MANO_HEADLESS_TRACE_FILE_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "emulator/trace.hpp"
+
+namespace mano::headless {
+
+/*
+ * Writes the blocks of a TraceRecorder to a file from a background thread.
+ * The recorder fills the next block while the previous one is written
+ * (double buffering), and only waits when the disk falls a whole block
+ * behind.
+ * */
+class TraceFileWriter : public TraceSink {
+  public:
+    explicit TraceFileWriter(const std::string& path);
+    ~TraceFileWriter() override;
+
+    TraceFileWriter(const TraceFileWriter&) = delete;
+    TraceFileWriter& operator=(const TraceFileWriter&) = delete;
+
+    bool is_open() const {
+        return output.is_open();
+    }
+
+    void write(std::vector<std::uint8_t>& block) override;
+
+    /*
+     * Writes the last block and closes the file.
+     * Returns false if any write failed.
+     * */
+    bool close();
+
+  private:
+    void write_blocks();
+
+    std::ofstream output;
+    std::thread writer;
+
+    std::mutex mutex;
+    // Signaled when a block is pending or the file is closing.
+    std::condition_variable ready;
+    // Signaled when the pending block was written.
+    std::condition_variable written;
+    std::vector<std::uint8_t> pending;
+    bool has_pending = false;
+    bool closing = false;
+    bool failed = false;
+};
+
+} // namespace mano::headless
+
+#endif
@@ -9,7 +9,7 @@
 #include <vector>
 
 #include "emulator/cpu.hpp"
-#include "emulator/emulator.hpp"
+#include "emulator/emulator_thread.hpp"
 
 namespace mano::ui {
 
@@ -80,8 +80,10 @@ class Scheme {
   public:
     Scheme(float x, float y, float width, float height);
 
-    void update(Emulator& emulator);
-    void render(Emulator& emulator);
+    // Starts the animations of the T-state the snapshot ended with.
+    void update(const EmulatorThread::Snapshot& snapshot);
+    // Edits to the registers go to the emulator as commands.
+    void render(EmulatorThread& emulator);
 
   private:
     float x;
@@ -1,11 +1,13 @@
 #include <emscripten/html5.h>
 
+#include <algorithm>
 #include <cctype>
-#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <string_view>
 
 #include "imgui.h"
 #include "imgui_impl_opengl3.h"
@@ -90,6 +92,44 @@ CNT, DEC 0
 END)";
 
 static constexpr double DEFAULT_CLOCK_RATE = 2.0;
+static constexpr const char* REGISTER_NAMES[] = {
+    "AR", "PC", "DR", "AC", "IR", "TR", "OUTR", "INPR"
+};
+
+/*
+ * Checkbox of a CPU flag, a click sends the new value to the emulator.
+ * */
+static void flag_checkbox(
+    EmulatorThread& emulator,
+    const char* label,
+    bool value,
+    Condition::Flag flag
+) {
+    if (ImGui::Checkbox(label, &value)) {
+        emulator.send({
+            .kind = EmulatorThread::Command::Kind::SetFlag,
+            .enabled = value,
+            .flag = flag,
+        });
+    }
+}
+
+/*
+ * Characters a port moved, per 1000 T-states too, and the T-states the
+ * program spent polling it.
+ * */
+static void port_stats(
+    std::uint64_t characters,
+    std::uint64_t cycles,
+    std::uint64_t wait_cycles
+) {
+    ImGui::Text(
+        "%llu chars, %.2f/kT, %llu T polled",
+        static_cast<unsigned long long>(characters),
+        Devices::get_rate(characters, cycles),
+        static_cast<unsigned long long>(wait_cycles)
+    );
+}
 
 void main_loop(void* arg) {
     Application* app = static_cast<Application*>(arg);
@@ -102,10 +142,12 @@ void main_loop(void* arg) {
 Application::Application() :
     scheme(FSCREEN_WIDTH * 0.5f, 0, FSCREEN_WIDTH * 0.5f, FSCREEN_HEIGHT),
     input_code(EXAMPLE_CODE),
-    clock_rate(DEFAULT_CLOCK_RATE),
-    clock_period(1.0 / DEFAULT_CLOCK_RATE) {
-    emulator =
-        std::make_unique<Emulator>(assembler.assemble(EXAMPLE_CODE).value());
+    clock_rate(DEFAULT_CLOCK_RATE) {
+    emulator.send({
+        .kind = Command::Kind::SetClockRate,
+        .clock_rate = clock_rate,
+    });
+    load_emulator(assembler.assemble(EXAMPLE_CODE).value());
 }
 
 bool Application::start() {
@@ -213,31 +255,8 @@ bool Application::start() {
     return true;
 }
 
-void Application::cycle_emulator() {
-    if (input_stream_open && !input_stream_string.empty()
-        && !emulator->cpu.fgi) {
-        const auto value = input_stream_string[0];
-        input_stream_string.erase(0, 1);
-
-        emulator->cpu.registers.set(
-            Registers::INPR,
-            static_cast<std::uint8_t>(value)
-        );
-        emulator->cpu.fgi = true;
-    }
-
-    emulator->cycle();
-    scheme.update(*emulator);
-
-    if (!emulator->cpu.fgo) {
-        if (output_stream_open) {
-            const auto value = emulator->cpu.registers.get(Registers::OUTR);
-            if (value != 0) {
-                output_stream_string.push_back(static_cast<char>(value));
-            }
-            emulator->cpu.fgo = true;
-        }
-    }
+void Application::continue_to(std::optional<std::uint16_t> address) {
+    emulator.send({.kind = Command::Kind::Continue, .target = address});
 }
 
 void Application::update() {
@@ -246,24 +265,24 @@ void Application::update() {
         ImGui_ImplSDL2_ProcessEvent(&event);
     }
 
-    if (emulator_running) {
-        std::chrono::steady_clock::time_point now =
-            std::chrono::steady_clock::now();
-        const auto elapsed_microseconds =
-            std::chrono::duration_cast<std::chrono::microseconds>(
-                now - last_frame_tp
-            )
-                .count();
-        elapsed_time += static_cast<double>(elapsed_microseconds) / 1000000.0;
-        last_frame_tp = now;
-        const double cycles = std::round(elapsed_time * clock_rate);
-
-        for (int i = 0; i < static_cast<int>(cycles); ++i) {
-            cycle_emulator();
+    // Runs the emulator for this frame when it has no thread.
+    emulator.poll();
+    if (emulator.update()) {
+        const auto& snapshot = emulator.get_snapshot();
+        if (snapshot.executed != animated_cycles) {
+            animated_cycles = snapshot.executed;
+            scheme.update(snapshot);
+        }
+        // The input only changes as the program reads it or once it's set.
+        if (!input_stream_editing
+            && (snapshot.input_version != shown_input_version
+                || snapshot.input_consumed != shown_input_consumed)) {
+            input_stream_string = snapshot.get_unread_input();
+            shown_input_version = snapshot.input_version;
+            shown_input_consumed = snapshot.input_consumed;
         }
-
-        elapsed_time -= cycles * clock_period;
     }
+    emulator.drain_output(output_stream_string);
 }
 
 void Application::render() {
@@ -274,6 +293,8 @@ void Application::render() {
     ImGui_ImplSDL2_NewFrame();
     ImGui::NewFrame();
 
+    const auto& snapshot = emulator.get_snapshot();
+
     // Get the total screen size
     ImVec2 screen_size = ImGui::GetIO().DisplaySize;
     float quarter_width = screen_size.x * 0.25f;
@@ -318,8 +339,65 @@ void Application::render() {
     if (ImGui::Button("Export")) {
         emscripten_run_script("Module.exportCode && Module.exportCode()");
     }
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Profile", &profiling)) {
+        emulator.send({
+            .kind = Command::Kind::SetProfiling,
+            .enabled = profiling,
+        });
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip(
+            "Counts the instructions and T-states of every line and shows"
+            " the hottest ones."
+        );
+    }
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Calls", &call_tracking)) {
+        emulator.send({
+            .kind = Command::Kind::SetCallTracking,
+            .enabled = call_tracking,
+        });
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip(
+            "Tracks the subroutine calls for Out, every instruction then"
+            " runs on its own."
+        );
+    }
 
     ImGui::EndChild();
+
+    if (snapshot.profiling) {
+        const auto total = static_cast<double>(
+            std::max<std::uint64_t>(snapshot.profile_cycles, 1)
+        );
+        const auto source = Assembler::split_lines(assembled_code);
+        for (const auto [address, cycles] : snapshot.hot_addresses) {
+            const auto line = assembled_lines[address];
+            const auto share = static_cast<double>(cycles) / total;
+            // From white to red as the line takes more of the time.
+            const auto fade = static_cast<float>(1.0 - share);
+            const ImVec4 color(1.0f, fade, fade, 1.0f);
+            if (line == 0 || line > source.size()) {
+                // Executed a word no line assembled.
+                ImGui::TextColored(
+                    color,
+                    "%5.1f%% Address %03x",
+                    share * 100.0,
+                    address
+                );
+                continue;
+            }
+            ImGui::TextColored(
+                color,
+                "%5.1f%% Line %u: %s",
+                share * 100.0,
+                line,
+                std::string(Assembler::trim(source[line - 1])).c_str()
+            );
+        }
+    }
     ImGui::PushFont(code_font);
 
     ImVec2 available = ImGui::GetContentRegionAvail();
@@ -339,9 +417,7 @@ void Application::render() {
     if (code_changed) {
         auto compile_result = assembler.assemble(input_code);
         if (compile_result.has_value()) {
-            emulator =
-                std::make_unique<Emulator>(std::move(compile_result.value()));
-            emulator_running = false;
+            load_emulator(std::move(compile_result.value()));
         }
     }
 
@@ -360,79 +436,271 @@ void Application::render() {
             | ImGuiWindowFlags_NoCollapse
     );
 
-    ImGui::BeginChild("Controls", ImVec2(0, 20), false);
+    ImGui::BeginChild("Controls", ImVec2(0, 92), false);
+    using Mode = EmulatorThread::Mode;
+    const bool emulator_idle = snapshot.mode == Mode::Idle;
     if (ImGui::Button("Step")) {
-        if (!emulator_running) {
-            cycle_emulator();
+        if (emulator_idle) {
+            emulator.send({.kind = Command::Kind::Cycle});
         }
     }
     ImGui::SameLine();
     if (ImGui::Button("Step Big")) {
-        do {
-            cycle_emulator();
-        } while (emulator->cpu.get_sequence_counter() != 0);
+        emulator.send({.kind = Command::Kind::StepBig});
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Over") && emulator_idle) {
+        emulator.send({.kind = Command::Kind::StepOver});
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip(
+            "Steps over the instruction, running a BSA call at full speed."
+        );
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Out") && emulator_idle && call_tracking) {
+        emulator.send({.kind = Command::Kind::StepOut});
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip(
+            "Runs at full speed until the subroutine returns, with Calls"
+            " checked before the call."
+        );
     }
 
     ImGui::SameLine();
 
+    const bool emulator_running = snapshot.mode == Mode::Running;
     if (ImGui::Button(emulator_running ? "Stop" : "Run")) {
-        emulator_running = !emulator_running;
-        if (emulator_running) {
-            last_frame_tp = std::chrono::steady_clock::now();
-        }
+        emulator.send({
+            .kind = emulator_running ? Command::Kind::Stop : Command::Kind::Run,
+        });
     }
 
     ImGui::SameLine();
     ImGui::PushItemWidth(45.0f);
     if (ImGui::InputDouble("Hz", &clock_rate, 0.0, 0.0, "%.2f")) {
-        clock_period = 1.0 / static_cast<double>(clock_rate);
+        emulator.send({
+            .kind = Command::Kind::SetClockRate,
+            .clock_rate = clock_rate,
+        });
     }
     if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
         ImGui::SetTooltip("Clock rate of the CPU in Hertz.");
     }
     ImGui::PopItemWidth();
+
+    if (ImGui::Button("Reverse Step")) {
+        if (emulator_idle) {
+            emulator.send({.kind = Command::Kind::ReverseStep});
+        }
+    }
+    ImGui::SameLine();
+    const bool emulator_reversing = snapshot.mode == Mode::Reversing;
+    const char* reverse_label =
+        emulator_reversing ? "Stop##reverse" : "Reverse Continue";
+    if (ImGui::Button(reverse_label)) {
+        emulator.send({
+            .kind = emulator_reversing ? Command::Kind::Stop
+                                       : Command::Kind::Reverse,
+        });
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip(
+            "Runs backwards at the clock rate until a breakpoint or the start"
+            " of the history."
+        );
+    }
+    ImGui::SameLine();
+    ImGui::Text(
+        "History: %llu",
+        static_cast<unsigned long long>(snapshot.history)
+    );
+
+    const bool emulator_continuing = snapshot.mode == Mode::Continuing;
+    if (ImGui::Button(emulator_continuing ? "Stop##continue" : "Continue")) {
+        if (emulator_continuing) {
+            emulator.send({.kind = Command::Kind::Stop});
+        } else {
+            continue_to({});
+        }
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip(
+            "Runs at full speed until a breakpoint or a watchpoint is hit."
+            " Click the left edge of a memory row to toggle its breakpoint,"
+            " the row to run to it, right click it for the watchpoints."
+        );
+    }
+    ImGui::SameLine();
+    ImGui::PushItemWidth(70.0f);
+    if (ImGui::BeginCombo("Watch", "Registers")) {
+        for (std::size_t reg = 0; reg < Registers::REGISTER_COUNT; ++reg) {
+            bool watched = snapshot.breakpoints.has_register(
+                static_cast<Registers::Id>(reg)
+            );
+            if (ImGui::Checkbox(REGISTER_NAMES[reg], &watched)) {
+                emulator.send({
+                    .kind = Command::Kind::SetBreakpoint,
+                    .address = static_cast<std::uint16_t>(reg),
+                    .enabled = watched,
+                    .breakpoint = Breakpoints::Kind::Register,
+                });
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::PopItemWidth();
+    if (snapshot.breakpoints.hit && snapshot.cpu.break_pending) {
+        const auto& hit = *snapshot.breakpoints.hit;
+        ImGui::SameLine();
+        switch (hit.kind) {
+            case Breakpoints::Kind::Execute:
+                ImGui::Text("Break at %03x", hit.address);
+                break;
+            case Breakpoints::Kind::Read:
+                ImGui::Text("Read %03x", hit.address);
+                break;
+            case Breakpoints::Kind::Write:
+                ImGui::Text("Wrote %03x", hit.address);
+                break;
+            case Breakpoints::Kind::Register:
+                ImGui::Text("%s changed", REGISTER_NAMES[hit.address]);
+                break;
+        }
+    }
+
+    if (ImGui::Checkbox("Max speed", &max_speed)) {
+        emulator.send({
+            .kind = Command::Kind::SetMaxSpeed,
+            .enabled = max_speed,
+        });
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("Run ignores the clock rate and runs at full speed.");
+    }
+    if (!emulator.is_threaded()) {
+        ImGui::SameLine();
+        ImGui::PushItemWidth(70.0f);
+        if (ImGui::InputInt("ms", &frame_budget_ms)) {
+            frame_budget_ms = std::clamp(frame_budget_ms, 1, 100);
+            emulator.send({
+                .kind = Command::Kind::SetFrameBudget,
+                .value = static_cast<std::uint16_t>(frame_budget_ms),
+            });
+        }
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+            ImGui::SetTooltip(
+                "Longest the emulator runs per frame, the rest of the frame"
+                " is left to the UI."
+            );
+        }
+        ImGui::PopItemWidth();
+    }
+    if (snapshot.waiting) {
+        // The full speed modes sleep in an idle loop.
+        const auto& loop = *snapshot.waiting;
+        ImGui::SameLine();
+        if (loop.input && loop.output) {
+            ImGui::Text("Waiting for I/O");
+        } else if (loop.input) {
+            ImGui::Text("Waiting for input");
+        } else if (loop.output) {
+            ImGui::Text("Waiting for output");
+        } else {
+            ImGui::Text("Looping forever");
+        }
+    } else if (snapshot.mode != Mode::Idle) {
+        ImGui::SameLine();
+        ImGui::Text("%.3f MHz", snapshot.achieved_rate / 1e6);
+    }
     ImGui::EndChild();
     ImGui::BeginChild("MemoryView", ImVec2(0, 0), true);
 
     for (std::size_t i = 0; i < MEMORY_SIZE; ++i) {
-        auto opcode = emulator->get_memory()[i];
+        auto opcode = snapshot.memory[i];
         std::string_view mnemonic = "";
         std::string address = "";
         std::string_view indirect = "";
 
         if (opcode != 0xFFFF) {
-            if (auto instruction = Instruction::from_opcode(opcode)) {
-                mnemonic = instruction->mnemonic;
-                if (instruction->mri) {
-                    address = std::format("{:03x}", instruction->get_address());
-                }
-                if (instruction->is_indirect()) {
+            const Instr instr = Instruction::decode(opcode);
+            mnemonic = Instruction::from_instr(instr).mnemonic;
+            if (Instruction::is_mri(instr)) {
+                address = std::format("{:03x}", opcode & 0x0FFF);
+                if ((opcode & 0x8000) != 0) {
                     indirect = "I";
                 }
-            } else {
-                mnemonic = "Undefined";
             }
         }
 
-        auto pc = emulator->cpu.registers.get(Registers::PC);
-        if (emulator->cpu.get_sequence_counter() >= 2) {
+        auto pc = snapshot.cpu.registers.get(Registers::PC);
+        if (snapshot.cpu.get_sequence_counter() >= 2) {
             pc -= 1;
         }
 
+        const auto word = static_cast<std::uint16_t>(i);
+        const auto& breakpoints = snapshot.breakpoints;
+        const bool has_break = breakpoints.has_breakpoint(word);
+        const bool watch_read = breakpoints.has_read(word);
+        const bool watch_write = breakpoints.has_write(word);
+
         if (i == pc) {
             ImGui::PushStyleColor(
                 ImGuiCol_Text,
                 ImVec4(1.0f, 0.0f, 0.0f, 1.0f)
             );
         }
-        ImGui::Text(
-            "%03zx:  %04x      %s %s %s",
+        ImGui::PushID(static_cast<int>(i));
+        // The gutter toggles the breakpoint, the rest of the row runs to it.
+        const auto marks = std::format(
+            "{}{}{}##gutter",
+            has_break ? 'B' : ' ',
+            watch_read ? 'R' : ' ',
+            watch_write ? 'W' : ' '
+        );
+        if (ImGui::Selectable(marks.c_str(), has_break, 0, ImVec2(24.0f, 0))) {
+            emulator.send({
+                .kind = Command::Kind::SetBreakpoint,
+                .address = word,
+                .enabled = !has_break,
+            });
+        }
+        ImGui::SameLine();
+        const auto row = std::format(
+            "{:03x}:  {:04x}      {} {} {}",
             i,
             opcode,
-            mnemonic.data(),
-            address.data(),
-            indirect.data()
+            mnemonic,
+            address,
+            indirect
         );
+        if (ImGui::Selectable(row.c_str(), false) && emulator_idle) {
+            continue_to(word);
+        }
+        if (ImGui::BeginPopupContextItem()) {
+            bool value = watch_read;
+            if (ImGui::Checkbox("Watch reads", &value)) {
+                emulator.send({
+                    .kind = Command::Kind::SetBreakpoint,
+                    .address = word,
+                    .enabled = value,
+                    .breakpoint = Breakpoints::Kind::Read,
+                });
+            }
+            value = watch_write;
+            if (ImGui::Checkbox("Watch writes", &value)) {
+                emulator.send({
+                    .kind = Command::Kind::SetBreakpoint,
+                    .address = word,
+                    .enabled = value,
+                    .breakpoint = Breakpoints::Kind::Write,
+                });
+            }
+            render_breakpoint_rule(word);
+            ImGui::EndPopup();
+        }
+        ImGui::PopID();
         if (i == pc) {
             ImGui::PopStyleColor();
         }
@@ -452,22 +720,55 @@ void Application::render() {
             | ImGuiWindowFlags_NoCollapse
     );
     ImGui::BeginChild("Controls", ImVec2(0, 20), false);
-    ImGui::Checkbox("Open", &input_stream_open);
+    if (ImGui::Checkbox("Open", &input_stream_open)) {
+        emulator.send({
+            .kind = Command::Kind::SetInputOpen,
+            .enabled = input_stream_open,
+        });
+    }
     if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
         ImGui::SetTooltip(
             "Input stream will start reading characters when its open."
         );
     }
     ImGui::SameLine();
+    bool input_changed = false;
     if (ImGui::Button("Clear")) {
         input_stream_string.clear();
+        input_changed = true;
+    }
+    ImGui::SameLine();
+    ImGui::PushItemWidth(60.0f);
+    if (ImGui::InputInt("T##input_latency", &input_latency, 0)) {
+        input_latency = std::clamp(input_latency, 0, 65535);
+        emulator.send({
+            .kind = Command::Kind::SetInputLatency,
+            .value = static_cast<std::uint16_t>(input_latency),
+        });
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("T-states from INP to the next character in INPR.");
     }
+    ImGui::PopItemWidth();
     ImGui::EndChild();
 
-    ImGui::InputTextMultiline(
+    input_changed |= ImGui::InputTextMultiline(
         "##input",
         &input_stream_string,
-        ImVec2(small_window_width - 15, quarter_height - 60)
+        ImVec2(small_window_width - 15, quarter_height - 80)
+    );
+    input_stream_editing = ImGui::IsItemActive();
+    if (input_changed) {
+        emulator.send({
+            .kind = Command::Kind::SetInput,
+            .text = input_stream_string,
+            .consumed = snapshot.input_consumed,
+        });
+    }
+    port_stats(
+        snapshot.device_stats.input_characters,
+        snapshot.device_cycles,
+        Devices::get_input_wait_cycles(snapshot.cpu)
     );
 
     // Add more instruction content here
@@ -487,7 +788,10 @@ void Application::render() {
 
     ImGui::BeginChild("Controls", ImVec2(0, 20), false);
     if (ImGui::Checkbox("Open", &output_stream_open)) {
-        emulator->cpu.fgo = output_stream_open;
+        emulator.send({
+            .kind = Command::Kind::SetOutputOpen,
+            .enabled = output_stream_open,
+        });
     }
     if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
         ImGui::SetTooltip(
@@ -498,14 +802,32 @@ void Application::render() {
     if (ImGui::Button("Clear")) {
         output_stream_string.clear();
     }
+    ImGui::SameLine();
+    ImGui::PushItemWidth(60.0f);
+    if (ImGui::InputInt("T##output_latency", &output_latency, 0)) {
+        output_latency = std::clamp(output_latency, 0, 65535);
+        emulator.send({
+            .kind = Command::Kind::SetOutputLatency,
+            .value = static_cast<std::uint16_t>(output_latency),
+        });
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("T-states from OUT until FGO is set again.");
+    }
+    ImGui::PopItemWidth();
     ImGui::EndChild();
 
     ImGui::InputTextMultiline(
         "##output",
         &output_stream_string,
-        ImVec2(small_window_width - 15, quarter_height - 60),
+        ImVec2(small_window_width - 15, quarter_height - 80),
         ImGuiInputTextFlags_ReadOnly
     );
+    port_stats(
+        snapshot.device_stats.output_characters,
+        snapshot.device_cycles,
+        Devices::get_output_wait_cycles(snapshot.cpu)
+    );
 
     // Add more instruction content here
     ImGui::End();
@@ -521,28 +843,114 @@ void Application::render() {
         ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove
             | ImGuiWindowFlags_NoCollapse
     );
-    ImGui::Text("Cycle: %s", emulator->cpu.get_cycle_name().data());
-    ImGui::Checkbox("S", &emulator->cpu.start_stop);
+    const auto& cpu = snapshot.cpu;
+    ImGui::Text("Cycle: %s", cpu.get_cycle_name().data());
+    flag_checkbox(emulator, "S", cpu.start_stop, Condition::Flag::S);
     ImGui::SameLine();
-    ImGui::Checkbox("I", &emulator->cpu.indirect);
+    flag_checkbox(emulator, "I", cpu.indirect, Condition::Flag::I);
 
-    ImGui::Checkbox("FGI", &emulator->cpu.fgi);
+    flag_checkbox(emulator, "FGI", cpu.fgi, Condition::Flag::FGI);
+    ImGui::SameLine();
+    flag_checkbox(emulator, "FGO", cpu.fgo, Condition::Flag::FGO);
+    ImGui::SameLine();
+    flag_checkbox(emulator, "FGT", cpu.fgt, Condition::Flag::FGT);
+    flag_checkbox(emulator, "IEN", cpu.ien, Condition::Flag::IEN);
     ImGui::SameLine();
-    ImGui::Checkbox("FGO", &emulator->cpu.fgo);
+    flag_checkbox(emulator, "R", cpu.r, Condition::Flag::R);
+
+    ImGui::PushItemWidth(60.0f);
+    if (ImGui::InputInt("Timer T", &timer_period, 0)) {
+        timer_period = std::clamp(timer_period, 0, 65535);
+        emulator.send({
+            .kind = Command::Kind::SetTimerPeriod,
+            .value = static_cast<std::uint16_t>(timer_period),
+        });
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip("T-states between the timer ticks setting FGT.");
+    }
+    ImGui::PopItemWidth();
     ImGui::SameLine();
-    ImGui::Checkbox("IEN", &emulator->cpu.ien);
-    ImGui::Checkbox("R", &emulator->cpu.r);
+    const auto send_vectored = [&] {
+        vector_base = std::clamp(vector_base, 0, 0xFFF);
+        emulator.send({
+            .kind = Command::Kind::SetVectored,
+            .address = static_cast<std::uint16_t>(vector_base),
+            .enabled = vectored,
+        });
+    };
+    if (ImGui::Checkbox("Vectors", &vectored)) {
+        send_vectored();
+    }
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip(
+            "Interrupts save PC at the vector of their source, read from"
+            " the table at the address, instead of at 0."
+        );
+    }
+    ImGui::SameLine();
+    ImGui::PushItemWidth(40.0f);
+    if (ImGui::InputInt(
+            "##vector_base",
+            &vector_base,
+            0,
+            0,
+            ImGuiInputTextFlags_CharsHexadecimal
+        )) {
+        send_vectored();
+    }
+    ImGui::PopItemWidth();
 
-    ImGui::Text("Instruction: %s", emulator->cpu.instruction.mnemonic.data());
-    ImGui::TextWrapped(
-        "Description: %s",
-        emulator->cpu.instruction.description.data()
-    );
+    // Mask register, and the latency and service time of every source.
+    const auto& devices = snapshot.device_stats;
+    const auto average = [](std::uint64_t total, std::uint64_t count) {
+        return count == 0 ? 0.0
+                          : static_cast<double>(total)
+                                / static_cast<double>(count);
+    };
+    for (std::size_t i = 0; i < InterruptController::SOURCE_COUNT; ++i) {
+        const auto source = static_cast<InterruptController::Source>(i);
+        const auto bit = InterruptController::get_bit(source);
+        const auto name = InterruptController::get_name(source);
+        bool enabled = (cpu.interrupts.mask & bit) != 0;
+        ImGui::PushID(static_cast<int>(i));
+        if (ImGui::Checkbox(name.data(), &enabled)) {
+            emulator.send({
+                .kind = Command::Kind::SetInterruptMask,
+                .value = static_cast<std::uint16_t>(
+                    enabled ? cpu.interrupts.mask | bit
+                            : cpu.interrupts.mask & ~bit
+                ),
+            });
+        }
+        ImGui::PopID();
+        const auto& timing = devices.interrupts[i];
+        if (timing.interrupts != 0) {
+            ImGui::SameLine();
+            ImGui::Text(
+                "%llu, %.1f T late, %.1f T",
+                static_cast<unsigned long long>(timing.interrupts),
+                average(timing.latency_cycles, timing.interrupts),
+                average(timing.service_cycles, timing.services)
+            );
+        }
+    }
+    if (devices.timer_ticks != 0) {
+        ImGui::Text(
+            "%llu ticks, %llu missed",
+            static_cast<unsigned long long>(devices.timer_ticks),
+            static_cast<unsigned long long>(devices.missed_ticks)
+        );
+    }
+
+    const auto& instruction = Instruction::from_instr(cpu.instruction);
+    ImGui::Text("Instruction: %s", instruction.mnemonic.data());
+    ImGui::TextWrapped("Description: %s", instruction.description.data());
 
     // Add more instruction content here
     ImGui::End();
 
-    scheme.render(*emulator);
+    scheme.render(emulator);
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -576,9 +984,83 @@ void Application::set_code(const std::string& code) {
 
     auto compile_result = assembler.assemble(input_code);
     if (compile_result.has_value()) {
-        emulator =
-            std::make_unique<Emulator>(std::move(compile_result.value()));
-        emulator_running = false;
+        load_emulator(std::move(compile_result.value()));
+    }
+}
+
+void Application::load_emulator(Emulator&& assembled) {
+    auto loaded = std::make_unique<Emulator>(std::move(assembled));
+    loaded->set_journal(true);
+    loaded->set_profiling(profiling);
+    loaded->set_call_tracking(call_tracking);
+    // Continue and the steps over and out run on the basic blocks, wasm
+    //     can't generate code. Run and Step go through cycle either way.
+    loaded->set_engine(Emulator::Engine::BasicBlock);
+    emulator.send({.kind = Command::Kind::Load, .emulator = std::move(loaded)});
+    assembled_code = input_code;
+    assembled_lines = assembler.get_line_table();
+    assembled_labels = assembler.get_labels();
+}
+
+void Application::render_breakpoint_rule(std::uint16_t address) {
+    const auto* rule = emulator.get_snapshot().breakpoints.get_rule(
+        Breakpoints::Kind::Execute,
+        address
+    );
+    if (ImGui::IsWindowAppearing()) {
+        condition_input =
+            rule && rule->condition ? rule->condition->get_source() : "";
+        condition_stop_hits =
+            rule ? static_cast<int>(rule->stop_hits) : 1;
+        condition_error.clear();
+    }
+
+    ImGui::Separator();
+    ImGui::PushItemWidth(160.0f);
+    ImGui::InputText("Condition", &condition_input);
+    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+        ImGui::SetTooltip(
+            "Stops only when it holds, like AC == 0x10 && M[SUM] > 5."
+            " Empty always stops."
+        );
+    }
+    ImGui::InputInt("Stop at hit", &condition_stop_hits);
+    ImGui::PopItemWidth();
+    condition_stop_hits = std::max(condition_stop_hits, 1);
+
+    if (ImGui::Button("Set breakpoint")) {
+        Breakpoints::Rule new_rule;
+        new_rule.stop_hits = static_cast<std::uint64_t>(condition_stop_hits);
+        bool valid = true;
+        if (condition_input.find_first_not_of(' ') != std::string::npos) {
+            ConditionCompiler compiler;
+            new_rule.condition =
+                compiler.compile(condition_input, assembled_labels);
+            condition_error = compiler.get_error();
+            valid = new_rule.condition.has_value();
+        }
+        if (valid) {
+            condition_error.clear();
+            emulator.send({
+                .kind = Command::Kind::SetBreakpointRule,
+                .address = address,
+                .rule = std::move(new_rule),
+            });
+        }
+    }
+    if (rule) {
+        ImGui::SameLine();
+        ImGui::Text(
+            "Hits: %llu",
+            static_cast<unsigned long long>(rule->hits)
+        );
+    }
+    if (!condition_error.empty()) {
+        ImGui::TextColored(
+            ImVec4(1.0f, 0.0f, 0.0f, 1.0f),
+            "%s",
+            condition_error.c_str()
+        );
     }
 }
 
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <optional>
 #include <string_view>
+#include <vector>
 
 #include "emulator/instructions.hpp"
 
@@ -265,6 +266,7 @@ bool Assembler::second_pass() {
                 return false;
             }
 
+            line_table[lc] = static_cast<std::uint32_t>(current_line);
             lc += 1;
         }
 
@@ -276,12 +278,21 @@ bool Assembler::second_pass() {
     return true;
 }
 
+std::unordered_map<std::uint16_t, std::string> Assembler::get_labels() const {
+    std::unordered_map<std::uint16_t, std::string> labels;
+    for (const auto& [name, symbol] : symbol_table) {
+        labels.emplace(symbol.lc, name);
+    }
+    return labels;
+}
+
 std::optional<Emulator> Assembler::assemble(const std::string_view code_str) {
     // Reset the state.
     symbol_table.clear();
     errors.clear();
 
     memory.fill(0xFFFF);
+    line_table.fill(0);
 
     code = code_str;
     index = 0;
@@ -297,4 +308,29 @@ std::optional<Emulator> Assembler::assemble(const std::string_view code_str) {
     return Emulator {memory};
 }
 
+std::vector<std::string_view> Assembler::split_lines(std::string_view code) {
+    std::vector<std::string_view> result;
+    while (!code.empty()) {
+        const auto end = code.find('\n');
+        auto line = code.substr(0, end);
+        if (line.ends_with('\r')) {
+            line.remove_suffix(1);
+        }
+        result.push_back(line);
+        if (end == std::string_view::npos) {
+            break;
+        }
+        code.remove_prefix(end + 1);
+    }
+    return result;
+}
+
+std::string_view Assembler::trim(std::string_view text) {
+    const auto start = text.find_first_not_of(" \t");
+    if (start == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(start, text.find_last_not_of(" \t") - start + 1);
+}
+
 } // namespace mano
@@ -0,0 +1,299 @@
+#include "emulator/block_cache.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "emulator/bus.hpp"
+#include "emulator/cpu.hpp"
+#include "emulator/instructions.hpp"
+
+namespace mano {
+
+/*
+ * Whether the instruction can change the control flow or the flags
+ * that raise an interrupt.
+ * */
+static constexpr bool ends_block(Instr instr) {
+    switch (instr) {
+        case Instr::BUN:
+        case Instr::BSA:
+        case Instr::ISZ:
+        case Instr::SPA:
+        case Instr::SNA:
+        case Instr::SZA:
+        case Instr::SZE:
+        case Instr::HLT:
+        case Instr::INP:
+        case Instr::OUT:
+        case Instr::SKI:
+        case Instr::SKO:
+        case Instr::ION:
+        case Instr::IOF:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Whether the native code can run the instruction.
+ * */
+static constexpr bool is_translatable(Instr instr) {
+    switch (instr) {
+        case Instr::INP:
+        case Instr::OUT:
+        case Instr::SKI:
+        case Instr::SKO:
+        case Instr::ION:
+        case Instr::IOF:
+        case Instr::Undefined:
+            return false;
+        default:
+            return true;
+    }
+}
+
+/*
+ * Stops at the execution breakpoint of the instruction about to run, blocks
+ * end before every breakpoint so only the instruction boundaries between
+ * dispatches are checked.
+ * */
+static void check_breakpoint(Cpu& cpu, Bus& bus) {
+    if (!bus.breakpoints || cpu.break_pending
+        || cpu.get_sequence_counter() != 0 || cpu.r) {
+        return;
+    }
+    const auto pc = cpu.registers.get(Registers::PC);
+    if (bus.breakpoints->has_execute(pc)
+        && bus.breakpoints->check(Breakpoints::Kind::Execute, pc, cpu, bus)) {
+        cpu.break_pending = true;
+    }
+}
+
+std::size_t BlockCache::run(Cpu& cpu, Bus& bus, std::size_t cycle_budget) {
+    // The native code reads memory without the read watchpoints, and keeps
+    //     the registers the watchpoint conditions read to itself.
+    const bool run_native_code = translate
+        && !(bus.breakpoints
+             && (bus.breakpoints->has_read_watchpoints()
+                 || bus.breakpoints->has_watch_conditions()));
+    std::size_t cycles = 0;
+    while (cycles < cycle_budget && cpu.start_stop && !cpu.io_pending
+           && !cpu.interrupts.stamp_pending && !cpu.break_pending) {
+        // Blocks assume the interrupt flag can't be raised in the middle.
+        if (cpu.r || cpu.get_sequence_counter() != 0
+            || cpu.has_interrupt_request()) {
+            cycles += cpu.step_instruction(bus);
+            check_breakpoint(cpu, bus);
+            continue;
+        }
+
+        const auto address = cpu.registers.get(Registers::PC);
+        auto& block = get_block(address, bus);
+        if (block.operations.empty()) {
+            // Undefined opcode.
+            cycles += cpu.step_instruction(bus);
+            check_breakpoint(cpu, bus);
+            continue;
+        }
+
+        if (run_native_code && block.native_length != 0
+            && cycles + block.native_cycles <= cycle_budget) {
+            if (!block.native && ++block.runs >= HOT_RUNS) {
+                translate_block(block, address, bus);
+            }
+            if (block.native) {
+                // Leaves at the first instruction it can't run, which starts
+                //     a block of its own.
+                cycles = run_native(
+                    cpu,
+                    bus,
+                    block.native,
+                    cycles,
+                    cycle_budget
+                );
+                check_breakpoint(cpu, bus);
+                continue;
+            }
+        }
+
+        const auto invalidations = invalidation_count;
+        for (std::size_t index = 0; index < block.operations.size()
+                                    && invalidations == invalidation_count
+                                    && cycles < cycle_budget
+                                    && !cpu.break_pending;
+             ++index) {
+            const auto operation = block.operations[index];
+            cycles += cpu.execute(bus, operation.ir, operation.instr);
+        }
+        check_breakpoint(cpu, bus);
+    }
+    return cycles;
+}
+
+namespace {
+
+// What the write handler of the native code needs besides the bus.
+struct NativeContext {
+    Cpu* cpu;
+    Bus* bus;
+    const std::size_t* invalidation_count;
+    std::size_t invalidations;
+};
+
+} // namespace
+
+std::size_t BlockCache::run_native(
+    Cpu& cpu,
+    Bus& bus,
+    NativeCode::Block native,
+    std::size_t cycles,
+    std::size_t cycle_budget
+) {
+    NativeContext context{&cpu, &bus, &invalidation_count, invalidation_count};
+    NativeCode::State state{
+        bus.get_memory().get_pages(),
+        &context,
+        nullptr,
+        cycles,
+        cycle_budget,
+        cpu.registers.get(Registers::AC),
+        cpu.registers.get(Registers::DR),
+        cpu.registers.get(Registers::AR),
+        cpu.registers.get(Registers::PC),
+        cpu.registers.get(Registers::IR),
+        static_cast<std::uint8_t>(cpu.alu.e),
+    };
+    // The blocks may be dropped by the time it returns, only the state is
+    //     left to go by.
+    native_code.run(state, native);
+
+    const auto instr = Instruction::decode(state.ir);
+    cpu.registers.set(Registers::AC, state.ac);
+    cpu.registers.set(Registers::DR, state.dr);
+    cpu.registers.set(Registers::AR, state.ar);
+    cpu.registers.set(Registers::PC, state.pc);
+    cpu.registers.set(Registers::IR, state.ir);
+    cpu.alu.e = state.e != 0;
+    cpu.start_stop = instr != Instr::HLT;
+    cpu.indirect = static_cast<bool>(state.ir >> 15);
+    cpu.instruction = instr;
+    return state.cycles;
+}
+
+bool BlockCache::write_native(
+    NativeCode::State* state,
+    std::uint32_t address,
+    std::uint32_t value
+) {
+    const auto& context = *static_cast<NativeContext*>(state->context);
+    context.bus->write(
+        static_cast<std::uint16_t>(address),
+        static_cast<std::uint16_t>(value)
+    );
+    // Stop if the instruction wrote into a cached block, it might be this
+    //     one, or hit a watchpoint.
+    return *context.invalidation_count != context.invalidations
+           || context.cpu->break_pending;
+}
+
+void BlockCache::translate_block(
+    Block& block,
+    std::uint16_t address,
+    Bus& bus
+) {
+    std::array<std::uint16_t, MAX_BLOCK_LENGTH> words{};
+    for (std::size_t i = 0; i < block.native_length; ++i) {
+        words[i] = block.operations[i].ir;
+    }
+    const std::span<const std::uint16_t> translated(
+        words.data(),
+        block.native_length
+    );
+    block.native = native_code.translate(address, translated);
+    if (!block.native) {
+        // The arena is full, start over with the blocks that are still hot.
+        for (auto& cached : blocks) {
+            cached.native = nullptr;
+        }
+        native_code.clear();
+        block.native = native_code.translate(address, translated);
+    }
+    if (!block.native) {
+        // No memory for the code at all.
+        translate = false;
+        return;
+    }
+    // The breakpoint has to be checked before the block runs.
+    if (!bus.breakpoints || !bus.breakpoints->has_execute(address)) {
+        native_code.link(address, block.native);
+    }
+}
+
+void BlockCache::drop_blocks(std::uint16_t address) {
+    const std::size_t first =
+        address >= MAX_BLOCK_LENGTH ? address - MAX_BLOCK_LENGTH + 1 : 0;
+    for (std::size_t start = first; start <= address; ++start) {
+        if (start + blocks[start].operations.size() > address) {
+            drop(static_cast<std::uint16_t>(start));
+        }
+    }
+    invalidation_count += 1;
+}
+
+void BlockCache::clear() {
+    for (auto& block : blocks) {
+        block = {};
+    }
+    native_code.clear();
+    coverage.fill(0);
+    invalidation_count += 1;
+}
+
+BlockCache::Block& BlockCache::get_block(std::uint16_t address, Bus& bus) {
+    auto& block = blocks[address];
+    if (!block.operations.empty()) {
+        return block;
+    }
+
+    bool translatable = true;
+    for (std::size_t i = address;
+         i < MEMORY_SIZE && block.operations.size() < MAX_BLOCK_LENGTH;
+         ++i) {
+        if (i != address && bus.breakpoints
+            && bus.breakpoints->has_execute(static_cast<std::uint16_t>(i))) {
+            // Starts a block of its own.
+            break;
+        }
+        const auto ir = bus.fetch(static_cast<std::uint16_t>(i));
+        const auto instr = Instruction::decode(ir);
+        if (instr == Instr::Undefined) {
+            // Leave it to the Cpu, it keeps the previous decode.
+            break;
+        }
+        block.operations.push_back({ir, instr});
+        coverage[i] += 1;
+
+        translatable = translatable && is_translatable(instr);
+        if (translatable) {
+            block.native_length += 1;
+            block.native_cycles += Instruction::get_cycle_count(instr);
+        }
+        if (ends_block(instr)) {
+            break;
+        }
+    }
+    return block;
+}
+
+void BlockCache::drop(std::uint16_t start) {
+    auto& block = blocks[start];
+    for (std::size_t i = 0; i < block.operations.size(); ++i) {
+        coverage[start + i] -= 1;
+    }
+    native_code.link(start, nullptr);
+    block = {};
+}
+
+} // namespace mano
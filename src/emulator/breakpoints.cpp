@@ -0,0 +1,144 @@
+#include "emulator/breakpoints.hpp"
+
+#include "emulator/bus.hpp"
+
+namespace mano {
+
+void Breakpoints::set(Kind kind, std::uint16_t address, bool enabled) {
+    version += 1;
+    if (!enabled && rules.erase(get_key(kind, address)) != 0) {
+        count_watch_conditions();
+    }
+    switch (kind) {
+        case Kind::Execute:
+            breakpoints[address % MEMORY_SIZE] = enabled;
+            execute[address % MEMORY_SIZE] =
+                enabled || is_temporary(address % MEMORY_SIZE);
+            break;
+        case Kind::Read:
+            read[address % MEMORY_SIZE] = enabled;
+            break;
+        case Kind::Write:
+            write[address % MEMORY_SIZE] = enabled;
+            break;
+        case Kind::Register:
+        {
+            if (address >= Registers::REGISTER_COUNT) {
+                break;
+            }
+            const auto bit = static_cast<std::uint8_t>(1u << address);
+            if (enabled) {
+                watched_registers |= bit;
+            } else {
+                watched_registers &= static_cast<std::uint8_t>(~bit);
+            }
+            break;
+        }
+    }
+}
+
+void Breakpoints::set_temporary(
+    std::optional<std::uint16_t> address,
+    std::optional<std::uint16_t> second
+) {
+    version += 1;
+    for (auto& target : temporary) {
+        if (target) {
+            execute[*target] = breakpoints[*target];
+        }
+    }
+    temporary = {address, second};
+    for (auto& target : temporary) {
+        if (target) {
+            *target &= 0xFFF;
+            execute[*target] = true;
+        }
+    }
+}
+
+void Breakpoints::set_rule(Kind kind, std::uint16_t address, Rule rule) {
+    version += 1;
+    rules[get_key(kind, address)] = std::move(rule);
+    count_watch_conditions();
+}
+
+const Breakpoints::Rule*
+Breakpoints::get_rule(Kind kind, std::uint16_t address) const {
+    const auto rule = rules.find(get_key(kind, address));
+    return rule != rules.end() ? &rule->second : nullptr;
+}
+
+bool Breakpoints::check(
+    Kind kind,
+    std::uint16_t address,
+    const Cpu& cpu,
+    const Bus& bus
+) {
+    if (kind == Kind::Execute && is_temporary(address)) {
+        stop(Hit{kind, address});
+        return true;
+    }
+    auto& rule = rules[get_key(kind, address)];
+    if (rule.condition && !rule.condition->evaluate(cpu, bus)) {
+        return false;
+    }
+    rule.hits += 1;
+    version += 1;
+    if (rule.hits < rule.stop_hits) {
+        return false;
+    }
+    stop(Hit{kind, address});
+    return true;
+}
+
+void Breakpoints::stop(Hit stop_hit) {
+    version += 1;
+    hit = stop_hit;
+    set_temporary({});
+}
+
+void Breakpoints::snapshot_registers(const Registers& registers) {
+    for (std::size_t reg = 0; reg < Registers::REGISTER_COUNT; ++reg) {
+        register_values[reg] = registers.get(reg);
+    }
+}
+
+std::optional<Registers::Id> Breakpoints::find_register_change(
+    const Registers& registers
+) {
+    std::optional<Registers::Id> changed;
+    for (std::size_t reg = 0; reg < Registers::REGISTER_COUNT; ++reg) {
+        const auto value = registers.get(reg);
+        if (!changed && has_register(static_cast<Registers::Id>(reg))
+            && value != register_values[reg]) {
+            changed = static_cast<Registers::Id>(reg);
+        }
+        register_values[reg] = value;
+    }
+    return changed;
+}
+
+void Breakpoints::clear() {
+    version += 1;
+    execute.reset();
+    breakpoints.reset();
+    temporary = {};
+    read.reset();
+    write.reset();
+    watched_registers = 0;
+    rules.clear();
+    watch_conditions = 0;
+    hit.reset();
+}
+
+void Breakpoints::count_watch_conditions() {
+    watch_conditions = 0;
+    for (const auto& [key, rule] : rules) {
+        const auto kind = static_cast<Kind>(key >> 16);
+        if ((kind == Kind::Read || kind == Kind::Write) && rule.condition) {
+            watch_conditions += 1;
+        }
+    }
+}
+
+} // namespace mano
@@ -8,11 +8,15 @@
 namespace mano {
 
 void Bus::read_memory() {
-    memory_io = memory[cpu.registers.get(Registers::AR)];
+    memory_io = read(cpu.registers.get(Registers::AR));
+}
+
+void Bus::fetch_memory() {
+    memory_io = fetch(cpu.registers.get(Registers::AR));
 }
 
 void Bus::write_memory() {
-    memory[cpu.registers.get(Registers::AR)] = memory_io;
+    write(cpu.registers.get(Registers::AR), memory_io);
 }
 
 void Bus::load(Selection dest, Selection source) {
@@ -76,4 +80,9 @@ void Bus::load(Selection dest, Selection source) {
     last_source = source;
     transfer_value = value;
 }
+void Bus::watch_hit(Breakpoints::Kind kind, std::uint16_t address) {
+    if (breakpoints->check(kind, address, cpu, *this)) {
+        cpu.break_pending = true;
+    }
+}
 } // namespace mano
@@ -0,0 +1,163 @@
+#include "emulator/call_tracker.hpp"
+
+#include <format>
+
+#include "emulator/cpu.hpp"
+#include "emulator/instructions.hpp"
+
+namespace mano {
+
+CallTracker::CallTracker() {
+    clear();
+}
+
+void CallTracker::begin(const Cpu& cpu) {
+    if (cpu.get_sequence_counter() != 0 || !cpu.start_stop) {
+        return;
+    }
+    in_instruction = true;
+    interrupt = cpu.r;
+    pc = cpu.registers.get(Registers::PC);
+    instruction_cycles = 0;
+}
+
+void CallTracker::end(const Cpu& cpu, std::size_t dispatch_cycles) {
+    if (!in_instruction) {
+        return;
+    }
+    cycles += dispatch_cycles;
+    instruction_cycles += dispatch_cycles;
+    if (cpu.get_sequence_counter() != 0) {
+        return;
+    }
+    in_instruction = false;
+
+    root.inclusive_cycles += instruction_cycles;
+    if (stack.empty()) {
+        root.exclusive_cycles += instruction_cycles;
+        paths.front().cycles += instruction_cycles;
+    } else {
+        get_totals(stack.back()).exclusive_cycles += instruction_cycles;
+        paths[stack.back().path].cycles += instruction_cycles;
+    }
+
+    if (interrupt) {
+        // RT1: M[0] <- PC
+        call(0, pc, true);
+        return;
+    }
+    if (cpu.instruction == Instr::BSA) {
+        // AR is past the return word.
+        const auto ar = cpu.registers.get(Registers::AR);
+        call(
+            static_cast<std::uint16_t>((ar - 1) & 0xFFF),
+            static_cast<std::uint16_t>((pc + 1) & 0xFFF),
+            false
+        );
+    } else if (cpu.instruction == Instr::BUN && cpu.indirect) {
+        // The pointer is IR(0 ~ 11), or PC for an undefined opcode that
+        //     kept the AR of the fetch.
+        const auto ir = cpu.registers.get(Registers::IR);
+        const auto pointer = Instruction::decode(ir) != Instr::Undefined
+                                 ? static_cast<std::uint16_t>(ir & 0xFFF)
+                                 : pc;
+        for (std::size_t frame = stack.size(); frame-- > 0;) {
+            if (stack[frame].subroutine == pointer) {
+                ret(frame);
+                break;
+            }
+        }
+    }
+}
+
+void CallTracker::clear() {
+    stack.clear();
+    subroutines.fill({});
+    root = {};
+    active.fill(0);
+    paths.assign(1, Path{0, 0, false, 0});
+    children.clear();
+    cycles = 0;
+    in_instruction = false;
+}
+
+std::string CallTracker::get_folded_stacks(
+    const std::unordered_map<std::uint16_t, std::string>& labels
+) const {
+    const auto get_name = [&](const Path& path) -> std::string {
+        if (path.interrupt) {
+            return "interrupt";
+        }
+        if (const auto label = labels.find(path.subroutine);
+            label != labels.end()) {
+            return label->second;
+        }
+        return std::format("{:03x}", path.subroutine);
+    };
+
+    std::string folded;
+    std::vector<std::uint32_t> names;
+    for (std::uint32_t index = 0; index < paths.size(); ++index) {
+        if (paths[index].cycles == 0) {
+            continue;
+        }
+        names.clear();
+        for (auto path = index; path != 0; path = paths[path].parent) {
+            names.push_back(path);
+        }
+        folded += "main";
+        for (auto name = names.rbegin(); name != names.rend(); ++name) {
+            folded += ';' + get_name(paths[*name]);
+        }
+        folded += std::format(" {}\n", paths[index].cycles);
+    }
+    return folded;
+}
+
+void CallTracker::call(
+    std::uint16_t subroutine,
+    std::uint16_t return_address,
+    bool is_interrupt
+) {
+    if (stack.size() >= MAX_DEPTH) {
+        return;
+    }
+    const auto parent = stack.empty() ? 0 : stack.back().path;
+    const auto key = (static_cast<std::uint64_t>(parent) << 16)
+                     | (static_cast<std::uint64_t>(is_interrupt) << 15)
+                     | subroutine;
+    auto [child, inserted] =
+        children.try_emplace(key, static_cast<std::uint32_t>(paths.size()));
+    if (inserted) {
+        paths.push_back(Path{parent, subroutine, is_interrupt, 0});
+    }
+
+    const Frame frame{
+        .subroutine = subroutine,
+        .return_address = return_address,
+        .interrupt = is_interrupt,
+        .entry_cycle = cycles,
+        .path = child->second,
+    };
+    get_totals(frame).calls += 1;
+    active[subroutine] += 1;
+    stack.push_back(frame);
+}
+
+void CallTracker::ret(std::size_t frame) {
+    while (stack.size() > frame) {
+        const auto& top = stack.back();
+        active[top.subroutine] -= 1;
+        // Only the outermost of recursive calls adds its time.
+        if (active[top.subroutine] == 0) {
+            get_totals(top).inclusive_cycles += cycles - top.entry_cycle;
+        }
+        stack.pop_back();
+    }
+}
+
+CallTracker::Totals& CallTracker::get_totals(const Frame& frame) {
+    return subroutines[frame.subroutine];
+}
+
+} // namespace mano
@@ -0,0 +1,475 @@
+#include "emulator/condition.hpp"
+
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <format>
+
+#include "emulator/bus.hpp"
+#include "emulator/cpu.hpp"
+
+namespace mano {
+
+static constexpr std::string_view REGISTER_NAMES[] = {
+    "AR", "PC", "DR", "AC", "IR", "TR", "OUTR", "INPR"
+};
+static constexpr std::string_view FLAG_NAMES[] = {
+    "E", "S", "I", "FGI", "FGO", "FGT", "IEN", "R", "SC"
+};
+
+bool Condition::evaluate(const Cpu& cpu, const Bus& bus) const {
+    std::array<std::uint16_t, MAX_STACK> stack;
+    std::size_t top = 0;
+
+    const auto binary = [&](auto operation) {
+        top -= 1;
+        stack[top - 1] =
+            static_cast<std::uint16_t>(operation(stack[top - 1], stack[top]));
+    };
+    const auto compare = [&](auto operation) {
+        binary([&](std::uint16_t a, std::uint16_t b) {
+            return operation(
+                static_cast<std::int16_t>(a),
+                static_cast<std::int16_t>(b)
+            );
+        });
+    };
+
+    for (std::size_t pc = 0; pc < code.size();) {
+        switch (static_cast<Op>(code[pc++])) {
+            case Op::Push:
+                stack[top++] = code[pc++];
+                break;
+            case Op::Register:
+                stack[top++] = cpu.registers.get(std::size_t{code[pc++]});
+                break;
+            case Op::Flag:
+            {
+                std::uint16_t value = 0;
+                switch (static_cast<Flag>(code[pc++])) {
+                    case Flag::E:
+                        value = cpu.alu.e;
+                        break;
+                    case Flag::S:
+                        value = cpu.start_stop;
+                        break;
+                    case Flag::I:
+                        value = cpu.indirect;
+                        break;
+                    case Flag::FGI:
+                        value = cpu.fgi;
+                        break;
+                    case Flag::FGO:
+                        value = cpu.fgo;
+                        break;
+                    case Flag::FGT:
+                        value = cpu.fgt;
+                        break;
+                    case Flag::IEN:
+                        value = cpu.ien;
+                        break;
+                    case Flag::R:
+                        value = cpu.r;
+                        break;
+                    case Flag::SC:
+                        value = static_cast<std::uint16_t>(
+                            cpu.get_sequence_counter()
+                        );
+                        break;
+                }
+                stack[top++] = value;
+                break;
+            }
+            case Op::Load:
+                stack[top - 1] = bus.fetch(stack[top - 1] & 0xFFF);
+                break;
+            case Op::Not:
+                stack[top - 1] = stack[top - 1] == 0;
+                break;
+            case Op::Negate:
+                stack[top - 1] = static_cast<std::uint16_t>(-stack[top - 1]);
+                break;
+            case Op::Invert:
+                stack[top - 1] = static_cast<std::uint16_t>(~stack[top - 1]);
+                break;
+            case Op::Add:
+                binary([](std::uint16_t a, std::uint16_t b) { return a + b; });
+                break;
+            case Op::Subtract:
+                binary([](std::uint16_t a, std::uint16_t b) { return a - b; });
+                break;
+            case Op::And:
+                binary([](std::uint16_t a, std::uint16_t b) { return a & b; });
+                break;
+            case Op::Or:
+                binary([](std::uint16_t a, std::uint16_t b) { return a | b; });
+                break;
+            case Op::Xor:
+                binary([](std::uint16_t a, std::uint16_t b) { return a ^ b; });
+                break;
+            case Op::Equal:
+                binary([](std::uint16_t a, std::uint16_t b) { return a == b; });
+                break;
+            case Op::NotEqual:
+                binary([](std::uint16_t a, std::uint16_t b) { return a != b; });
+                break;
+            case Op::Less:
+                compare([](std::int16_t a, std::int16_t b) { return a < b; });
+                break;
+            case Op::LessEqual:
+                compare([](std::int16_t a, std::int16_t b) { return a <= b; });
+                break;
+            case Op::Greater:
+                compare([](std::int16_t a, std::int16_t b) { return a > b; });
+                break;
+            case Op::GreaterEqual:
+                compare([](std::int16_t a, std::int16_t b) { return a >= b; });
+                break;
+            case Op::Bool:
+                stack[top - 1] = stack[top - 1] != 0;
+                break;
+            case Op::JumpIfFalse:
+                top -= 1;
+                pc = stack[top] == 0 ? code[pc] : pc + 1;
+                break;
+            case Op::JumpIfTrue:
+                top -= 1;
+                pc = stack[top] != 0 ? code[pc] : pc + 1;
+                break;
+            case Op::Jump:
+                pc = code[pc];
+                break;
+        }
+    }
+    return stack[0] != 0;
+}
+
+std::optional<Condition> ConditionCompiler::compile(
+    std::string_view condition_text,
+    const std::unordered_map<std::uint16_t, std::string>& condition_labels
+) {
+    labels = &condition_labels;
+    text = condition_text;
+    index = 0;
+    code.clear();
+    depth = 0;
+    nesting = 0;
+    too_deep = false;
+    error.clear();
+
+    if (!parse_or()) {
+        return {};
+    }
+    skip_spaces();
+    if (index != text.size()) {
+        fail(std::format("Unexpected text: {}", text.substr(index)));
+        return {};
+    }
+    if (too_deep || code.size() > 0xFFFF) {
+        fail("The condition is nested too deeply.");
+        return {};
+    }
+
+    Condition condition;
+    condition.code = std::move(code);
+    condition.source = std::string(text);
+    return condition;
+}
+
+bool ConditionCompiler::parse_or() {
+    if (!parse_and()) {
+        return false;
+    }
+    while (accept("||")) {
+        // a || b: a, JumpIfTrue L, b, Bool, Jump E, L: Push 1, E:
+        const auto on_true = emit_jump(Op::JumpIfTrue, -1);
+        if (!parse_and()) {
+            return false;
+        }
+        emit(Op::Bool, 0);
+        // The true path joins without the value of b.
+        const auto end = emit_jump(Op::Jump, -1);
+        patch_jump(on_true);
+        emit(Op::Push, 1, 1);
+        patch_jump(end);
+    }
+    return true;
+}
+
+bool ConditionCompiler::parse_and() {
+    if (!parse_comparison()) {
+        return false;
+    }
+    while (accept("&&")) {
+        // a && b: a, JumpIfFalse L, b, Bool, Jump E, L: Push 0, E:
+        const auto on_false = emit_jump(Op::JumpIfFalse, -1);
+        if (!parse_comparison()) {
+            return false;
+        }
+        emit(Op::Bool, 0);
+        const auto end = emit_jump(Op::Jump, -1);
+        patch_jump(on_false);
+        emit(Op::Push, 0, 1);
+        patch_jump(end);
+    }
+    return true;
+}
+
+bool ConditionCompiler::parse_comparison() {
+    if (!parse_bit_or()) {
+        return false;
+    }
+    while (true) {
+        // The two character operators first.
+        Op op;
+        if (accept("==")) {
+            op = Op::Equal;
+        } else if (accept("!=")) {
+            op = Op::NotEqual;
+        } else if (accept("<=")) {
+            op = Op::LessEqual;
+        } else if (accept(">=")) {
+            op = Op::GreaterEqual;
+        } else if (accept("<")) {
+            op = Op::Less;
+        } else if (accept(">")) {
+            op = Op::Greater;
+        } else {
+            return true;
+        }
+        if (!parse_bit_or()) {
+            return false;
+        }
+        emit(op, -1);
+    }
+}
+
+bool ConditionCompiler::parse_bit_or() {
+    if (!parse_bit_xor()) {
+        return false;
+    }
+    while (true) {
+        skip_spaces();
+        if (text.substr(index).starts_with("||") || !accept("|")) {
+            return true;
+        }
+        if (!parse_bit_xor()) {
+            return false;
+        }
+        emit(Op::Or, -1);
+    }
+}
+
+bool ConditionCompiler::parse_bit_xor() {
+    if (!parse_bit_and()) {
+        return false;
+    }
+    while (accept("^")) {
+        if (!parse_bit_and()) {
+            return false;
+        }
+        emit(Op::Xor, -1);
+    }
+    return true;
+}
+
+bool ConditionCompiler::parse_bit_and() {
+    if (!parse_additive()) {
+        return false;
+    }
+    while (true) {
+        skip_spaces();
+        if (text.substr(index).starts_with("&&") || !accept("&")) {
+            return true;
+        }
+        if (!parse_additive()) {
+            return false;
+        }
+        emit(Op::And, -1);
+    }
+}
+
+bool ConditionCompiler::parse_additive() {
+    if (!parse_unary()) {
+        return false;
+    }
+    while (true) {
+        Op op;
+        if (accept("+")) {
+            op = Op::Add;
+        } else if (accept("-")) {
+            op = Op::Subtract;
+        } else {
+            return true;
+        }
+        if (!parse_unary()) {
+            return false;
+        }
+        emit(op, -1);
+    }
+}
+
+bool ConditionCompiler::parse_unary() {
+    skip_spaces();
+    Op op;
+    if (accept("!")) {
+        op = Op::Not;
+    } else if (accept("-")) {
+        op = Op::Negate;
+    } else if (accept("~")) {
+        op = Op::Invert;
+    } else {
+        return parse_primary();
+    }
+    // Every operator is a level of recursion, like a parenthesis.
+    if (++nesting > MAX_NESTING) {
+        return fail("The condition is nested too deeply.");
+    }
+    if (!parse_unary()) {
+        return false;
+    }
+    nesting -= 1;
+    emit(op, 0);
+    return true;
+}
+
+bool ConditionCompiler::parse_primary() {
+    skip_spaces();
+    if (index == text.size()) {
+        return fail("Expected a value at the end of the condition.");
+    }
+
+    if (accept("(")) {
+        if (++nesting > MAX_NESTING) {
+            return fail("The condition is nested too deeply.");
+        }
+        if (!parse_or()) {
+            return false;
+        }
+        if (!accept(")")) {
+            return fail("Expected ')'.");
+        }
+        nesting -= 1;
+        return true;
+    }
+
+    const char c = text[index];
+    if (std::isdigit(static_cast<unsigned char>(c))) {
+        int base = 10;
+        if (text.substr(index).starts_with("0x")
+            || text.substr(index).starts_with("0X")) {
+            base = 16;
+            index += 2;
+        }
+        std::uint32_t value = 0;
+        const auto begin = text.data() + index;
+        const auto result =
+            std::from_chars(begin, text.data() + text.size(), value, base);
+        if (result.ec != std::errc{} || value > 0xFFFF) {
+            return fail("Expected a 16-bit number.");
+        }
+        index += static_cast<std::size_t>(result.ptr - begin);
+        emit(Op::Push, static_cast<std::uint16_t>(value), 1);
+        return true;
+    }
+
+    if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+        std::string name;
+        while (index < text.size()
+               && (std::isalnum(static_cast<unsigned char>(text[index]))
+                   || text[index] == '_')) {
+            name += text[index];
+            index += 1;
+        }
+        if ((name == "M" || name == "m") && accept("[")) {
+            if (++nesting > MAX_NESTING) {
+                return fail("The condition is nested too deeply.");
+            }
+            if (!parse_or()) {
+                return false;
+            }
+            if (!accept("]")) {
+                return fail("Expected ']'.");
+            }
+            nesting -= 1;
+            emit(Op::Load, 0);
+            return true;
+        }
+        return parse_name(name);
+    }
+
+    return fail(std::format("Unexpected character: {}", c));
+}
+
+bool ConditionCompiler::parse_name(std::string_view name) {
+    // The registers and flags are in any case, the labels as they were
+    //     written. The registers and flags hide the labels of the same name.
+    std::string upper;
+    for (const char c : name) {
+        upper += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    for (std::size_t reg = 0; reg < std::size(REGISTER_NAMES); ++reg) {
+        if (upper == REGISTER_NAMES[reg]) {
+            emit(Op::Register, static_cast<std::uint16_t>(reg), 1);
+            return true;
+        }
+    }
+    for (std::size_t flag = 0; flag < std::size(FLAG_NAMES); ++flag) {
+        if (upper == FLAG_NAMES[flag]) {
+            emit(Op::Flag, static_cast<std::uint16_t>(flag), 1);
+            return true;
+        }
+    }
+    for (const auto& [address, label] : *labels) {
+        if (label == name) {
+            emit(Op::Push, address, 1);
+            return true;
+        }
+    }
+    return fail(std::format("Unknown name: {}", name));
+}
+
+void ConditionCompiler::skip_spaces() {
+    while (index < text.size()
+           && std::isspace(static_cast<unsigned char>(text[index]))) {
+        index += 1;
+    }
+}
+
+bool ConditionCompiler::accept(std::string_view op) {
+    skip_spaces();
+    if (!text.substr(index).starts_with(op)) {
+        return false;
+    }
+    index += op.size();
+    return true;
+}
+
+void ConditionCompiler::emit(Op op, int stack_change) {
+    code.push_back(static_cast<std::uint16_t>(op));
+    depth = static_cast<std::size_t>(static_cast<int>(depth) + stack_change);
+    too_deep = too_deep || depth > Condition::MAX_STACK;
+}
+
+void ConditionCompiler::emit(Op op, std::uint16_t operand, int stack_change) {
+    emit(op, stack_change);
+    code.push_back(operand);
+}
+
+std::size_t ConditionCompiler::emit_jump(Op op, int stack_change) {
+    emit(op, 0, stack_change);
+    return code.size() - 1;
+}
+
+void ConditionCompiler::patch_jump(std::size_t target) {
+    code[target] = static_cast<std::uint16_t>(code.size());
+}
+
+bool ConditionCompiler::fail(std::string message) {
+    if (error.empty()) {
+        error = std::move(message);
+    }
+    return false;
+}
+
+} // namespace mano
@@ -0,0 +1,503 @@
+#include "emulator/cpp_translator.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "emulator/instructions.hpp"
+
+namespace mano {
+
+static constexpr std::string_view PROGRAM_HEADER = R"(// Generated by mano-aot, do not edit.
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+
+enum Instr : int {
+    AND, ADD, LDA, STA, BUN, BSA, ISZ,
+    CLA, CLE, CMA, CME, CIR, CIL, INC, SPA, SNA, SZA, SZE, HLT,
+    INP, OUT, SKI, SKO, ION, IOF,
+    UNDEFINED
+};
+
+constexpr std::uint64_t CYCLES[] = {
+    6, 6, 6, 5, 5, 6, 7,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4,
+    4
+};
+
+int decode(std::uint16_t ir) {
+    const int index = (ir >> 12) & 0x7;
+    if (index != 7) {
+        return index;
+    }
+    switch (ir) {
+)";
+
+static constexpr std::string_view PROGRAM_MAIN = R"(
+int main() {
+    std::uint16_t AR = 0, PC = 0, DR = 0, AC = 0, TR = 0;
+    std::uint16_t OUTR = 0, INPR = 0;
+    [[maybe_unused]] std::uint16_t IR = 0;
+    bool E = false, S = true, I = false;
+    bool FGI = false, FGO = true, IEN = false, R = false;
+    int INSTR = UNDEFINED;
+    std::uint64_t cycles = 0;
+
+    // Input device, loads the next character after the last one is taken.
+    const auto service_input = [&] {
+        const int c = std::getchar();
+        if (c != EOF) {
+            INPR = static_cast<std::uint16_t>(c & 0xFF);
+            FGI = true;
+        }
+    };
+    // Output device, prints the character and is ready for the next one.
+    const auto service_output = [&] {
+        if (OUTR != 0) {
+            std::putchar(OUTR);
+        }
+        FGO = true;
+    };
+
+)";
+
+static constexpr std::string_view PROGRAM_FOOTER = R"(
+interrupt:
+    // RT0: AR <- 0 TR <- PC
+    AR = 0;
+    TR = PC;
+    // RT1: M[AR] <- TR PC <- 0
+    M[AR] = TR;
+    // RT2: PC <- PC + 1 IEN <- 0 R <- 0
+    PC = 1;
+    IEN = false;
+    R = false;
+    cycles += 3;
+    goto *LABELS[PC];
+
+interpret:
+    if (R) {
+        goto interrupt;
+    }
+    if (TRANSLATED[PC] == M[PC]) {
+        goto *LABELS[PC];
+    }
+    {
+        const std::uint16_t word = M[PC];
+        AR = PC;
+        IR = word;
+        PC = (PC + 1) & 0xFFF;
+        const int decoded = decode(word);
+        // An undefined opcode keeps the previously decoded instruction.
+        if (decoded != UNDEFINED) {
+            INSTR = decoded;
+            AR = word & 0xFFF;
+            I = (word >> 15) != 0;
+        }
+        if (INSTR <= ISZ && I) {
+            AR = M[AR] & 0xFFF;
+        }
+        switch (INSTR) {
+            case AND:
+                DR = M[AR];
+                AC &= DR;
+                break;
+            case ADD:
+            {
+                DR = M[AR];
+                const std::uint32_t sum = std::uint32_t {AC} + DR;
+                if (sum > 0xFFFF) {
+                    E = true;
+                }
+                AC = static_cast<std::uint16_t>(sum);
+                break;
+            }
+            case LDA:
+                DR = M[AR];
+                AC = DR;
+                break;
+            case STA:
+                M[AR] = AC;
+                break;
+            case BUN:
+                PC = AR;
+                break;
+            case BSA:
+                M[AR] = PC;
+                AR = (AR + 1) & 0xFFF;
+                PC = AR;
+                break;
+            case ISZ:
+                DR = static_cast<std::uint16_t>(M[AR] + 1);
+                M[AR] = DR;
+                if (DR == 0) {
+                    PC = (PC + 1) & 0xFFF;
+                }
+                break;
+            case CLA:
+                AC = 0;
+                break;
+            case CLE:
+                E = false;
+                break;
+            case CMA:
+                AC = static_cast<std::uint16_t>(~AC);
+                break;
+            case CME:
+                E = !E;
+                break;
+            case CIR:
+            {
+                const bool carry = AC & 0x1;
+                AC = static_cast<std::uint16_t>((E << 15) | (AC >> 1));
+                E = carry;
+                break;
+            }
+            case CIL:
+            {
+                const bool carry = (AC >> 15) & 0x1;
+                AC = static_cast<std::uint16_t>(E | (AC << 1));
+                E = carry;
+                break;
+            }
+            case INC:
+                AC = static_cast<std::uint16_t>(AC + 1);
+                break;
+            case SPA:
+                if ((AC >> 15) == 0) {
+                    PC = (PC + 1) & 0xFFF;
+                }
+                break;
+            case SNA:
+                if ((AC >> 15) != 0) {
+                    PC = (PC + 1) & 0xFFF;
+                }
+                break;
+            case SZA:
+                if (AC == 0) {
+                    PC = (PC + 1) & 0xFFF;
+                }
+                break;
+            case SZE:
+                if (!E) {
+                    PC = (PC + 1) & 0xFFF;
+                }
+                break;
+            case HLT:
+                S = false;
+                break;
+            case INP:
+                AC = INPR;
+                FGI = false;
+                break;
+            case OUT:
+                OUTR = AC & 0xFF;
+                FGO = false;
+                break;
+            case SKI:
+                if (FGI) {
+                    PC = (PC + 1) & 0xFFF;
+                }
+                break;
+            case SKO:
+                if (FGO) {
+                    PC = (PC + 1) & 0xFFF;
+                }
+                break;
+            case ION:
+                IEN = true;
+                break;
+            case IOF:
+                IEN = false;
+                break;
+            default:
+                break;
+        }
+        cycles += CYCLES[INSTR];
+        R = IEN && (FGI || FGO);
+        if (!S) {
+            goto halt;
+        }
+        if (INSTR == INP) {
+            service_input();
+        } else if (INSTR == OUT) {
+            service_output();
+        }
+    }
+    goto interpret;
+
+halt:
+    std::fflush(stdout);
+    std::fprintf(
+        stderr,
+        "Halted after %llu cycles, AC: %04x E: %d PC: %03x\n",
+        static_cast<unsigned long long>(cycles),
+        AC,
+        E,
+        PC
+    );
+    return 0;
+}
+)";
+
+// Skip conditions of SPA, SNA, SZA and SZE in that order.
+static constexpr std::string_view SKIP_CONDITIONS[] = {
+    "(AC >> 15) == 0", // SPA
+    "(AC >> 15) != 0", // SNA
+    "AC == 0",         // SZA
+    "!E",              // SZE
+};
+
+std::string CppTranslator::translate(const Memory& memory) {
+    image = &memory;
+    output.clear();
+    output += PROGRAM_HEADER;
+
+    for (std::size_t i = 7; i < INSTRUCTIONS.size(); ++i) {
+        emit(
+            "        case 0x{:04x}:\n            return {};\n",
+            INSTRUCTIONS[i].opcode,
+            INSTRUCTIONS[i].mnemonic
+        );
+    }
+    emit("    }}\n    return UNDEFINED;\n}}\n\n");
+
+    emit("std::uint16_t M[{}] = {{", MEMORY_SIZE);
+    for (std::size_t address = 0; address < MEMORY_SIZE; ++address) {
+        emit("{}0x{:04x},", address % 8 == 0 ? "\n    " : " ", memory[address]);
+    }
+    emit("\n}};\n\n");
+
+    emit("// Words the labels were translated from, 0x10000 if not translated.\n");
+    emit("const std::uint32_t TRANSLATED[{}] = {{", MEMORY_SIZE);
+    for (std::size_t address = 0; address < MEMORY_SIZE; ++address) {
+        const auto word = memory[address];
+        const std::uint32_t translated =
+            Instruction::decode(word) != Instr::Undefined ? word : 0x10000;
+        emit("{}0x{:05x},", address % 8 == 0 ? "\n    " : " ", translated);
+    }
+    emit("\n}};\n\n}} // namespace\n");
+
+    output += PROGRAM_MAIN;
+
+    emit("    static void* const LABELS[{}] = {{", MEMORY_SIZE);
+    for (std::size_t address = 0; address < MEMORY_SIZE; ++address) {
+        const bool translated =
+            Instruction::decode(memory[address]) != Instr::Undefined;
+        if (translated) {
+            emit("{}&&L{:03x},", address % 4 == 0 ? "\n        " : " ", address);
+        } else {
+            emit("{}&&interpret,", address % 4 == 0 ? "\n        " : " ");
+        }
+    }
+    emit("\n    }};\n\n");
+
+    emit("    service_input();\n    goto *LABELS[PC];\n");
+    for (std::size_t address = 0; address < MEMORY_SIZE; ++address) {
+        const auto word = memory[address];
+        const auto instr = Instruction::decode(word);
+        if (instr != Instr::Undefined) {
+            emit_instruction(static_cast<std::uint16_t>(address), word, instr);
+        }
+    }
+
+    output += PROGRAM_FOOTER;
+    image = nullptr;
+    return std::move(output);
+}
+
+void CppTranslator::emit_instruction(
+    std::uint16_t address,
+    std::uint16_t ir,
+    Instr instr
+) {
+    const std::uint16_t next = (address + 1) & 0xFFF;
+    const std::uint16_t skip = (address + 2) & 0xFFF;
+    const bool indirect = (ir >> 15) != 0;
+    const bool mri = Instruction::is_mri(instr);
+    const auto& info = Instruction::from_instr(instr);
+
+    emit("\nL{:03x}: // {}", address, info.mnemonic);
+    if (mri) {
+        emit(" {:03x}{}", ir & 0xFFF, indirect ? " I" : "");
+    }
+    emit("\n    if (R) {{\n        goto interrupt;\n    }}\n");
+    emit(
+        "    if (M[0x{:03x}] != 0x{:04x}) {{\n        goto interpret;\n    }}\n",
+        address,
+        ir
+    );
+    emit(
+        "    IR = 0x{:04x};\n    PC = 0x{:03x};\n    INSTR = {};\n    I = {};\n",
+        ir,
+        next,
+        info.mnemonic,
+        indirect
+    );
+    if (mri && indirect) {
+        emit("    AR = M[0x{:03x}] & 0xFFF;\n", ir & 0xFFF);
+    } else {
+        emit("    AR = 0x{:03x};\n", ir & 0xFFF);
+    }
+
+    switch (instr) {
+        case Instr::AND:
+            emit("    DR = M[AR];\n    AC &= DR;\n");
+            break;
+        case Instr::ADD:
+            emit(
+                "    DR = M[AR];\n"
+                "    {{\n"
+                "        const std::uint32_t sum = std::uint32_t {{AC}} + DR;\n"
+                "        if (sum > 0xFFFF) {{\n"
+                "            E = true;\n"
+                "        }}\n"
+                "        AC = static_cast<std::uint16_t>(sum);\n"
+                "    }}\n"
+            );
+            break;
+        case Instr::LDA:
+            emit("    DR = M[AR];\n    AC = DR;\n");
+            break;
+        case Instr::STA:
+            emit("    M[AR] = AC;\n");
+            break;
+        case Instr::BUN:
+            emit("    PC = AR;\n");
+            break;
+        case Instr::BSA:
+            emit("    M[AR] = PC;\n    AR = (AR + 1) & 0xFFF;\n    PC = AR;\n");
+            break;
+        case Instr::ISZ:
+            emit(
+                "    DR = static_cast<std::uint16_t>(M[AR] + 1);\n"
+                "    M[AR] = DR;\n"
+            );
+            break;
+        case Instr::CLA:
+            emit("    AC = 0;\n");
+            break;
+        case Instr::CLE:
+            emit("    E = false;\n");
+            break;
+        case Instr::CMA:
+            emit("    AC = static_cast<std::uint16_t>(~AC);\n");
+            break;
+        case Instr::CME:
+            emit("    E = !E;\n");
+            break;
+        case Instr::CIR:
+            emit(
+                "    {{\n"
+                "        const bool carry = AC & 0x1;\n"
+                "        AC = static_cast<std::uint16_t>((E << 15) | (AC >> 1));\n"
+                "        E = carry;\n"
+                "    }}\n"
+            );
+            break;
+        case Instr::CIL:
+            emit(
+                "    {{\n"
+                "        const bool carry = (AC >> 15) & 0x1;\n"
+                "        AC = static_cast<std::uint16_t>(E | (AC << 1));\n"
+                "        E = carry;\n"
+                "    }}\n"
+            );
+            break;
+        case Instr::INC:
+            emit("    AC = static_cast<std::uint16_t>(AC + 1);\n");
+            break;
+        case Instr::HLT:
+            emit("    S = false;\n");
+            break;
+        case Instr::INP:
+            emit("    AC = INPR;\n    FGI = false;\n");
+            break;
+        case Instr::OUT:
+            emit("    OUTR = AC & 0xFF;\n    FGO = false;\n");
+            break;
+        case Instr::ION:
+            emit("    IEN = true;\n");
+            break;
+        case Instr::IOF:
+            emit("    IEN = false;\n");
+            break;
+        default:
+            break;
+    }
+
+    emit(
+        "    cycles += {};\n    R = IEN && (FGI || FGO);\n",
+        Instruction::get_cycle_count(instr)
+    );
+
+    switch (instr) {
+        case Instr::BUN:
+        case Instr::BSA:
+            if (indirect) {
+                emit("    goto *LABELS[PC];\n");
+            } else {
+                // BSA continues from the word after its operand.
+                const std::uint16_t target =
+                    instr == Instr::BUN ? ir & 0xFFF : (ir + 1) & 0xFFF;
+                emit_jump(target);
+            }
+            return;
+        case Instr::HLT:
+            emit("    goto halt;\n");
+            return;
+        case Instr::INP:
+            emit("    service_input();\n");
+            break;
+        case Instr::OUT:
+            emit("    service_output();\n");
+            break;
+        case Instr::ISZ:
+        case Instr::SPA:
+        case Instr::SNA:
+        case Instr::SZA:
+        case Instr::SZE:
+        case Instr::SKI:
+        case Instr::SKO:
+        {
+            std::string_view condition;
+            if (instr == Instr::ISZ) {
+                condition = "DR == 0";
+            } else if (instr == Instr::SKI) {
+                condition = "FGI";
+            } else if (instr == Instr::SKO) {
+                condition = "FGO";
+            } else {
+                condition = SKIP_CONDITIONS
+                    [static_cast<std::size_t>(instr)
+                     - static_cast<std::size_t>(Instr::SPA)];
+            }
+            emit("    if ({}) {{\n        PC = 0x{:03x};\n    ", condition, skip);
+            emit_jump(skip);
+            emit("    }}\n");
+            break;
+        }
+        default:
+            break;
+    }
+
+    // Fall through to the next word if it has a label.
+    if (next == address + 1
+        && Instruction::decode((*image)[next]) != Instr::Undefined) {
+        return;
+    }
+    emit_jump(next);
+}
+
+void CppTranslator::emit_jump(std::uint16_t target) {
+    if (Instruction::decode((*image)[target]) != Instr::Undefined) {
+        emit("    goto L{:03x};\n", target);
+    } else {
+        emit("    goto interpret;\n");
+    }
+}
+
+} // namespace mano
@@ -15,17 +15,17 @@ void Cpu::cycle_once(Bus& bus) {
         // Interrupt cycle.
         switch (cycle) {
             case 0:
-                // RT0: AR <- 0 TR <- PC
+                // RT0: AR <- 0, or the vector, TR <- PC
                 cycle_name = "Fetch RT0";
-                registers.set(Registers::AR, 0);
+                registers.set(Registers::AR, dispatch(bus));
                 bus.load(Bus::Selection::TR, Bus::Selection::PC);
                 break;
             case 1:
-                // RT1: M[AR] <- TR PC <- 0
+                // RT1: M[AR] <- TR PC <- AR
                 cycle_name = "Fetch RT1";
                 bus.load(Bus::Selection::MemoryUnit, Bus::Selection::TR);
                 bus.write_memory();
-                registers.set(Registers::PC, 0);
+                registers.set(Registers::PC, registers.get(Registers::AR));
                 break;
             case 2:
                 // RT2: PC <- PC + 1 IEN <- 0 R <- 0 SC <- 0
@@ -34,6 +34,7 @@ void Cpu::cycle_once(Bus& bus) {
                 ien = false;
                 r = false;
                 sequence_counter = 0;
+                acknowledge();
                 break;
         }
         return;
@@ -50,7 +51,7 @@ void Cpu::cycle_once(Bus& bus) {
             cycle_name = "Fetch R'T1";
             // R'T1:
             // IR <- M[AR]
-            bus.read_memory();
+            bus.fetch_memory();
             bus.load(Bus::Selection::IR, Bus::Selection::MemoryUnit);
             // PC <- PC + 1
             registers.set(Registers::PC, registers.get(Registers::PC) + 1);
@@ -59,9 +60,10 @@ void Cpu::cycle_once(Bus& bus) {
         case 2:
             cycle_name = "Decode R'T2";
             // R'T2:
-            if (std::optional<Instruction> decode =
-                    Instruction::from_opcode(registers.get(Registers::IR))) {
-                instruction = decode.value();
+            if (const Instr decode =
+                    Instruction::decode(registers.get(Registers::IR));
+                decode != Instr::Undefined) {
+                instruction = decode;
                 // AR <- IR(0 ~ 11)
                 bus.load(Bus::Selection::AR, Bus::Selection::IR);
                 ;
@@ -71,9 +73,9 @@ void Cpu::cycle_once(Bus& bus) {
             }
             return;
         case 3:
-            if (!instruction.mri) {
+            if (!Instruction::is_mri(instruction)) {
                 auto ac = registers.get(Registers::AC);
-                switch (instruction.instr) {
+                switch (instruction) {
                     case Instr::CLA:
                         registers.set(Registers::AC, 0);
                         break;
@@ -137,10 +139,12 @@ void Cpu::cycle_once(Bus& bus) {
                         alu.load(registers, Registers::INPR);
                         registers.set(Registers::AC, alu.operate(Instr::INP));
                         fgi = false;
+                        io_pending = true;
                         break;
                     case Instr::OUT:
                         bus.load(Bus::Selection::OUTR, Bus::Selection::AC);
                         fgo = false;
+                        io_pending = true;
                         break;
                     case Instr::SKI:
                         if (fgi) {
@@ -148,6 +152,8 @@ void Cpu::cycle_once(Bus& bus) {
                                 Registers::PC,
                                 registers.get(Registers::PC) + 1
                             );
+                        } else {
+                            ++input_polls;
                         }
                         break;
                     case Instr::SKO:
@@ -156,10 +162,12 @@ void Cpu::cycle_once(Bus& bus) {
                                 Registers::PC,
                                 registers.get(Registers::PC) + 1
                             );
+                        } else {
+                            ++output_polls;
                         }
                         break;
                     case Instr::ION:
-                        ien = true;
+                        enable_interrupts();
                         break;
                     case Instr::IOF:
                         ien = false;
@@ -167,10 +175,10 @@ void Cpu::cycle_once(Bus& bus) {
                     default:
                         break;
                 }
-                cycle_name = instruction.cycle_name;
+                cycle_name = Instruction::from_instr(instruction).cycle_name;
                 sequence_counter = 0; // Reset the cycle counter.
                 // Set the interrupt flag.
-                r = ien && (fgi || fgo);
+                r = has_interrupt_request();
             } else if (indirect) {
                 cycle_name = "Decode D7'IT3";
                 // AR <- M[AR]
@@ -185,7 +193,7 @@ void Cpu::cycle_once(Bus& bus) {
     }
 
     // Implement the MRI instructions.
-    switch (instruction.instr) {
+    switch (instruction) {
         case Instr::AND:
             if (cycle == 4) {
                 cycle_name = "D0T4";
@@ -283,13 +291,247 @@ void Cpu::cycle_once(Bus& bus) {
 
     sequence_counter = 0;
     // Set the interrupt flag.
-    r = ien && (fgi || fgo);
+    r = has_interrupt_request();
 }
 
 void Cpu::cycle(Bus& bus, std::size_t cycle_count) {
-    for (std::size_t i = 0; i += cycle_count; ++i) {
+    for (std::size_t i = 0; i < cycle_count; ++i) {
         cycle_once(bus);
     }
 }
 
+std::size_t Cpu::step_instruction(Bus& bus) {
+    if (!start_stop) {
+        // Halted, the sequence counter doesn't move.
+        cycle_once(bus);
+        return 1;
+    }
+    if (sequence_counter != 0) {
+        // Stopped in the middle of an instruction by the single step mode.
+        // Finish it one T-state at a time.
+        std::size_t cycles = 0;
+        do {
+            cycle_once(bus);
+            cycles += 1;
+        } while (sequence_counter != 0 && start_stop
+                 && cycles < MAX_INSTRUCTION_CYCLES);
+        return cycles;
+    }
+
+    if (r) {
+        // RT0: AR <- 0, or the vector, TR <- PC
+        const auto saved = dispatch(bus);
+        registers.set(Registers::AR, saved);
+        registers.set(Registers::TR, registers.get(Registers::PC));
+        // RT1: M[AR] <- TR PC <- AR
+        bus.write(saved, registers.get(Registers::TR));
+        // RT2: PC <- PC + 1 IEN <- 0 R <- 0 SC <- 0
+        registers.set(Registers::PC, saved + 1);
+        ien = false;
+        r = false;
+        acknowledge();
+        return INTERRUPT_CYCLES;
+    }
+
+    const auto ir = bus.fetch(registers.get(Registers::PC));
+    return execute(bus, ir, Instruction::decode(ir));
+}
+
+std::size_t Cpu::execute(Bus& bus, std::uint16_t ir, Instr decode) {
+    // R'T0: AR <- PC
+    const auto pc = registers.get(Registers::PC);
+    registers.set(Registers::AR, pc);
+    // R'T1: IR <- M[AR] PC <- PC + 1
+    registers.set(Registers::IR, ir);
+    registers.set(Registers::PC, pc + 1);
+    // R'T2: AR <- IR(0 ~ 11) I <- IR(15)
+    // An undefined opcode keeps the previously decoded instruction,
+    //     same as the T-state engine.
+    if (decode != Instr::Undefined) {
+        instruction = decode;
+        registers.set(Registers::AR, ir);
+        indirect = static_cast<bool>(ir >> 15);
+    }
+
+    const auto skip_if = [&](bool condition) {
+        if (condition) {
+            registers.set(Registers::PC, registers.get(Registers::PC) + 1);
+        }
+    };
+
+    if (!Instruction::is_mri(instruction)) {
+        // T3: register reference and input-output instructions.
+        const auto ac = registers.get(Registers::AC);
+        switch (instruction) {
+            case Instr::CLA:
+                registers.set(Registers::AC, 0);
+                break;
+            case Instr::CLE:
+                alu.e = false;
+                break;
+            case Instr::CMA:
+                registers.set(Registers::AC, static_cast<std::uint16_t>(~ac));
+                break;
+            case Instr::CME:
+                alu.e = !alu.e;
+                break;
+            case Instr::CIR:
+                registers.set(
+                    Registers::AC,
+                    static_cast<std::uint16_t>((alu.e << 15) | (ac >> 1))
+                );
+                alu.e = ac & 0x1;
+                break;
+            case Instr::CIL:
+                registers.set(
+                    Registers::AC,
+                    static_cast<std::uint16_t>(alu.e | (ac << 1))
+                );
+                alu.e = (ac >> 15) & 0x1;
+                break;
+            case Instr::INC:
+                registers.set(Registers::AC, ac + 1);
+                break;
+            case Instr::SPA:
+                skip_if((ac >> 15) == 0);
+                break;
+            case Instr::SNA:
+                skip_if((ac >> 15) != 0);
+                break;
+            case Instr::SZA:
+                skip_if(ac == 0);
+                break;
+            case Instr::SZE:
+                skip_if(!alu.e);
+                break;
+            case Instr::HLT:
+                start_stop = false;
+                break;
+            case Instr::INP:
+                registers.set(Registers::AC, registers.get(Registers::INPR));
+                fgi = false;
+                io_pending = true;
+                break;
+            case Instr::OUT:
+                registers.set(Registers::OUTR, ac);
+                fgo = false;
+                io_pending = true;
+                break;
+            case Instr::SKI:
+                if (!fgi) {
+                    ++input_polls;
+                }
+                skip_if(fgi);
+                break;
+            case Instr::SKO:
+                if (!fgo) {
+                    ++output_polls;
+                }
+                skip_if(fgo);
+                break;
+            case Instr::ION:
+                enable_interrupts();
+                break;
+            case Instr::IOF:
+                ien = false;
+                break;
+            default:
+                break;
+        }
+    } else {
+        // D7'IT3: AR <- M[AR]
+        if (indirect) {
+            registers.set(
+                Registers::AR,
+                bus.read(registers.get(Registers::AR))
+            );
+        }
+        const auto ar = registers.get(Registers::AR);
+        switch (instruction) {
+            case Instr::AND:
+                // DR <- M[AR], AC <- AC & DR
+                registers.set(Registers::DR, bus.read(ar));
+                registers.set(
+                    Registers::AC,
+                    registers.get(Registers::AC) & registers.get(Registers::DR)
+                );
+                break;
+            case Instr::ADD:
+            {
+                // DR <- M[AR], AC <- AC + DR
+                registers.set(Registers::DR, bus.read(ar));
+                std::uint32_t add_result =
+                    static_cast<std::uint32_t>(registers.get(Registers::AC))
+                    + static_cast<std::uint32_t>(registers.get(Registers::DR));
+                if (add_result > 0xFFFF) {
+                    alu.e = true;
+                }
+                registers.set(
+                    Registers::AC,
+                    static_cast<std::uint16_t>(add_result)
+                );
+                break;
+            }
+            case Instr::LDA:
+                // DR <- M[AR], AC <- DR
+                registers.set(Registers::DR, bus.read(ar));
+                registers.set(Registers::AC, registers.get(Registers::DR));
+                break;
+            case Instr::STA:
+                // M[AR] <- AC
+                bus.write(ar, registers.get(Registers::AC));
+                break;
+            case Instr::BUN:
+                // PC <- AR
+                registers.set(Registers::PC, ar);
+                break;
+            case Instr::BSA:
+                // M[AR] <- PC, AR <- AR + 1, PC <- AR
+                bus.write(ar, registers.get(Registers::PC));
+                registers.set(Registers::AR, ar + 1);
+                registers.set(Registers::PC, registers.get(Registers::AR));
+                break;
+            case Instr::ISZ:
+                // DR <- M[AR], DR <- DR + 1, M[AR] <- DR
+                registers.set(Registers::DR, bus.read(ar) + 1);
+                bus.write(ar, registers.get(Registers::DR));
+                skip_if(registers.get(Registers::DR) == 0);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Set the interrupt flag.
+    r = has_interrupt_request();
+    return Instruction::get_cycle_count(instruction);
+}
+
+void Cpu::enable_interrupts() {
+    // The devices time the interrupt service routine up to here.
+    if (!ien) {
+        interrupts.note({});
+    }
+    ien = true;
+}
+
+std::uint16_t Cpu::dispatch(Bus& bus) {
+    interrupts.dispatched =
+        InterruptController::select(get_pending_interrupts() & interrupts.mask);
+    if (!interrupts.vectored || !interrupts.dispatched) {
+        return 0;
+    }
+    const auto entry = interrupts.vector_base + *interrupts.dispatched;
+    return bus.read(static_cast<std::uint16_t>(entry & 0xFFF)) & 0xFFF;
+}
+
+void Cpu::acknowledge() {
+    // The interrupt cycle only takes the tick when it serves the timer.
+    if (interrupts.dispatched == InterruptController::Timer) {
+        fgt = false;
+    }
+    // The devices time every interrupt.
+    interrupts.note(interrupts.dispatched);
+}
+
 } // namespace mano
@@ -0,0 +1,31 @@
+#include "emulator/debugger.hpp"
+
+#include "emulator/instructions.hpp"
+
+namespace mano {
+
+std::optional<std::array<std::uint16_t, 2>>
+find_step_over_target(const Emulator& emulator) {
+    const auto& cpu = emulator.cpu;
+    if (cpu.get_sequence_counter() != 0 || cpu.r || !cpu.start_stop) {
+        return {};
+    }
+    const auto pc = cpu.registers.get(Registers::PC);
+    if (Instruction::decode(emulator.get_memory()[pc]) != Instr::BSA) {
+        return {};
+    }
+    return std::array{
+        static_cast<std::uint16_t>((pc + 1) & 0xFFF),
+        static_cast<std::uint16_t>((pc + 2) & 0xFFF),
+    };
+}
+
+std::optional<std::uint16_t> find_step_out_target(const Emulator& emulator) {
+    const auto* tracker = emulator.get_call_tracker();
+    if (!tracker || tracker->get_stack().empty()) {
+        return {};
+    }
+    return tracker->get_stack().back().return_address;
+}
+
+} // namespace mano
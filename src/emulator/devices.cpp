@@ -0,0 +1,190 @@
+#include "emulator/devices.hpp"
+
+#include <algorithm>
+
+#include "emulator/cpu.hpp"
+#include "emulator/instructions.hpp"
+
+namespace mano {
+
+std::uint64_t Devices::get_input_wait_cycles(const Cpu& cpu) {
+    return cpu.input_polls
+           * (Instruction::get_cycle_count(Instr::SKI)
+              + Instruction::get_cycle_count(Instr::BUN));
+}
+
+std::uint64_t Devices::get_output_wait_cycles(const Cpu& cpu) {
+    return cpu.output_polls
+           * (Instruction::get_cycle_count(Instr::SKO)
+              + Instruction::get_cycle_count(Instr::BUN));
+}
+
+void Devices::set_timer_period(std::uint64_t period) {
+    timer_period = period;
+    raised = {};
+    service_start.reset();
+    // A stale expiry would still end the waits for the next event.
+    std::priority_queue<Event, std::vector<Event>, Later> kept;
+    for (; !events.empty(); events.pop()) {
+        if (events.top().kind != Event::Kind::Timer) {
+            kept.push(events.top());
+        }
+    }
+    events = std::move(kept);
+    if (period != 0) {
+        events.push(Event{cycles + period, Event::Kind::Timer});
+    }
+}
+
+void Devices::advance(Cpu& cpu, std::uint64_t elapsed) {
+    const auto start = cycles;
+    cycles += elapsed;
+    auto& interrupts = cpu.interrupts;
+    for (std::size_t i = 0; i < interrupts.stamp_count; ++i) {
+        const auto& stamp = interrupts.stamps[i];
+        time_interrupt(stamp, start + stamp.cycles);
+    }
+    interrupts.clear_stamps();
+    if (cpu.io_pending) {
+        cpu.io_pending = false;
+        note_flags(cpu);
+        schedule(cpu);
+    }
+    run_events(cpu);
+}
+
+void Devices::update(Cpu& cpu) {
+    note_flags(cpu);
+    if (output_blocked && output.size() < output_capacity) {
+        complete_output(cpu);
+    }
+    schedule(cpu);
+    run_events(cpu);
+}
+
+void Devices::schedule(const Cpu& cpu) {
+    if (!input_busy && !cpu.fgi && input_open && !input.empty()) {
+        input_busy = true;
+        input_start = cycles;
+        events.push(Event{cycles + input_latency, Event::Kind::Input});
+    }
+    if (!output_busy && !cpu.fgo && output_open) {
+        output_busy = true;
+        output_start = cycles;
+        events.push(Event{cycles + output_latency, Event::Kind::Output});
+    }
+}
+
+void Devices::run_events(Cpu& cpu) {
+    while (!events.empty() && events.top().cycle <= cycles) {
+        const auto event = events.top();
+        events.pop();
+        switch (event.kind) {
+            case Event::Kind::Input:
+                complete_input(cpu);
+                break;
+            case Event::Kind::Output:
+                complete_output(cpu);
+                break;
+            case Event::Kind::Timer:
+                expire_timer(cpu, event.cycle);
+                break;
+        }
+    }
+}
+
+void Devices::complete_input(Cpu& cpu) {
+    input_busy = false;
+    stats.input_busy_cycles += cycles - input_start;
+    // The input may have been replaced or closed since the start.
+    if (cpu.fgi || !input_open || input.empty()) {
+        return;
+    }
+    cpu.registers.set(
+        Registers::INPR,
+        static_cast<unsigned char>(*input.pop())
+    );
+    cpu.fgi = true;
+    raised[InterruptController::Input] = cycles;
+    stats.input_characters += 1;
+}
+
+void Devices::complete_output(Cpu& cpu) {
+    if (cpu.fgo || !output_open) {
+        end_output();
+        return;
+    }
+    const auto value = cpu.registers.get(Registers::OUTR);
+    if (value != 0) {
+        if (output.size() >= output_capacity) {
+            // Waits for update once there's room.
+            output_blocked = true;
+            return;
+        }
+        output.push(static_cast<char>(value));
+        stats.output_characters += 1;
+    }
+    end_output();
+    cpu.fgo = true;
+    raised[InterruptController::Output] = cycles;
+}
+
+void Devices::end_output() {
+    output_busy = false;
+    output_blocked = false;
+    stats.output_busy_cycles += cycles - output_start;
+}
+
+void Devices::expire_timer(Cpu& cpu, std::uint64_t cycle) {
+    stats.timer_ticks += 1;
+    if (cpu.fgt) {
+        stats.missed_ticks += 1;
+    } else {
+        cpu.fgt = true;
+        raised[InterruptController::Timer] = cycle;
+    }
+    // The CPU only sets R at the end of an instruction.
+    if (cpu.get_sequence_counter() == 0 && !cpu.r) {
+        cpu.r = cpu.has_interrupt_request();
+    }
+    events.push(Event{cycle + timer_period, Event::Kind::Timer});
+}
+
+void Devices::note_flags(const Cpu& cpu) {
+    const auto pending = cpu.get_pending_interrupts();
+    for (std::size_t i = 0; i < InterruptController::SOURCE_COUNT; ++i) {
+        const auto source = static_cast<InterruptController::Source>(i);
+        if (!(pending & InterruptController::get_bit(source))) {
+            raised[source].reset();
+        } else if (!raised[source]) {
+            raised[source] = cycles;
+        }
+    }
+}
+
+void Devices::time_interrupt(
+    const InterruptController::Stamp& stamp,
+    std::uint64_t end
+) {
+    if (const auto source = stamp.source) {
+        const auto start = end - Cpu::INTERRUPT_CYCLES;
+        auto& timing = stats.interrupts[*source];
+        timing.interrupts += 1;
+        if (raised[*source]) {
+            const auto latency = start - std::min(start, *raised[*source]);
+            timing.latency_cycles += latency;
+            timing.max_latency = std::max(timing.max_latency, latency);
+        }
+        service_start = start;
+        service_source = *source;
+        return;
+    }
+    if (service_start) {
+        auto& timing = stats.interrupts[service_source];
+        timing.services += 1;
+        timing.service_cycles += end - *service_start;
+        service_start.reset();
+    }
+}
+
+} // namespace mano
@@ -0,0 +1,556 @@
+#include "emulator/emulator_thread.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "emulator/debugger.hpp"
+
+namespace mano {
+
+EmulatorThread::EmulatorThread() {
+    // The output queue holds the stream, the devices only the character
+    //     that didn't fit.
+    devices.output_capacity = 1;
+    devices.input_open = false;
+    devices.output_open = false;
+#if defined(MANO_THREADS)
+    thread = std::thread([this] { run_thread(); });
+#endif
+}
+
+EmulatorThread::~EmulatorThread() {
+#if defined(MANO_THREADS)
+    quit.store(true, std::memory_order_release);
+    wakeups.fetch_add(1, std::memory_order_release);
+    wakeups.notify_one();
+    thread.join();
+#endif
+}
+
+bool EmulatorThread::send(Command command) {
+    if (!commands.push(std::move(command))) {
+        return false;
+    }
+#if defined(MANO_THREADS)
+    wakeups.fetch_add(1, std::memory_order_release);
+    wakeups.notify_one();
+#endif
+    return true;
+}
+
+void EmulatorThread::poll() {
+#if !defined(MANO_THREADS)
+    service(Clock::now() + frame_budget);
+    if (changed) {
+        publish();
+    }
+#endif
+}
+
+void EmulatorThread::drain_output(std::string& text) {
+    [[maybe_unused]] const auto length = text.size();
+    while (const auto character = output.pop()) {
+        text.push_back(*character);
+    }
+#if defined(MANO_THREADS)
+    // The program may wait for the room.
+    if (text.size() != length) {
+        wakeups.fetch_add(1, std::memory_order_release);
+        wakeups.notify_one();
+    }
+#endif
+}
+
+bool EmulatorThread::is_threaded() const {
+#if defined(MANO_THREADS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if defined(MANO_THREADS)
+void EmulatorThread::run_thread() {
+    while (!quit.load(std::memory_order_acquire)) {
+        const auto seen = wakeups.load(std::memory_order_acquire);
+        const auto now = Clock::now();
+        service(now + SLICE_TIME);
+        if (changed
+            && (mode == Mode::Idle || waiting
+                || now - last_publish >= PUBLISH_PERIOD)) {
+            publish();
+        }
+        const bool full_speed =
+            mode == Mode::Continuing
+            || (mode == Mode::Running && max_speed && emulator->cpu.start_stop);
+        if (mode == Mode::Idle || waiting) {
+            if (commands.empty()) {
+                wakeups.wait(seen, std::memory_order_acquire);
+            }
+        } else if (!full_speed) {
+            // Only a few T-states are due per millisecond at the clock
+            //     rates the UI animates.
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+#endif
+
+void EmulatorThread::service(Clock::time_point deadline) {
+    bool handled = false;
+    while (auto command = commands.pop()) {
+        handle(*command);
+        handled = true;
+    }
+    if (!emulator) {
+        return;
+    }
+    if (handled) {
+        changed = true;
+        // Looked at again by run_batches.
+        waiting.reset();
+        // The commands may have changed the flags or the streams.
+        devices.update(emulator->cpu);
+    }
+    flush_output();
+    switch (mode) {
+        case Mode::Idle:
+            break;
+        case Mode::Running:
+            if (max_speed) {
+                // A halted CPU waits for S like the clocked one does.
+                run_batches(deadline);
+                break;
+            }
+            run_clocked(deadline);
+            break;
+        case Mode::Reversing:
+            run_clocked(deadline);
+            break;
+        case Mode::Continuing:
+            if (!run_batches(deadline)) {
+                // Halted before reaching the temporary breakpoint.
+                stop();
+            }
+            break;
+    }
+}
+
+void EmulatorThread::handle(Command& command) {
+    using Kind = Command::Kind;
+    if (command.kind == Kind::Load) {
+        emulator = std::move(command.emulator);
+        mode = Mode::Idle;
+        // Its breakpoints may have any version.
+        breakpoints_changes += 1;
+        // Times the new program from its start.
+        devices.set_timer_period(devices.get_timer_period());
+        return;
+    }
+    if (!emulator) {
+        return;
+    }
+
+    auto& cpu = emulator->cpu;
+    switch (command.kind) {
+        case Kind::Load:
+            break;
+        case Kind::Cycle:
+            cycle();
+            break;
+        case Kind::StepBig:
+            do {
+                cycle();
+            } while (cpu.get_sequence_counter() != 0 && cpu.start_stop);
+            break;
+        case Kind::StepOver:
+            if (const auto targets = find_step_over_target(*emulator)) {
+                continue_to((*targets)[0], (*targets)[1]);
+                break;
+            }
+            clear_transfers();
+            advance(emulator->step_instruction());
+            break;
+        case Kind::StepOut:
+            if (const auto target = find_step_out_target(*emulator)) {
+                continue_to(*target);
+            }
+            break;
+        case Kind::ReverseStep:
+            executed += emulator->reverse_step();
+            break;
+        case Kind::Run:
+        case Kind::Reverse:
+            emulator->set_temporary_breakpoint({});
+            mode = command.kind == Kind::Run ? Mode::Running : Mode::Reversing;
+            elapsed_time = 0.0;
+            last_tick = Clock::now();
+            break;
+        case Kind::Continue:
+            continue_to(command.target);
+            break;
+        case Kind::Stop:
+            stop();
+            break;
+        case Kind::SetClockRate:
+            clock_rate = command.clock_rate;
+            break;
+        case Kind::SetMaxSpeed:
+            max_speed = command.enabled;
+            elapsed_time = 0.0;
+            last_tick = Clock::now();
+            break;
+        case Kind::SetFrameBudget:
+            frame_budget = std::chrono::milliseconds(
+                std::max<std::uint16_t>(command.value, 1)
+            );
+            break;
+        case Kind::SetBreakpoint:
+            if (command.breakpoint == Breakpoints::Kind::Execute) {
+                emulator->set_breakpoint(command.address, command.enabled);
+            } else {
+                emulator->set_watchpoint(
+                    command.breakpoint,
+                    command.address,
+                    command.enabled
+                );
+            }
+            break;
+        case Kind::SetBreakpointRule:
+            emulator->set_breakpoint(command.address, true);
+            emulator->set_breakpoint_rule(
+                Breakpoints::Kind::Execute,
+                command.address,
+                std::move(*command.rule)
+            );
+            break;
+        case Kind::SetProfiling:
+            emulator->set_profiling(command.enabled);
+            break;
+        case Kind::SetCallTracking:
+            emulator->set_call_tracking(command.enabled);
+            break;
+        case Kind::SetRegister:
+            cpu.registers.set(
+                static_cast<std::size_t>(command.address),
+                command.value
+            );
+            break;
+        case Kind::SetFlag:
+            switch (command.flag) {
+                case Condition::Flag::E:
+                    cpu.alu.e = command.enabled;
+                    break;
+                case Condition::Flag::S:
+                    cpu.start_stop = command.enabled;
+                    break;
+                case Condition::Flag::I:
+                    cpu.indirect = command.enabled;
+                    break;
+                case Condition::Flag::FGI:
+                    cpu.fgi = command.enabled;
+                    break;
+                case Condition::Flag::FGO:
+                    cpu.fgo = command.enabled;
+                    break;
+                case Condition::Flag::FGT:
+                    cpu.fgt = command.enabled;
+                    break;
+                case Condition::Flag::IEN:
+                    cpu.ien = command.enabled;
+                    break;
+                case Condition::Flag::R:
+                    cpu.r = command.enabled;
+                    break;
+                case Condition::Flag::SC:
+                    break;
+            }
+            break;
+        case Kind::SetInput:
+        {
+            // Drop what was read after the UI took its snapshot.
+            const auto read = static_cast<std::size_t>(
+                std::min<std::uint64_t>(
+                    devices.get_stats().input_characters - command.consumed,
+                    command.text.size()
+                )
+            );
+            const auto text = std::string_view(command.text).substr(read);
+            // Keeps the input the text still starts with, typing at the end
+            //     only pushes the new characters.
+            std::size_t kept = 0;
+            while (kept < devices.input.size() && kept < text.size()
+                   && devices.input[kept] == text[kept]) {
+                kept += 1;
+            }
+            devices.input.truncate(kept);
+            for (std::size_t i = kept; i < text.size(); ++i) {
+                devices.input.push(text[i]);
+            }
+            input_version += 1;
+            break;
+        }
+        case Kind::SetInputOpen:
+            devices.input_open = command.enabled;
+            break;
+        case Kind::SetInputLatency:
+            devices.input_latency = command.value;
+            break;
+        case Kind::SetOutputOpen:
+            devices.output_open = command.enabled;
+            cpu.fgo = command.enabled;
+            break;
+        case Kind::SetOutputLatency:
+            devices.output_latency = command.value;
+            break;
+        case Kind::SetTimerPeriod:
+            devices.set_timer_period(command.value);
+            break;
+        case Kind::SetInterruptMask:
+            cpu.interrupts.mask = static_cast<std::uint8_t>(
+                command.value & InterruptController::ALL_SOURCES
+            );
+            break;
+        case Kind::SetVectored:
+            cpu.interrupts.vectored = command.enabled;
+            cpu.interrupts.vector_base = command.address & 0xFFF;
+            break;
+    }
+}
+
+void EmulatorThread::run_clocked(Clock::time_point deadline) {
+    const auto now = Clock::now();
+    elapsed_time += std::chrono::duration<double>(now - last_tick).count();
+    last_tick = now;
+    // The fraction of a T-state carries over to the next call.
+    const auto cycles = static_cast<std::uint64_t>(
+        std::floor(elapsed_time * clock_rate)
+    );
+    if (cycles == 0) {
+        return;
+    }
+    changed = true;
+
+    for (std::uint64_t i = 0; i < cycles; ++i) {
+        if (mode == Mode::Running) {
+            if (const auto skipped = skip_idle_loop(cycles - i)) {
+                i += skipped - 1;
+                continue;
+            }
+            cycle();
+            if (emulator->cpu.break_pending) {
+                mode = Mode::Idle;
+                break;
+            }
+        } else {
+            const auto undone = emulator->reverse_step();
+            executed += undone;
+            devices.update(emulator->cpu);
+            // Reached the start of the journal or a breakpoint.
+            if (undone == 0 || emulator->is_at_breakpoint()) {
+                mode = Mode::Idle;
+                break;
+            }
+        }
+        if (i % 1024 == 1023 && Clock::now() >= deadline) {
+            // Can't keep up with the clock rate, the rest is dropped.
+            elapsed_time = 0.0;
+            return;
+        }
+    }
+    elapsed_time -= static_cast<double>(cycles) / clock_rate;
+}
+
+bool EmulatorThread::run_batches(Clock::time_point deadline) {
+    if (waiting) {
+        // Still nothing to end the loop with, flush_output may have made
+        //     room for the output.
+        waiting = find_wait();
+        if (waiting) {
+            return true;
+        }
+    }
+    changed = true;
+    clear_transfers();
+    auto now = Clock::now();
+    do {
+        const auto remaining =
+            std::chrono::duration<double, std::nano>(deadline - now).count();
+        // Ends at the next device event.
+        const auto batch = static_cast<std::size_t>(std::min<std::uint64_t>(
+            static_cast<std::uint64_t>(std::clamp(
+                remaining / cycle_time,
+                static_cast<double>(MIN_BATCH_CYCLES),
+                static_cast<double>(MAX_BATCH_CYCLES)
+            )),
+            devices.get_cycles_to_event()
+        ));
+
+        const auto cycles = emulator->run(batch);
+        advance(cycles);
+        waiting = find_wait();
+        if (waiting) {
+            return true;
+        }
+
+        const auto start = now;
+        now = Clock::now();
+        if (cycles >= MIN_BATCH_CYCLES) {
+            const auto time =
+                std::chrono::duration<double, std::nano>(now - start).count();
+            cycle_time += (time / static_cast<double>(cycles) - cycle_time)
+                          / 8.0;
+        }
+        if (!emulator->cpu.start_stop || emulator->cpu.break_pending) {
+            if (emulator->cpu.break_pending && mode == Mode::Running) {
+                mode = Mode::Idle;
+            }
+            return false;
+        }
+    } while (now < deadline);
+    return true;
+}
+
+std::optional<IdleLoop> EmulatorThread::find_wait() const {
+    if (devices.get_cycles_to_event() != Devices::NO_EVENT) {
+        return {};
+    }
+    return emulator->find_idle_loop();
+}
+
+std::uint64_t EmulatorThread::skip_idle_loop(std::uint64_t cycles) {
+    // The loop ends no later than the next device event.
+    cycles = std::min(cycles, devices.get_cycles_to_event());
+    const auto loop = emulator->find_idle_loop();
+    if (!loop || cycles < 2 * loop->cycles) {
+        return 0;
+    }
+    clear_transfers();
+    // Ends on the same T-state of the loop it started from.
+    const auto skipped = emulator->run(cycles / loop->cycles * loop->cycles);
+    advance(skipped);
+    return skipped;
+}
+
+void EmulatorThread::continue_to(
+    std::optional<std::uint16_t> target,
+    std::optional<std::uint16_t> second
+) {
+    emulator->set_temporary_breakpoint(target, second);
+    mode = Mode::Continuing;
+}
+
+void EmulatorThread::stop() {
+    mode = Mode::Idle;
+    emulator->set_temporary_breakpoint({});
+}
+
+void EmulatorThread::cycle() {
+    clear_transfers();
+    emulator->cycle();
+    advance(1);
+}
+
+void EmulatorThread::advance(std::uint64_t cycles) {
+    executed += cycles;
+    devices.advance(emulator->cpu, cycles);
+    flush_output();
+}
+
+void EmulatorThread::flush_output() {
+    if (devices.output.empty()) {
+        return;
+    }
+    while (!devices.output.empty() && output.push(devices.output[0])) {
+        devices.output.pop();
+    }
+    // The output port may wait for the room.
+    devices.update(emulator->cpu);
+}
+
+void EmulatorThread::clear_transfers() {
+    emulator->bus.last_dest = Bus::Selection::None;
+    emulator->bus.last_source = Bus::Selection::None;
+    emulator->bus.transfer_value = 0;
+    emulator->cpu.alu.a_register = {};
+    emulator->cpu.alu.b_register = {};
+}
+
+void EmulatorThread::publish() {
+    changed = false;
+    last_publish = Clock::now();
+    if (mode == Mode::Idle) {
+        achieved_rate = 0.0;
+        rate_executed = executed;
+        rate_start = last_publish;
+    } else if (last_publish - rate_start >= RATE_PERIOD) {
+        const auto seconds =
+            std::chrono::duration<double>(last_publish - rate_start).count();
+        achieved_rate = static_cast<double>(executed - rate_executed) / seconds;
+        rate_executed = executed;
+        rate_start = last_publish;
+    }
+
+    auto& snapshot = snapshots.get_back();
+    snapshot.mode = mode;
+    snapshot.executed = executed;
+    snapshot.max_speed = max_speed;
+    snapshot.achieved_rate = achieved_rate;
+    snapshot.waiting = waiting;
+    snapshot.input_consumed = devices.get_stats().input_characters;
+    // Reading only drops characters from the front, the text is copied
+    //     again once SetInput replaced it.
+    if (snapshot.input_version != input_version) {
+        snapshot.input_version = input_version;
+        snapshot.input_base = snapshot.input_consumed;
+        snapshot.input.clear();
+        for (std::size_t i = 0; i < devices.input.size(); ++i) {
+            snapshot.input.push_back(devices.input[i]);
+        }
+    }
+    snapshot.device_stats = devices.get_stats();
+    snapshot.device_cycles = devices.get_cycles();
+    if (!emulator) {
+        snapshots.publish();
+        return;
+    }
+
+    snapshot.cpu = emulator->cpu;
+    snapshot.memory = emulator->memory.fork();
+    snapshot.last_source = emulator->bus.last_source;
+    snapshot.last_dest = emulator->bus.last_dest;
+    snapshot.transfer_value = emulator->bus.transfer_value;
+    // Every snapshot keeps its own copy, only the outdated ones take it.
+    const auto* breakpoints = emulator->get_breakpoints();
+    const auto version = breakpoints ? breakpoints->get_version() : 0;
+    if (version != breakpoints_version) {
+        breakpoints_version = version;
+        breakpoints_changes += 1;
+    }
+    if (snapshot.breakpoints_changes != breakpoints_changes) {
+        snapshot.breakpoints_changes = breakpoints_changes;
+        if (breakpoints) {
+            snapshot.breakpoints = *breakpoints;
+        } else {
+            snapshot.breakpoints.clear();
+        }
+    }
+    const auto* journal = emulator->get_journal();
+    snapshot.history = journal ? journal->get_cycles() : 0;
+
+    const auto* profiler = emulator->get_profiler();
+    snapshot.profiling = profiler != nullptr;
+    snapshot.hot_addresses.clear();
+    if (profiler) {
+        snapshot.profile_cycles = profiler->total_cycles;
+        for (const auto address :
+             profiler->get_hot_addresses(HOT_ADDRESS_COUNT)) {
+            snapshot.hot_addresses.push_back(
+                HotAddress{address, profiler->cycles[address]}
+            );
+        }
+    }
+    snapshots.publish();
+}
+
+} // namespace mano
@@ -0,0 +1,66 @@
+#include "emulator/idle_loop.hpp"
+
+#include "emulator/cpu.hpp"
+#include "emulator/instructions.hpp"
+
+namespace mano {
+
+static constexpr std::uint16_t SKI_WORD = 0xF200;
+static constexpr std::uint16_t SKO_WORD = 0xF100;
+
+// Direct BUN to the address.
+static std::uint16_t branch_to(std::uint16_t address) {
+    return static_cast<std::uint16_t>(0x4000 | address);
+}
+
+std::optional<IdleLoop>
+find_idle_loop(const Cpu& cpu, const PagedMemory& memory) {
+    if (!cpu.start_stop || cpu.r || cpu.get_sequence_counter() != 0
+        || cpu.has_interrupt_request()) {
+        return {};
+    }
+    const auto bun_cycles = Instruction::get_cycle_count(Instr::BUN);
+    const auto pc = cpu.registers.get(Registers::PC);
+    const auto word = memory[pc];
+    if (word == branch_to(pc)) {
+        // Only an interrupt gets out.
+        return IdleLoop{
+            1,
+            bun_cycles,
+            IdleLoop::Poll::None,
+            cpu.ien,
+            cpu.ien,
+        };
+    }
+
+    // The skip and the branch back to it, starting from either one.
+    auto skip = pc;
+    if (word != SKI_WORD && word != SKO_WORD) {
+        skip = static_cast<std::uint16_t>((pc - 1) & 0xFFF);
+    }
+    const auto next = static_cast<std::uint16_t>((skip + 1) & 0xFFF);
+    if (memory[next] != branch_to(skip)) {
+        return {};
+    }
+    if (memory[skip] == SKI_WORD && !cpu.fgi) {
+        return IdleLoop{
+            2,
+            Instruction::get_cycle_count(Instr::SKI) + bun_cycles,
+            IdleLoop::Poll::Input,
+            true,
+            cpu.ien,
+        };
+    }
+    if (memory[skip] == SKO_WORD && !cpu.fgo) {
+        return IdleLoop{
+            2,
+            Instruction::get_cycle_count(Instr::SKO) + bun_cycles,
+            IdleLoop::Poll::Output,
+            cpu.ien,
+            true,
+        };
+    }
+    return {};
+}
+
+} // namespace mano
@@ -0,0 +1,180 @@
+#include "emulator/journal.hpp"
+
+#include "emulator/bus.hpp"
+#include "emulator/cpu.hpp"
+
+namespace mano {
+
+void Journal::begin(const Cpu& cpu) {
+    const auto state = capture(cpu);
+    record_external(state);
+
+    reserve_entry();
+    before = state;
+    recording = true;
+    write_count = 0;
+    entry_stamp += 1;
+    if (entry_stamp == 0) {
+        saved.fill(0);
+        entry_stamp = 1;
+    }
+}
+
+void Journal::end(const Cpu& cpu, std::size_t entry_cycles) {
+    recording = false;
+    const auto state = capture(cpu);
+    push(before, state, entry_cycles);
+    last = state;
+    has_last = true;
+}
+
+std::size_t Journal::undo(Cpu& cpu, Bus& bus) {
+    record_external(capture(cpu));
+
+    std::size_t undone = 0;
+    while (!empty()) {
+        auto& chunk = chunks.back();
+        if (chunk.entries.empty()) {
+            chunks.pop_back();
+            continue;
+        }
+        const Entry entry = chunk.entries.back();
+        chunk.entries.pop_back();
+
+        for (std::size_t i = Registers::REGISTER_COUNT; i-- > 0;) {
+            if (entry.changed_registers & (1u << i)) {
+                cpu.registers.set(i, chunk.values.back());
+                chunk.values.pop_back();
+                value_count -= 1;
+            }
+        }
+        for (std::uint32_t i = 0; i < entry.write_count; ++i) {
+            const auto old_value = chunk.values.back();
+            chunk.values.pop_back();
+            const auto address = chunk.values.back();
+            chunk.values.pop_back();
+            value_count -= 2;
+            bus.write(address, old_value);
+        }
+
+        State state;
+        state.flags = entry.flags;
+        state.sequence_counter = entry.sequence_counter;
+        state.instruction = entry.instruction;
+        state.cycle_name = entry.cycle_name;
+        state.registers = capture(cpu).registers;
+        restore(cpu, state);
+
+        entry_count -= 1;
+        cycles -= entry.cycles;
+        chunk.cycles -= entry.cycles;
+        if (entry.cycles != 0) {
+            undone = entry.cycles;
+            break;
+        }
+    }
+
+    last = capture(cpu);
+    has_last = true;
+    return undone;
+}
+
+void Journal::clear() {
+    chunks.clear();
+    entry_count = 0;
+    value_count = 0;
+    cycles = 0;
+    has_last = false;
+    recording = false;
+}
+
+Journal::State Journal::capture(const Cpu& cpu) {
+    State state;
+    for (std::size_t i = 0; i < Registers::REGISTER_COUNT; ++i) {
+        state.registers[i] = cpu.registers.get(i);
+    }
+    state.flags = static_cast<std::uint16_t>(
+        cpu.start_stop | (cpu.indirect << 1) | (cpu.fgi << 2)
+        | (cpu.fgo << 3) | (cpu.ien << 4) | (cpu.r << 5) | (cpu.alu.e << 6)
+        | (cpu.io_pending << 7) | (cpu.fgt << 8)
+    );
+    state.sequence_counter =
+        static_cast<std::uint8_t>(cpu.get_sequence_counter());
+    state.instruction = cpu.instruction;
+    state.cycle_name = cpu.get_cycle_name();
+    return state;
+}
+
+void Journal::restore(Cpu& cpu, const State& state) {
+    for (std::size_t i = 0; i < Registers::REGISTER_COUNT; ++i) {
+        cpu.registers.set(i, state.registers[i]);
+    }
+    cpu.start_stop = state.flags & 0x01;
+    cpu.indirect = state.flags & 0x02;
+    cpu.fgi = state.flags & 0x04;
+    cpu.fgo = state.flags & 0x08;
+    cpu.ien = state.flags & 0x10;
+    cpu.r = state.flags & 0x20;
+    cpu.alu.e = state.flags & 0x40;
+    cpu.io_pending = state.flags & 0x80;
+    cpu.fgt = state.flags & 0x100;
+    cpu.restore_sequence(state.sequence_counter, state.cycle_name);
+    cpu.instruction = state.instruction;
+}
+
+void Journal::record_external(const State& state) {
+    if (has_last && state != last) {
+        reserve_entry();
+        write_count = 0;
+        push(last, state, 0);
+    }
+    last = state;
+    has_last = true;
+}
+
+void Journal::push(
+    const State& from,
+    const State& to,
+    std::size_t entry_cycles
+) {
+    auto& chunk = chunks.back();
+    Entry entry{
+        .cycle_name = from.cycle_name,
+        .cycles = entry_cycles,
+        .write_count = write_count,
+        .changed_registers = 0,
+        .flags = from.flags,
+        .sequence_counter = from.sequence_counter,
+        .instruction = from.instruction,
+    };
+    for (std::size_t i = 0; i < Registers::REGISTER_COUNT; ++i) {
+        if (from.registers[i] != to.registers[i]) {
+            entry.changed_registers |= static_cast<std::uint8_t>(1u << i);
+            chunk.values.push_back(from.registers[i]);
+            value_count += 1;
+        }
+    }
+    chunk.entries.push_back(entry);
+    chunk.cycles += entry_cycles;
+    entry_count += 1;
+    cycles += entry_cycles;
+}
+
+void Journal::reserve_entry() {
+    if (!chunks.empty() && chunks.back().entries.size() < CHUNK_ENTRIES
+        && chunks.back().values.size() < CHUNK_VALUES) {
+        return;
+    }
+    // Drop the oldest history, never the chunk being written.
+    while (chunks.size() > 1
+           && (entry_count >= capacity || value_count >= VALUE_CAPACITY)) {
+        entry_count -= chunks.front().entries.size();
+        value_count -= chunks.front().values.size();
+        cycles -= chunks.front().cycles;
+        chunks.pop_front();
+    }
+    chunks.emplace_back();
+    chunks.back().entries.reserve(CHUNK_ENTRIES);
+}
+
+} // namespace mano
@@ -0,0 +1,722 @@
+#include "emulator/lane_engine.hpp"
+
+#include <bit>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "emulator/bus.hpp"
+
+namespace mano {
+
+#if defined(__AVX2__)
+
+/*
+ * The 16 lanes of a register fill one AVX2 vector, flags are widened to
+ * a 16 bit word per lane, 0 or 1, and the lane masks are either all ones
+ * per selected lane or a bit per lane.
+ * */
+using LaneBits = std::uint32_t;
+
+static __m256i load_lanes(const LaneEngine::Lanes<std::uint16_t>& lanes) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes.data()));
+}
+
+static void
+store_lanes(LaneEngine::Lanes<std::uint16_t>& lanes, __m256i value) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes.data()), value);
+}
+
+static __m128i load_bytes(const LaneEngine::Lanes<std::uint8_t>& lanes) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes.data()));
+}
+
+static __m256i load_flags(const LaneEngine::Lanes<std::uint8_t>& lanes) {
+    return _mm256_cvtepu8_epi16(load_bytes(lanes));
+}
+
+static void
+store_flags(LaneEngine::Lanes<std::uint8_t>& lanes, __m256i value) {
+    const __m128i bytes = _mm_packus_epi16(
+        _mm256_castsi256_si128(value),
+        _mm256_extracti128_si256(value, 1)
+    );
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.data()), bytes);
+}
+
+static LaneBits get_flag_bits(const LaneEngine::Lanes<std::uint8_t>& lanes) {
+    const __m128i set = _mm_cmpgt_epi8(load_bytes(lanes), _mm_setzero_si128());
+    return static_cast<LaneBits>(_mm_movemask_epi8(set));
+}
+
+static LaneBits get_bits(__m256i mask) {
+    // packs keeps the 128 bit halves apart, lanes 8 to 15 land
+    //     in bits 16 to 23.
+    const auto bits = static_cast<LaneBits>(_mm256_movemask_epi8(
+        _mm256_packs_epi16(mask, _mm256_setzero_si256())
+    ));
+    return (bits & 0xFF) | ((bits >> 8) & 0xFF00);
+}
+
+static void
+store_bits(LaneEngine::Lanes<std::uint8_t>& lanes, LaneBits bits) {
+    const __m128i lane_bits = _mm_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128
+    );
+    // Low byte of the bits to lanes 0 to 7, high byte to 8 to 15.
+    const __m128i spread = _mm_shuffle_epi8(
+        _mm_cvtsi32_si128(static_cast<int>(bits)),
+        _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1)
+    );
+    const __m128i set =
+        _mm_cmpeq_epi8(_mm_and_si128(spread, lane_bits), lane_bits);
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(lanes.data()),
+        _mm_and_si128(set, _mm_set1_epi8(1))
+    );
+}
+
+/*
+ * Lanes whose cycle count is below the limit, unsigned 64 bit compares
+ * done signed with the sign bits flipped.
+ * */
+static LaneBits get_below_bits(
+    const LaneEngine::Lanes<std::uint64_t>& cycles,
+    std::uint64_t limit
+) {
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i flipped_limit = _mm256_xor_si256(
+        _mm256_set1_epi64x(static_cast<long long>(limit)),
+        sign
+    );
+    LaneBits bits = 0;
+    for (std::size_t lane = 0; lane < LaneEngine::LANE_COUNT; lane += 4) {
+        const __m256i flipped = _mm256_xor_si256(
+            _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(cycles.data() + lane)
+            ),
+            sign
+        );
+        const auto below = _mm256_movemask_pd(_mm256_castsi256_pd(
+            _mm256_cmpgt_epi64(flipped_limit, flipped)
+        ));
+        bits |= static_cast<LaneBits>(below) << lane;
+    }
+    return bits;
+}
+
+#endif
+
+LaneEngine::LaneEngine(const Memory& memory_image, std::size_t count) :
+    lane_count(count < LANE_COUNT ? count : LANE_COUNT) {
+    // The lanes share the pages of the image until they write to them.
+    memory.reserve(LANE_COUNT);
+    memory.emplace_back(memory_image);
+    while (memory.size() < LANE_COUNT) {
+        memory.push_back(memory.front().fork());
+    }
+    const Cpu cpu;
+    for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        set_cpu(lane, cpu);
+        start_stop[lane] = lane < lane_count;
+    }
+}
+
+void LaneEngine::run(std::uint64_t cycle_limit) {
+    Lanes<std::uint8_t> runnable;
+    Lanes<std::uint8_t> mask;
+    while (true) {
+        // The lowest PC leads so the lanes behind catch up with it,
+        //     lanes that need the interrupt cycle go first.
+#if defined(__AVX2__)
+        const LaneBits runnable_bits = get_flag_bits(start_stop)
+                                       & ~get_flag_bits(io_pending)
+                                       & get_below_bits(cycles, cycle_limit);
+        store_bits(runnable, runnable_bits);
+        const bool interrupting = (runnable_bits & get_flag_bits(r)) != 0;
+        const auto runnable_count =
+            static_cast<std::size_t>(std::popcount(runnable_bits));
+
+        // Halted lanes sort last, minpos finds the lowest PC and the first
+        //     lane on it in each half.
+        const __m256i keys = _mm256_or_si256(
+            load_lanes(pc),
+            _mm256_cmpeq_epi16(load_flags(runnable), _mm256_setzero_si256())
+        );
+        const __m128i low = _mm_minpos_epu16(_mm256_castsi256_si128(keys));
+        const __m128i high =
+            _mm_minpos_epu16(_mm256_extracti128_si256(keys, 1));
+        const auto low_address = static_cast<std::uint16_t>(
+            _mm_extract_epi16(low, 0)
+        );
+        const auto high_address = static_cast<std::uint16_t>(
+            _mm_extract_epi16(high, 0)
+        );
+        const bool low_leads = low_address <= high_address;
+        const std::uint16_t address = low_leads ? low_address : high_address;
+        if (address == 0xFFFF) {
+            return;
+        }
+        const auto leader = static_cast<std::size_t>(
+            low_leads ? _mm_extract_epi16(low, 1)
+                      : 8 + _mm_extract_epi16(high, 1)
+        );
+#else
+        std::uint8_t interrupting = 0;
+        std::size_t runnable_count = 0;
+        std::uint16_t address = 0xFFFF;
+        for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+            runnable[lane] = static_cast<std::uint8_t>(
+                start_stop[lane] & !io_pending[lane]
+                & (cycles[lane] < cycle_limit)
+            );
+            interrupting |=
+                static_cast<std::uint8_t>(runnable[lane] & r[lane]);
+            runnable_count += runnable[lane];
+            const std::uint16_t key = runnable[lane] ? pc[lane] : 0xFFFF;
+            address = key < address ? key : address;
+        }
+
+        if (address == 0xFFFF) {
+            return;
+        }
+
+        std::size_t leader = 0;
+        while (!runnable[leader] || pc[leader] != address) {
+            leader += 1;
+        }
+#endif
+        if (runnable_count == 1) {
+            // Nothing to share the dispatch with.
+            run_lane(leader, cycle_limit);
+            continue;
+        }
+
+        if (interrupting) {
+            for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+                mask[lane] = runnable[lane] & r[lane];
+            }
+            interrupt(mask);
+            continue;
+        }
+
+        const auto word = memory[leader][address];
+        const auto decode = Instruction::decode(word);
+        if (decode == Instr::Undefined) {
+            // Keeps the lane's own stale instruction.
+            run_lane(leader, cycles[leader] + 1);
+            continue;
+        }
+
+#if defined(__AVX2__)
+        // Only the lanes on the address compare their own word.
+        LaneBits selected = runnable_bits & get_bits(_mm256_cmpeq_epi16(
+            load_lanes(pc),
+            _mm256_set1_epi16(static_cast<short>(address))
+        ));
+        for (LaneBits rest = selected; rest != 0; rest &= rest - 1) {
+            const auto lane = static_cast<std::size_t>(std::countr_zero(rest));
+            if (memory[lane][address] != word) {
+                selected &= ~(LaneBits{1} << lane);
+            }
+        }
+        store_bits(mask, selected);
+#else
+        const PagedMemory* lane_memory = memory.data();
+        for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+            mask[lane] = runnable[lane] & (pc[lane] == address)
+                         & (lane_memory[lane][address] == word);
+        }
+#endif
+        execute(mask, word, decode);
+    }
+}
+
+#if defined(__AVX2__)
+
+void LaneEngine::execute(
+    const Lanes<std::uint8_t>& lane_mask,
+    std::uint16_t word,
+    Instr decode
+) {
+    const __m128i select_bytes =
+        _mm_cmpgt_epi8(load_bytes(lane_mask), _mm_setzero_si128());
+    const __m256i select_mask = _mm256_cvtepi8_epi16(select_bytes);
+    const auto selected =
+        static_cast<LaneBits>(_mm_movemask_epi8(select_bytes));
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i all_ones = _mm256_set1_epi16(-1);
+    const __m256i address_mask = _mm256_set1_epi16(0xFFF);
+
+    // Stores the new value to the lanes in the mask.
+    const auto select = [&](Lanes<std::uint16_t>& lanes, __m256i value) {
+        store_lanes(
+            lanes,
+            _mm256_blendv_epi8(load_lanes(lanes), value, select_mask)
+        );
+    };
+    const auto select_flag = [&](Lanes<std::uint8_t>& lanes, __m256i value) {
+        store_flags(
+            lanes,
+            _mm256_blendv_epi8(load_flags(lanes), value, select_mask)
+        );
+    };
+    // condition is all ones on the lanes that skip.
+    const auto skip_if = [&](__m256i condition) {
+        const __m256i next = _mm256_and_si256(
+            _mm256_sub_epi16(load_lanes(pc), condition),
+            address_mask
+        );
+        select(pc, next);
+    };
+    // Memory stays per lane, every lane has its own.
+    const auto for_each_lane = [&](auto&& body) {
+        for (LaneBits rest = selected; rest != 0; rest &= rest - 1) {
+            body(static_cast<std::size_t>(std::countr_zero(rest)));
+        }
+    };
+
+    // Fetch and decode, the same word on every lane in the mask.
+    select(ir, _mm256_set1_epi16(static_cast<short>(word)));
+    select(
+        pc,
+        _mm256_and_si256(_mm256_add_epi16(load_lanes(pc), one), address_mask)
+    );
+    select(ar, _mm256_set1_epi16(static_cast<short>(word & 0xFFF)));
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(indirect.data()),
+        _mm_blendv_epi8(
+            load_bytes(indirect),
+            _mm_set1_epi8(static_cast<char>(word >> 15)),
+            select_bytes
+        )
+    );
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(instruction.data()),
+        _mm_blendv_epi8(
+            _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(instruction.data())
+            ),
+            _mm_set1_epi8(static_cast<char>(decode)),
+            select_bytes
+        )
+    );
+    const std::uint64_t cycle_count = Instruction::get_cycle_count(decode);
+    for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        cycles[lane] += lane_mask[lane] ? cycle_count : 0;
+    }
+
+    if (Instruction::is_mri(decode) && (word & 0x8000)) {
+        for_each_lane([&](std::size_t lane) {
+            ar[lane] = memory[lane][ar[lane]] & 0xFFF;
+        });
+    }
+
+    // Memory reads for AND, ADD and LDA.
+    const auto load_dr = [&] {
+        for_each_lane([&](std::size_t lane) {
+            dr[lane] = memory[lane][ar[lane]];
+        });
+        return load_lanes(dr);
+    };
+
+    switch (decode) {
+        case Instr::AND:
+            select(ac, _mm256_and_si256(load_lanes(ac), load_dr()));
+            break;
+        case Instr::ADD:
+        {
+            const __m256i ac_lanes = load_lanes(ac);
+            const __m256i sum = _mm256_add_epi16(ac_lanes, load_dr());
+            // Carry out when the sum wrapped below AC. E is set on carry
+            //     but never cleared, same as Alu::operate.
+            const __m256i no_carry =
+                _mm256_cmpeq_epi16(_mm256_max_epu16(sum, ac_lanes), sum);
+            const __m256i carry = _mm256_andnot_si256(no_carry, one);
+            select_flag(e, _mm256_or_si256(load_flags(e), carry));
+            select(ac, sum);
+            break;
+        }
+        case Instr::LDA:
+            select(ac, load_dr());
+            break;
+        case Instr::STA:
+            for_each_lane([&](std::size_t lane) {
+                memory[lane].write(ar[lane], ac[lane]);
+            });
+            break;
+        case Instr::BUN:
+            select(pc, load_lanes(ar));
+            break;
+        case Instr::BSA:
+        {
+            for_each_lane([&](std::size_t lane) {
+                memory[lane].write(ar[lane], pc[lane]);
+            });
+            const __m256i next = _mm256_and_si256(
+                _mm256_add_epi16(load_lanes(ar), one),
+                address_mask
+            );
+            select(ar, next);
+            select(pc, next);
+            break;
+        }
+        case Instr::ISZ:
+            for_each_lane([&](std::size_t lane) {
+                dr[lane] = static_cast<std::uint16_t>(
+                    memory[lane][ar[lane]] + 1
+                );
+                memory[lane].write(ar[lane], dr[lane]);
+            });
+            skip_if(_mm256_cmpeq_epi16(load_lanes(dr), zero));
+            break;
+        case Instr::CLA:
+            select(ac, zero);
+            break;
+        case Instr::CLE:
+            select_flag(e, zero);
+            break;
+        case Instr::CMA:
+            select(ac, _mm256_xor_si256(load_lanes(ac), all_ones));
+            break;
+        case Instr::CME:
+            select_flag(e, _mm256_xor_si256(load_flags(e), one));
+            break;
+        case Instr::CIR:
+        {
+            const __m256i ac_lanes = load_lanes(ac);
+            select(ac, _mm256_or_si256(
+                _mm256_slli_epi16(load_flags(e), 15),
+                _mm256_srli_epi16(ac_lanes, 1)
+            ));
+            select_flag(e, _mm256_and_si256(ac_lanes, one));
+            break;
+        }
+        case Instr::CIL:
+        {
+            const __m256i ac_lanes = load_lanes(ac);
+            select(ac, _mm256_or_si256(
+                load_flags(e),
+                _mm256_slli_epi16(ac_lanes, 1)
+            ));
+            select_flag(e, _mm256_srli_epi16(ac_lanes, 15));
+            break;
+        }
+        case Instr::INC:
+            select(ac, _mm256_add_epi16(load_lanes(ac), one));
+            break;
+        case Instr::SPA:
+            skip_if(_mm256_cmpgt_epi16(load_lanes(ac), all_ones));
+            break;
+        case Instr::SNA:
+            skip_if(_mm256_cmpgt_epi16(zero, load_lanes(ac)));
+            break;
+        case Instr::SZA:
+            skip_if(_mm256_cmpeq_epi16(load_lanes(ac), zero));
+            break;
+        case Instr::SZE:
+            skip_if(_mm256_cmpeq_epi16(load_flags(e), zero));
+            break;
+        case Instr::HLT:
+            select_flag(start_stop, zero);
+            break;
+        case Instr::INP:
+            select(ac, load_lanes(inpr));
+            select_flag(fgi, zero);
+            select_flag(io_pending, one);
+            break;
+        case Instr::OUT:
+            select(outr, _mm256_and_si256(
+                load_lanes(ac),
+                _mm256_set1_epi16(0xFF)
+            ));
+            select_flag(fgo, zero);
+            select_flag(io_pending, one);
+            break;
+        case Instr::SKI:
+            skip_if(_mm256_cmpeq_epi16(load_flags(fgi), one));
+            break;
+        case Instr::SKO:
+            skip_if(_mm256_cmpeq_epi16(load_flags(fgo), one));
+            break;
+        case Instr::ION:
+            select_flag(ien, one);
+            break;
+        case Instr::IOF:
+            select_flag(ien, zero);
+            break;
+        default:
+            break;
+    }
+
+    select_flag(r, _mm256_and_si256(
+        load_flags(ien),
+        _mm256_or_si256(load_flags(fgi), load_flags(fgo))
+    ));
+}
+
+#else
+
+void LaneEngine::execute(
+    const Lanes<std::uint8_t>& lane_mask,
+    std::uint16_t word,
+    Instr decode
+) {
+    // Local copy, the compiler can't tell whether the stores
+    //     to the lanes change the mask otherwise.
+    const Lanes<std::uint8_t> mask = lane_mask;
+    // Selects the new value for the lanes in the mask.
+    const auto select = [&](Lanes<std::uint16_t>& lanes, auto&& value) {
+        for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+            const auto result = static_cast<std::uint16_t>(value(lane));
+            lanes[lane] = mask[lane] ? result : lanes[lane];
+        }
+    };
+    const auto select_flag = [&](Lanes<std::uint8_t>& lanes, auto&& value) {
+        for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+            const auto result = static_cast<std::uint8_t>(value(lane));
+            lanes[lane] = mask[lane] ? result : lanes[lane];
+        }
+    };
+    const auto skip_if = [&](auto&& condition) {
+        select(pc, [&](std::size_t lane) {
+            return static_cast<std::uint16_t>(
+                (pc[lane] + (condition(lane) ? 1 : 0)) & 0xFFF
+            );
+        });
+    };
+
+    // Fetch and decode, the same word on every lane in the mask.
+    const std::uint64_t cycle_count = Instruction::get_cycle_count(decode);
+    for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        const bool selected = mask[lane];
+        ir[lane] = selected ? word : ir[lane];
+        pc[lane] = selected ? (pc[lane] + 1) & 0xFFF : pc[lane];
+        ar[lane] = selected ? word & 0xFFF : ar[lane];
+        indirect[lane] =
+            selected ? static_cast<std::uint8_t>(word >> 15) : indirect[lane];
+        instruction[lane] = selected ? decode : instruction[lane];
+        cycles[lane] += selected ? cycle_count : 0;
+    }
+
+    if (Instruction::is_mri(decode) && (word & 0x8000)) {
+        for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+            if (mask[lane]) {
+                ar[lane] = memory[lane][ar[lane]] & 0xFFF;
+            }
+        }
+    }
+
+    // Memory reads for AND, ADD and LDA.
+    const auto load_dr = [&] {
+        for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+            if (mask[lane]) {
+                dr[lane] = memory[lane][ar[lane]];
+            }
+        }
+    };
+
+    switch (decode) {
+        case Instr::AND:
+            load_dr();
+            select(ac, [&](std::size_t lane) { return ac[lane] & dr[lane]; });
+            break;
+        case Instr::ADD:
+            load_dr();
+            // E is set on carry but never cleared, same as Alu::operate.
+            select_flag(e, [&](std::size_t lane) {
+                return e[lane] | ((ac[lane] + dr[lane]) > 0xFFFF);
+            });
+            select(ac, [&](std::size_t lane) {
+                return static_cast<std::uint16_t>(ac[lane] + dr[lane]);
+            });
+            break;
+        case Instr::LDA:
+            load_dr();
+            select(ac, [&](std::size_t lane) { return dr[lane]; });
+            break;
+        case Instr::STA:
+            for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+                if (mask[lane]) {
+                    memory[lane].write(ar[lane], ac[lane]);
+                }
+            }
+            break;
+        case Instr::BUN:
+            select(pc, [&](std::size_t lane) { return ar[lane]; });
+            break;
+        case Instr::BSA:
+            for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+                if (mask[lane]) {
+                    memory[lane].write(ar[lane], pc[lane]);
+                    ar[lane] = (ar[lane] + 1) & 0xFFF;
+                    pc[lane] = ar[lane];
+                }
+            }
+            break;
+        case Instr::ISZ:
+            for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+                if (mask[lane]) {
+                    dr[lane] = static_cast<std::uint16_t>(
+                        memory[lane][ar[lane]] + 1
+                    );
+                    memory[lane].write(ar[lane], dr[lane]);
+                }
+            }
+            skip_if([&](std::size_t lane) { return dr[lane] == 0; });
+            break;
+        case Instr::CLA:
+            select(ac, [](std::size_t) { return 0; });
+            break;
+        case Instr::CLE:
+            select_flag(e, [](std::size_t) { return 0; });
+            break;
+        case Instr::CMA:
+            select(ac, [&](std::size_t lane) { return ~ac[lane]; });
+            break;
+        case Instr::CME:
+            select_flag(e, [&](std::size_t lane) { return !e[lane]; });
+            break;
+        case Instr::CIR:
+        {
+            const auto carry = ac;
+            select(ac, [&](std::size_t lane) {
+                return (e[lane] << 15) | (ac[lane] >> 1);
+            });
+            select_flag(e, [&](std::size_t lane) { return carry[lane] & 0x1; });
+            break;
+        }
+        case Instr::CIL:
+        {
+            const auto carry = ac;
+            select(ac, [&](std::size_t lane) {
+                return e[lane] | (ac[lane] << 1);
+            });
+            select_flag(e, [&](std::size_t lane) {
+                return (carry[lane] >> 15) & 0x1;
+            });
+            break;
+        }
+        case Instr::INC:
+            select(ac, [&](std::size_t lane) { return ac[lane] + 1; });
+            break;
+        case Instr::SPA:
+            skip_if([&](std::size_t lane) { return (ac[lane] >> 15) == 0; });
+            break;
+        case Instr::SNA:
+            skip_if([&](std::size_t lane) { return (ac[lane] >> 15) != 0; });
+            break;
+        case Instr::SZA:
+            skip_if([&](std::size_t lane) { return ac[lane] == 0; });
+            break;
+        case Instr::SZE:
+            skip_if([&](std::size_t lane) { return e[lane] == 0; });
+            break;
+        case Instr::HLT:
+            select_flag(start_stop, [](std::size_t) { return 0; });
+            break;
+        case Instr::INP:
+            select(ac, [&](std::size_t lane) { return inpr[lane]; });
+            select_flag(fgi, [](std::size_t) { return 0; });
+            select_flag(io_pending, [](std::size_t) { return 1; });
+            break;
+        case Instr::OUT:
+            select(outr, [&](std::size_t lane) { return ac[lane] & 0xFF; });
+            select_flag(fgo, [](std::size_t) { return 0; });
+            select_flag(io_pending, [](std::size_t) { return 1; });
+            break;
+        case Instr::SKI:
+            skip_if([&](std::size_t lane) { return fgi[lane] != 0; });
+            break;
+        case Instr::SKO:
+            skip_if([&](std::size_t lane) { return fgo[lane] != 0; });
+            break;
+        case Instr::ION:
+            select_flag(ien, [](std::size_t) { return 1; });
+            break;
+        case Instr::IOF:
+            select_flag(ien, [](std::size_t) { return 0; });
+            break;
+        default:
+            break;
+    }
+
+    select_flag(r, [&](std::size_t lane) {
+        return ien[lane] & (fgi[lane] | fgo[lane]);
+    });
+}
+
+#endif
+
+void LaneEngine::interrupt(const Lanes<std::uint8_t>& mask) {
+    for (std::size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        if (mask[lane]) {
+            // M[0] <- PC, PC <- 1, same as Cpu::step_instruction.
+            ar[lane] = 0;
+            tr[lane] = pc[lane];
+            memory[lane].write(0, tr[lane]);
+            pc[lane] = 1;
+            ien[lane] = false;
+            r[lane] = false;
+            cycles[lane] += 3;
+        }
+    }
+}
+
+void LaneEngine::run_lane(std::size_t lane, std::uint64_t cycle_limit) {
+    Cpu cpu = get_cpu(lane);
+    Bus bus(cpu, memory[lane]);
+    auto lane_cycles = cycles[lane];
+    do {
+        lane_cycles += cpu.step_instruction(bus);
+    } while (cpu.start_stop && !cpu.io_pending && lane_cycles < cycle_limit);
+    cycles[lane] = lane_cycles;
+    set_cpu(lane, cpu);
+}
+
+Cpu LaneEngine::get_cpu(std::size_t lane) const {
+    Cpu cpu;
+    cpu.registers.set(Registers::AR, ar[lane]);
+    cpu.registers.set(Registers::PC, pc[lane]);
+    cpu.registers.set(Registers::DR, dr[lane]);
+    cpu.registers.set(Registers::AC, ac[lane]);
+    cpu.registers.set(Registers::IR, ir[lane]);
+    cpu.registers.set(Registers::TR, tr[lane]);
+    cpu.registers.set(Registers::OUTR, outr[lane]);
+    cpu.registers.set(Registers::INPR, inpr[lane]);
+    cpu.alu.e = e[lane];
+    cpu.start_stop = start_stop[lane];
+    cpu.indirect = indirect[lane];
+    cpu.fgi = fgi[lane];
+    cpu.fgo = fgo[lane];
+    cpu.ien = ien[lane];
+    cpu.r = r[lane];
+    cpu.io_pending = io_pending[lane];
+    cpu.instruction = instruction[lane];
+    return cpu;
+}
+
+void LaneEngine::set_cpu(std::size_t lane, const Cpu& cpu) {
+    ar[lane] = cpu.registers.get(Registers::AR);
+    pc[lane] = cpu.registers.get(Registers::PC);
+    dr[lane] = cpu.registers.get(Registers::DR);
+    ac[lane] = cpu.registers.get(Registers::AC);
+    ir[lane] = cpu.registers.get(Registers::IR);
+    tr[lane] = cpu.registers.get(Registers::TR);
+    outr[lane] = cpu.registers.get(Registers::OUTR);
+    inpr[lane] = cpu.registers.get(Registers::INPR);
+    e[lane] = cpu.alu.e;
+    start_stop[lane] = cpu.start_stop;
+    indirect[lane] = cpu.indirect;
+    fgi[lane] = cpu.fgi;
+    fgo[lane] = cpu.fgo;
+    ien[lane] = cpu.ien;
+    r[lane] = cpu.r;
+    io_pending[lane] = cpu.io_pending;
+    instruction[lane] = cpu.instruction;
+}
+
+} // namespace mano
@@ -0,0 +1,114 @@
+#include "emulator/lockstep.hpp"
+
+#include <format>
+
+namespace mano {
+
+static constexpr std::size_t MAX_DISPATCH_CYCLES = 64;
+
+Lockstep::Lockstep(const Memory& memory, Emulator::Engine engine) :
+    reference(memory),
+    emulator(memory) {
+    emulator.set_engine(engine);
+}
+
+std::optional<std::string> Lockstep::run(std::size_t cycle_budget) {
+    std::size_t executed = 0;
+    while (executed < cycle_budget && emulator.cpu.start_stop) {
+        const std::size_t dispatch_cycles =
+            1 + dispatch_count % MAX_DISPATCH_CYCLES;
+        dispatch_count += 1;
+
+        const std::size_t count = emulator.run(dispatch_cycles);
+        for (std::size_t i = 0; i < count; ++i) {
+            reference.cycle();
+        }
+        executed += count;
+        cycles += count;
+
+        if (auto difference = compare(reference, emulator)) {
+            return std::format("Cycle {}: {}", cycles, *difference);
+        }
+    }
+    return {};
+}
+
+std::optional<std::string>
+Lockstep::compare(const Emulator& expected, const Emulator& actual) {
+    static constexpr std::string_view REGISTER_NAMES[] = {
+        "AR", "PC", "DR", "AC", "IR", "TR", "OUTR", "INPR"
+    };
+    for (std::size_t i = 0; i < Registers::REGISTER_COUNT; ++i) {
+        const auto expected_value = expected.cpu.registers.get(i);
+        const auto actual_value = actual.cpu.registers.get(i);
+        if (expected_value != actual_value) {
+            return std::format(
+                "{} is {:04x}, expected {:04x}",
+                REGISTER_NAMES[i],
+                actual_value,
+                expected_value
+            );
+        }
+    }
+
+    const auto compare_flag = [](std::string_view name,
+                                 bool expected_flag,
+                                 bool actual_flag) -> std::optional<std::string> {
+        if (expected_flag != actual_flag) {
+            return std::format(
+                "{} is {}, expected {}",
+                name,
+                actual_flag,
+                expected_flag
+            );
+        }
+        return {};
+    };
+    const auto& e = expected.cpu;
+    const auto& a = actual.cpu;
+    for (auto difference : {
+             compare_flag("E", e.alu.e, a.alu.e),
+             compare_flag("S", e.start_stop, a.start_stop),
+             compare_flag("I", e.indirect, a.indirect),
+             compare_flag("FGI", e.fgi, a.fgi),
+             compare_flag("FGO", e.fgo, a.fgo),
+             compare_flag("FGT", e.fgt, a.fgt),
+             compare_flag("IEN", e.ien, a.ien),
+             compare_flag("R", e.r, a.r),
+         }) {
+        if (difference) {
+            return difference;
+        }
+    }
+
+    if (e.get_sequence_counter() != a.get_sequence_counter()) {
+        return std::format(
+            "SC is {}, expected {}",
+            a.get_sequence_counter(),
+            e.get_sequence_counter()
+        );
+    }
+    if (e.instruction != a.instruction) {
+        return std::format(
+            "Decoded instruction is {}, expected {}",
+            Instruction::from_instr(a.instruction).mnemonic,
+            Instruction::from_instr(e.instruction).mnemonic
+        );
+    }
+
+    for (std::size_t address = 0; address < MEMORY_SIZE; ++address) {
+        const auto expected_word = expected.get_memory()[address];
+        const auto actual_word = actual.get_memory()[address];
+        if (expected_word != actual_word) {
+            return std::format(
+                "M[{:03x}] is {:04x}, expected {:04x}",
+                address,
+                actual_word,
+                expected_word
+            );
+        }
+    }
+    return {};
+}
+
+} // namespace mano
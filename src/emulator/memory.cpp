@@ -0,0 +1,58 @@
+#include "emulator/memory.hpp"
+
+#include <algorithm>
+
+namespace mano {
+
+PagedMemory::PagedMemory(const Memory& image) {
+    for (std::size_t page = 0; page < PAGE_COUNT; ++page) {
+        pages[page] = std::make_shared<Page>();
+        std::copy_n(
+            image.begin() + static_cast<std::ptrdiff_t>(page * PAGE_SIZE),
+            PAGE_SIZE,
+            pages[page]->begin()
+        );
+        words[page] = pages[page]->data();
+    }
+    owned_pages = (1u << PAGE_COUNT) - 1;
+}
+
+PagedMemory PagedMemory::fork() {
+    PagedMemory memory;
+    memory.pages = pages;
+    memory.words = words;
+    // Neither side may write to the shared pages anymore.
+    owned_pages = 0;
+    return memory;
+}
+
+Memory PagedMemory::get_image() const {
+    Memory image;
+    for (std::size_t page = 0; page < PAGE_COUNT; ++page) {
+        std::copy_n(
+            words[page],
+            PAGE_SIZE,
+            image.begin() + static_cast<std::ptrdiff_t>(page * PAGE_SIZE)
+        );
+    }
+    return image;
+}
+
+std::size_t PagedMemory::get_shared_page_count() const {
+    return static_cast<std::size_t>(std::count_if(
+        pages.begin(),
+        pages.end(),
+        [](const auto& page) { return page.use_count() > 1; }
+    ));
+}
+
+void PagedMemory::detach(std::size_t page) {
+    // The forks that shared it may be gone already.
+    if (pages[page].use_count() != 1) {
+        pages[page] = std::make_shared<Page>(*pages[page]);
+        words[page] = pages[page]->data();
+    }
+    owned_pages |= 1u << page;
+}
+
+} // namespace mano
@@ -0,0 +1,716 @@
+#include "emulator/native_code.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#include "emulator/instructions.hpp"
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+    #define MANO_NATIVE_CODE
+    #include <sys/mman.h>
+#endif
+
+namespace mano {
+
+#if defined(MANO_NATIVE_CODE)
+
+namespace {
+
+// Register numbers of the x86-64 encoding.
+enum Reg : unsigned {
+    RAX = 0,
+    RCX = 1,
+    RDX = 2,
+    RBX = 3,
+    RSP = 4,
+    RBP = 5,
+    RSI = 6,
+    RDI = 7,
+    R12 = 12,
+    R13 = 13,
+    R14 = 14,
+    R15 = 15,
+};
+
+// Registers the generated code keeps from the entry to the exit, all
+//     preserved across the calls to the write handler.
+constexpr Reg STATE = RBX;
+constexpr Reg AC = R12;
+constexpr Reg DR = R13;
+constexpr Reg AR = R14;
+constexpr Reg PC = R15;
+constexpr Reg E = RBP;
+
+// Callee-saved registers of the System V convention the code uses, pushed
+//     in this order by the entry.
+constexpr Reg SAVED[] = {RBX, RBP, R12, R13, R14, R15};
+
+// Condition codes of jcc and cmovcc.
+enum Condition : unsigned {
+    BELOW = 0x2,
+    ABOVE_OR_EQUAL = 0x3,
+    EQUAL = 0x4,
+    ABOVE = 0x7,
+};
+
+// The /digit of the group 1 and shift opcodes.
+enum Group : unsigned {
+    ADD = 0,
+    OR = 1,
+    AND = 4,
+    SUB = 5,
+    XOR = 6,
+    SHL = 4,
+    SHR = 5,
+};
+
+// Opcodes of op r/m, r.
+constexpr unsigned OP_ADD = 0x01;
+constexpr unsigned OP_OR = 0x09;
+constexpr unsigned OP_AND = 0x21;
+constexpr unsigned OP_XOR = 0x31;
+constexpr unsigned OP_TEST = 0x85;
+constexpr unsigned OP_MOV = 0x89;
+
+constexpr auto PAGES_OFFSET = offsetof(NativeCode::State, pages);
+constexpr auto LINKS_OFFSET = offsetof(NativeCode::State, links);
+constexpr auto CYCLES_OFFSET = offsetof(NativeCode::State, cycles);
+constexpr auto LIMIT_OFFSET = offsetof(NativeCode::State, cycle_limit);
+constexpr auto AC_OFFSET = offsetof(NativeCode::State, ac);
+constexpr auto DR_OFFSET = offsetof(NativeCode::State, dr);
+constexpr auto AR_OFFSET = offsetof(NativeCode::State, ar);
+constexpr auto PC_OFFSET = offsetof(NativeCode::State, pc);
+constexpr auto IR_OFFSET = offsetof(NativeCode::State, ir);
+constexpr auto E_OFFSET = offsetof(NativeCode::State, e);
+
+/*
+ * Encodes the handful of instructions the code needs, for the address the
+ * bytes are going to be copied to. Memory operands are [base + disp32] or
+ * [base + index * scale], base is never RSP, RBP, R12 or R13 and index
+ * never above RDI, which keeps them free of the special cases of the
+ * encoding.
+ * */
+class Emitter {
+  public:
+    explicit Emitter(NativeCode::Block code_address) :
+        address(code_address) {}
+
+    std::vector<std::uint8_t> bytes;
+
+    void byte(unsigned value) {
+        bytes.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    void u32(std::uint32_t value) {
+        for (std::size_t i = 0; i < 4; ++i) {
+            byte(value >> (8 * i));
+        }
+    }
+
+    void u64(std::uint64_t value) {
+        u32(static_cast<std::uint32_t>(value));
+        u32(static_cast<std::uint32_t>(value >> 32));
+    }
+
+    // REX prefix when the operands or the size need it.
+    void rex(bool wide, unsigned reg, unsigned rm) {
+        const unsigned prefix =
+            0x40 | (wide ? 8u : 0u) | ((reg >> 3) << 2) | (rm >> 3);
+        if (prefix != 0x40) {
+            byte(prefix);
+        }
+    }
+
+    void modrm_register(unsigned reg, unsigned rm) {
+        byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    void modrm_memory(unsigned reg, Reg base, std::size_t disp) {
+        byte(0x80 | ((reg & 7) << 3) | (base & 7));
+        u32(static_cast<std::uint32_t>(disp));
+    }
+
+    void modrm_indexed(unsigned reg, Reg base, Reg index, unsigned scale) {
+        byte(0x04 | ((reg & 7) << 3));
+        byte((scale << 6) | ((index & 7) << 3) | (base & 7));
+    }
+
+    // op rm, reg with 32 bit operands.
+    void op(unsigned opcode, Reg rm, Reg reg) {
+        rex(false, reg, rm);
+        byte(opcode);
+        modrm_register(reg, rm);
+    }
+
+    void mov(Reg dst, Reg src) {
+        op(OP_MOV, dst, src);
+    }
+
+    void mov64(Reg dst, Reg src) {
+        rex(true, src, dst);
+        byte(OP_MOV);
+        modrm_register(src, dst);
+    }
+
+    void mov(Reg dst, std::uint32_t imm) {
+        rex(false, 0, dst);
+        byte(0xB8 + (dst & 7));
+        u32(imm);
+    }
+
+    // Group 1 operation with a 32 bit immediate.
+    void op(Group group, Reg rm, std::uint32_t imm) {
+        rex(false, 0, rm);
+        byte(0x81);
+        modrm_register(group, rm);
+        u32(imm);
+    }
+
+    // Group 1 operation on 64 bits with a sign extended immediate.
+    void op64(Group group, Reg rm, std::uint32_t imm) {
+        rex(true, 0, rm);
+        byte(0x81);
+        modrm_register(group, rm);
+        u32(imm);
+    }
+
+    void op64(Group group, Reg base, std::size_t disp, std::uint32_t imm) {
+        rex(true, 0, base);
+        byte(0x81);
+        modrm_memory(group, base, disp);
+        u32(imm);
+    }
+
+    void cmp64(Reg reg, Reg base, std::size_t disp) {
+        rex(true, reg, base);
+        byte(0x3B);
+        modrm_memory(reg, base, disp);
+    }
+
+    void test64(Reg rm, Reg reg) {
+        rex(true, reg, rm);
+        byte(OP_TEST);
+        modrm_register(reg, rm);
+    }
+
+    void shift(Group group, Reg rm, unsigned count) {
+        rex(false, 0, rm);
+        byte(0xC1);
+        modrm_register(group, rm);
+        byte(count);
+    }
+
+    void movzx16(Reg dst, Reg src) {
+        rex(false, dst, src);
+        byte(0x0F);
+        byte(0xB7);
+        modrm_register(dst, src);
+    }
+
+    void cmov(Condition condition, Reg dst, Reg src) {
+        rex(false, dst, src);
+        byte(0x0F);
+        byte(0x40 + condition);
+        modrm_register(dst, src);
+    }
+
+    // Copies the bit to CF.
+    void bt(Reg rm, unsigned bit) {
+        rex(false, 0, rm);
+        byte(0x0F);
+        byte(0xBA);
+        modrm_register(4, rm);
+        byte(bit);
+    }
+
+    void load16(Reg dst, Reg base, std::size_t disp) {
+        rex(false, dst, base);
+        byte(0x0F);
+        byte(0xB7);
+        modrm_memory(dst, base, disp);
+    }
+
+    void load16(Reg dst, Reg base, Reg index) {
+        rex(false, dst, base);
+        byte(0x0F);
+        byte(0xB7);
+        modrm_indexed(dst, base, index, 1);
+    }
+
+    void load8(Reg dst, Reg base, std::size_t disp) {
+        rex(false, dst, base);
+        byte(0x0F);
+        byte(0xB6);
+        modrm_memory(dst, base, disp);
+    }
+
+    void load64(Reg dst, Reg base, std::size_t disp) {
+        rex(true, dst, base);
+        byte(0x8B);
+        modrm_memory(dst, base, disp);
+    }
+
+    void load64(Reg dst, Reg base, Reg index) {
+        rex(true, dst, base);
+        byte(0x8B);
+        modrm_indexed(dst, base, index, 3);
+    }
+
+    void store64(Reg base, std::size_t disp, Reg src) {
+        rex(true, src, base);
+        byte(OP_MOV);
+        modrm_memory(src, base, disp);
+    }
+
+    void store16(Reg base, std::size_t disp, Reg src) {
+        byte(0x66);
+        rex(false, src, base);
+        byte(OP_MOV);
+        modrm_memory(src, base, disp);
+    }
+
+    void store16(Reg base, std::size_t disp, std::uint16_t imm) {
+        byte(0x66);
+        rex(false, 0, base);
+        byte(0xC7);
+        modrm_memory(0, base, disp);
+        byte(imm & 0xFFu);
+        byte(imm >> 8);
+    }
+
+    // src must be one of RAX to RBX, the others need a REX for their
+    //     low byte.
+    void store8(Reg base, std::size_t disp, Reg src) {
+        rex(false, src, base);
+        byte(0x88);
+        modrm_memory(src, base, disp);
+    }
+
+    void push(Reg reg) {
+        rex(false, 0, reg);
+        byte(0x50 + (reg & 7));
+    }
+
+    void pop(Reg reg) {
+        rex(false, 0, reg);
+        byte(0x58 + (reg & 7));
+    }
+
+    void call(const void* function) {
+        rex(true, 0, RAX);
+        byte(0xB8);
+        u64(std::bit_cast<std::uint64_t>(function));
+        byte(0xFF);
+        modrm_register(2, RAX);
+    }
+
+    void jump(Reg target) {
+        rex(false, 0, target);
+        byte(0xFF);
+        modrm_register(4, target);
+    }
+
+    void jump(NativeCode::Block target) {
+        byte(0xE9);
+        relative(target);
+    }
+
+    void jump(Condition condition, NativeCode::Block target) {
+        byte(0x0F);
+        byte(0x80 + condition);
+        relative(target);
+    }
+
+    // Conditional jump over the code up to the matching land.
+    std::size_t jump_short(Condition condition) {
+        byte(0x70 + condition);
+        byte(0);
+        return bytes.size();
+    }
+
+    void land(std::size_t jump) {
+        bytes[jump - 1] = static_cast<std::uint8_t>(bytes.size() - jump);
+    }
+
+  private:
+    // rel32 of a jump to the target, from the end of the operand.
+    void relative(NativeCode::Block target) {
+        const auto end = address + bytes.size() + 4;
+        u32(static_cast<std::uint32_t>(target - end));
+    }
+
+    NativeCode::Block address;
+};
+
+/*
+ * Reads M[address] into EAX.
+ * */
+void emit_read(Emitter& emitter, std::uint16_t address) {
+    emitter.load64(RAX, STATE, PAGES_OFFSET);
+    emitter.load64(RAX, RAX, std::size_t{address / 256u} * 8);
+    emitter.load16(RAX, RAX, std::size_t{address % 256u} * 2);
+}
+
+/*
+ * Reads M[AR] into EAX.
+ * */
+void emit_read(Emitter& emitter) {
+    emitter.mov(RCX, AR);
+    emitter.shift(SHR, RCX, 8);
+    emitter.load64(RAX, STATE, PAGES_OFFSET);
+    emitter.load64(RAX, RAX, RCX);
+    emitter.mov(RCX, AR);
+    emitter.op(AND, RCX, 0xFF);
+    emitter.load16(RAX, RAX, RCX);
+}
+
+/*
+ * Calls the write handler for M[AR] <- EDX, leaves its result in AL.
+ * */
+void emit_write(Emitter& emitter, NativeCode::WriteHandler write) {
+    emitter.mov64(RDI, STATE);
+    emitter.mov(RSI, AR);
+    emitter.call(std::bit_cast<const void*>(write));
+}
+
+/*
+ * Skips the next instruction when the condition holds.
+ * */
+void emit_skip(Emitter& emitter, Condition condition, std::uint16_t next) {
+    emitter.mov(PC, next);
+    emitter.mov(RAX, (next + 1u) & 0xFFF);
+    emitter.cmov(condition, PC, RAX);
+}
+
+} // namespace
+
+NativeCode::NativeCode(WriteHandler write_handler) : write(write_handler) {}
+
+NativeCode::~NativeCode() {
+    if (code) {
+        munmap(code, CODE_CAPACITY);
+    }
+}
+
+bool NativeCode::is_supported() {
+    return true;
+}
+
+NativeCode::Block
+NativeCode::translate(std::uint16_t address, std::span<const std::uint16_t> words) {
+    if (!code && !allocate()) {
+        return nullptr;
+    }
+    Emitter emitter(code + code_size);
+
+    // Leaves before the block when its T-states don't fit in the limit,
+    //     PC is the address already.
+    std::uint32_t block_cycles = 0;
+    for (const auto word : words) {
+        block_cycles += static_cast<std::uint32_t>(
+            Instruction::get_cycle_count(Instruction::decode(word))
+        );
+    }
+    emitter.load64(RAX, STATE, CYCLES_OFFSET);
+    emitter.op64(ADD, RAX, block_cycles);
+    emitter.cmp64(RAX, STATE, LIMIT_OFFSET);
+    emitter.jump(ABOVE, exit);
+    emitter.store64(STATE, CYCLES_OFFSET, RAX);
+
+    bool sets_pc = false;
+    std::uint32_t cycles = 0;
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        const auto ir = words[i];
+        const auto instr = Instruction::decode(ir);
+        const auto next =
+            static_cast<std::uint16_t>((address + i + 1) & 0xFFF);
+        const auto operand = static_cast<std::uint16_t>(ir & 0xFFF);
+        const bool indirect = Instruction::is_mri(instr) && (ir & 0x8000);
+        cycles += static_cast<std::uint32_t>(Instruction::get_cycle_count(instr));
+        const auto read_operand = [&] {
+            if (indirect) {
+                emit_read(emitter);
+            } else {
+                emit_read(emitter, operand);
+            }
+        };
+
+        // Fetch and decode, PC only where the block can leave.
+        emitter.mov(AR, operand);
+        if (indirect) {
+            emit_read(emitter, operand);
+            emitter.op(AND, RAX, 0xFFF);
+            emitter.mov(AR, RAX);
+        }
+
+        sets_pc = true;
+        switch (instr) {
+            case Instr::AND:
+                read_operand();
+                emitter.mov(DR, RAX);
+                emitter.op(OP_AND, AC, RAX);
+                sets_pc = false;
+                break;
+            case Instr::ADD:
+                // E is only set by the carry, never cleared.
+                read_operand();
+                emitter.mov(DR, RAX);
+                emitter.op(OP_ADD, AC, RAX);
+                emitter.mov(RCX, AC);
+                emitter.shift(SHR, RCX, 16);
+                emitter.op(OP_OR, E, RCX);
+                emitter.movzx16(AC, AC);
+                sets_pc = false;
+                break;
+            case Instr::LDA:
+                read_operand();
+                emitter.mov(DR, RAX);
+                emitter.mov(AC, RAX);
+                sets_pc = false;
+                break;
+            case Instr::STA:
+            {
+                emitter.mov(RDX, AC);
+                emit_write(emitter, write);
+                // Leaves when the write dropped a block or hit a watchpoint,
+                //     without the T-states of the rest of the block.
+                emitter.byte(0x84);
+                emitter.byte(0xC0); // test al, al
+                const auto stay = emitter.jump_short(EQUAL);
+                emitter.mov(PC, next);
+                emitter.store16(STATE, IR_OFFSET, ir);
+                if (cycles != block_cycles) {
+                    emitter.op64(
+                        SUB,
+                        STATE,
+                        CYCLES_OFFSET,
+                        block_cycles - cycles
+                    );
+                }
+                emitter.jump(exit);
+                emitter.land(stay);
+                sets_pc = false;
+                break;
+            }
+            case Instr::BUN:
+                emitter.mov(PC, AR);
+                break;
+            case Instr::BSA:
+                emitter.mov(RDX, next);
+                emit_write(emitter, write);
+                emitter.op(ADD, AR, 1);
+                emitter.op(AND, AR, 0xFFF);
+                emitter.mov(PC, AR);
+                break;
+            case Instr::ISZ:
+                read_operand();
+                emitter.op(ADD, RAX, 1);
+                emitter.movzx16(DR, RAX);
+                emitter.mov(RDX, DR);
+                emit_write(emitter, write);
+                emitter.op(OP_TEST, DR, DR);
+                emit_skip(emitter, EQUAL, next);
+                break;
+            case Instr::CLA:
+                emitter.op(OP_XOR, AC, AC);
+                sets_pc = false;
+                break;
+            case Instr::CLE:
+                emitter.op(OP_XOR, E, E);
+                sets_pc = false;
+                break;
+            case Instr::CMA:
+                emitter.op(XOR, AC, 0xFFFF);
+                sets_pc = false;
+                break;
+            case Instr::CME:
+                emitter.op(XOR, E, 1);
+                sets_pc = false;
+                break;
+            case Instr::CIR:
+                emitter.mov(RAX, AC);
+                emitter.op(AND, RAX, 1);
+                emitter.shift(SHR, AC, 1);
+                emitter.shift(SHL, E, 15);
+                emitter.op(OP_OR, AC, E);
+                emitter.mov(E, RAX);
+                sets_pc = false;
+                break;
+            case Instr::CIL:
+                emitter.mov(RAX, AC);
+                emitter.shift(SHR, RAX, 15);
+                emitter.shift(SHL, AC, 1);
+                emitter.op(OP_OR, AC, E);
+                emitter.movzx16(AC, AC);
+                emitter.mov(E, RAX);
+                sets_pc = false;
+                break;
+            case Instr::INC:
+                emitter.op(ADD, AC, 1);
+                emitter.movzx16(AC, AC);
+                sets_pc = false;
+                break;
+            case Instr::SPA:
+                emitter.bt(AC, 15);
+                emit_skip(emitter, ABOVE_OR_EQUAL, next);
+                break;
+            case Instr::SNA:
+                emitter.bt(AC, 15);
+                emit_skip(emitter, BELOW, next);
+                break;
+            case Instr::SZA:
+                emitter.op(OP_TEST, AC, AC);
+                emit_skip(emitter, EQUAL, next);
+                break;
+            case Instr::SZE:
+                emitter.op(OP_TEST, E, E);
+                emit_skip(emitter, EQUAL, next);
+                break;
+            default:
+                // HLT, the caller clears S.
+                sets_pc = false;
+                break;
+        }
+    }
+    if (!sets_pc) {
+        emitter.mov(
+            PC,
+            static_cast<std::uint32_t>((address + words.size()) & 0xFFF)
+        );
+    }
+    emitter.store16(STATE, IR_OFFSET, words.back());
+    if (Instruction::decode(words.back()) == Instr::HLT) {
+        emitter.jump(exit);
+    } else {
+        emitter.jump(dispatch);
+    }
+    return emit(emitter.bytes);
+}
+
+void NativeCode::run(State& state, Block block) {
+    state.links = links.data();
+    std::bit_cast<void (*)(State*, Block)>(code)(&state, block);
+}
+
+void NativeCode::clear() {
+    links.fill(nullptr);
+    code_size = shared_size;
+}
+
+bool NativeCode::allocate() {
+    void* arena = mmap(
+        nullptr,
+        CODE_CAPACITY,
+        PROT_READ | PROT_EXEC,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+    if (arena == MAP_FAILED) {
+        return false;
+    }
+    code = static_cast<std::uint8_t*>(arena);
+
+    // Entry, run calls it with the state and the first block. Six pushes
+    //     and the return address leave the stack 8 bytes off the alignment
+    //     the calls to the handler need.
+    Emitter entry(code);
+    for (const auto reg : SAVED) {
+        entry.push(reg);
+    }
+    entry.op64(SUB, RSP, 8);
+    entry.mov64(STATE, RDI);
+    entry.load16(AC, STATE, AC_OFFSET);
+    entry.load16(DR, STATE, DR_OFFSET);
+    entry.load16(AR, STATE, AR_OFFSET);
+    entry.load16(PC, STATE, PC_OFFSET);
+    entry.load8(E, STATE, E_OFFSET);
+    entry.jump(RSI);
+
+    // Exit, writes the registers back and returns to run.
+    const auto exit_offset = entry.bytes.size();
+    entry.store16(STATE, AC_OFFSET, AC);
+    entry.store16(STATE, DR_OFFSET, DR);
+    entry.store16(STATE, AR_OFFSET, AR);
+    entry.store16(STATE, PC_OFFSET, PC);
+    entry.mov(RDX, E);
+    entry.store8(STATE, E_OFFSET, RDX);
+    entry.op64(ADD, RSP, 8);
+    for (auto reg = std::rbegin(SAVED); reg != std::rend(SAVED); ++reg) {
+        entry.pop(*reg);
+    }
+    entry.byte(0xC3); // ret
+    exit = code + exit_offset;
+
+    // Dispatch, continues to the block linked at PC or exits.
+    dispatch = code + entry.bytes.size();
+    entry.mov(RAX, PC);
+    entry.load64(RCX, STATE, LINKS_OFFSET);
+    entry.load64(RAX, RCX, RAX);
+    entry.test64(RAX, RAX);
+    entry.jump(EQUAL, exit);
+    entry.jump(RAX);
+
+    if (!emit(entry.bytes)) {
+        munmap(code, CODE_CAPACITY);
+        code = nullptr;
+        return false;
+    }
+    shared_size = code_size;
+    return true;
+}
+
+NativeCode::Block NativeCode::emit(std::span<const std::uint8_t> bytes) {
+    if (bytes.size() > CODE_CAPACITY - code_size) {
+        return nullptr;
+    }
+    // Never writable and executable at the same time.
+    if (mprotect(code, CODE_CAPACITY, PROT_READ | PROT_WRITE) != 0) {
+        return nullptr;
+    }
+    auto* block = code + code_size;
+    std::memcpy(block, bytes.data(), bytes.size());
+    code_size += bytes.size();
+    if (mprotect(code, CODE_CAPACITY, PROT_READ | PROT_EXEC) != 0) {
+        return nullptr;
+    }
+    return block;
+}
+
+#else
+
+NativeCode::NativeCode(WriteHandler write_handler) : write(write_handler) {}
+
+NativeCode::~NativeCode() = default;
+
+bool NativeCode::is_supported() {
+    return false;
+}
+
+NativeCode::Block NativeCode::translate(
+    [[maybe_unused]] std::uint16_t address,
+    [[maybe_unused]] std::span<const std::uint16_t> words
+) {
+    static_cast<void>(write);
+    static_cast<void>(code);
+    static_cast<void>(exit);
+    static_cast<void>(dispatch);
+    return nullptr;
+}
+
+void NativeCode::run(
+    [[maybe_unused]] State& state,
+    [[maybe_unused]] Block block
+) {}
+
+void NativeCode::clear() {
+    links.fill(nullptr);
+    code_size = shared_size;
+}
+
+#endif
+
+} // namespace mano
@@ -0,0 +1,109 @@
+#include "emulator/profiler.hpp"
+
+#include <algorithm>
+
+#include "emulator/cpu.hpp"
+#include "emulator/instructions.hpp"
+
+namespace mano {
+
+void Profiler::begin(const Cpu& cpu) {
+    if (cpu.get_sequence_counter() != 0 || !cpu.start_stop) {
+        return;
+    }
+    in_instruction = true;
+    interrupt = cpu.r;
+    pc = cpu.registers.get(Registers::PC);
+    instruction_cycles = 0;
+}
+
+void Profiler::end(const Cpu& cpu, std::size_t dispatch_cycles) {
+    if (!in_instruction) {
+        return;
+    }
+    instruction_cycles += dispatch_cycles;
+    if (cpu.get_sequence_counter() != 0) {
+        return;
+    }
+    in_instruction = false;
+    total_cycles += instruction_cycles;
+
+    if (interrupt) {
+        // RT1: M[0] <- TR
+        interrupts += 1;
+        interrupt_cycles += instruction_cycles;
+        writes[0] += 1;
+        return;
+    }
+    executions[pc] += 1;
+    cycles[pc] += instruction_cycles;
+
+    const auto instruction = cpu.instruction;
+    if (!Instruction::is_mri(instruction)) {
+        return;
+    }
+    if (cpu.indirect) {
+        // D7'IT3 read the pointer from the address AR held after decode,
+        //     IR(0 ~ 11), or PC for an undefined opcode that kept AR.
+        const auto ir = cpu.registers.get(Registers::IR);
+        const auto pointer = static_cast<std::size_t>(
+            Instruction::decode(ir) != Instr::Undefined ? ir & 0xFFF : pc
+        );
+        reads[pointer] += 1;
+    }
+    // BSA leaves AR past the word it wrote.
+    const auto address = static_cast<std::uint16_t>(
+        (cpu.registers.get(Registers::AR) - (instruction == Instr::BSA))
+        & 0xFFF
+    );
+    switch (instruction) {
+        case Instr::AND:
+        case Instr::ADD:
+        case Instr::LDA:
+            reads[address] += 1;
+            break;
+        case Instr::STA:
+        case Instr::BSA:
+            writes[address] += 1;
+            break;
+        case Instr::ISZ:
+            reads[address] += 1;
+            writes[address] += 1;
+            break;
+        default:
+            break;
+    }
+}
+
+void Profiler::clear() {
+    executions.fill(0);
+    cycles.fill(0);
+    reads.fill(0);
+    writes.fill(0);
+    interrupts = 0;
+    interrupt_cycles = 0;
+    total_cycles = 0;
+    in_instruction = false;
+}
+
+std::vector<std::uint16_t> Profiler::get_hot_addresses(std::size_t count) const {
+    std::vector<std::uint16_t> addresses;
+    for (std::size_t address = 0; address < MEMORY_SIZE; ++address) {
+        if (executions[address] != 0) {
+            addresses.push_back(static_cast<std::uint16_t>(address));
+        }
+    }
+    count = std::min(count, addresses.size());
+    std::partial_sort(
+        addresses.begin(),
+        addresses.begin() + static_cast<std::ptrdiff_t>(count),
+        addresses.end(),
+        [this](std::uint16_t a, std::uint16_t b) {
+            return cycles[a] > cycles[b] || (cycles[a] == cycles[b] && a < b);
+        }
+    );
+    addresses.resize(count);
+    return addresses;
+}
+
+} // namespace mano
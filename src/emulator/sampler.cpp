@@ -0,0 +1,77 @@
+#include "emulator/sampler.hpp"
+
+#include <algorithm>
+
+#include "emulator/call_tracker.hpp"
+#include "emulator/cpu.hpp"
+
+namespace mano {
+
+Sampler::Sampler(
+    std::uint64_t sample_interval,
+    std::uint64_t sample_jitter,
+    std::uint64_t seed
+) :
+    interval(std::max<std::uint64_t>(sample_interval, 1)),
+    // Every gap is at least a T-state.
+    jitter(std::min(sample_jitter, interval - 1)),
+    random(seed != 0 ? seed : 1) {
+    next_sample = next_gap();
+}
+
+void Sampler::drain() {
+    for (; ring_count > 0; --ring_count) {
+        const auto& next = ring[ring_start];
+        ring_start = (ring_start + 1) % RING_SIZE;
+
+        report.samples += 1;
+        report.pc[next.pc % MEMORY_SIZE] += 1;
+        if (next.depth) {
+            if (report.depth.size() <= *next.depth) {
+                report.depth.resize(*next.depth + 1u);
+            }
+            report.depth[*next.depth] += 1;
+        }
+        report.ien += next.ien;
+        report.r += next.r;
+    }
+}
+
+std::vector<Sampler::Sample> Sampler::get_pending() const {
+    std::vector<Sample> pending;
+    for (std::size_t i = 0; i < ring_count; ++i) {
+        pending.push_back(ring[(ring_start + i) % RING_SIZE]);
+    }
+    return pending;
+}
+
+void Sampler::sample(const Cpu& cpu, const CallTracker* call_tracker) {
+    if (ring_count == RING_SIZE) {
+        drain();
+    }
+    auto& next = ring[(ring_start + ring_count) % RING_SIZE];
+    ring_count += 1;
+
+    next.cycle = cycles;
+    next.pc = cpu.registers.get(Registers::PC);
+    next.depth.reset();
+    if (call_tracker) {
+        next.depth =
+            static_cast<std::uint16_t>(call_tracker->get_stack().size());
+    }
+    next.ien = cpu.ien;
+    next.r = cpu.r;
+
+    // A long dispatch may pass more than one gap, the sample stands
+    //     for the first.
+    next_sample = cycles + next_gap();
+}
+
+std::uint64_t Sampler::next_gap() {
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    return interval - jitter + random % (2 * jitter + 1);
+}
+
+} // namespace mano
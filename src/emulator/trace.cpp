@@ -0,0 +1,300 @@
+#include "emulator/trace.hpp"
+
+#include <algorithm>
+
+#include "emulator/cpu.hpp"
+#include "emulator/instructions.hpp"
+
+namespace mano {
+
+using namespace trace_format;
+
+namespace {
+
+void put_varint(std::vector<std::uint8_t>& output, std::uint64_t value) {
+    while (value >= 0x80) {
+        output.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<std::uint8_t>(value));
+}
+
+// Difference of two 16 bit words, small either way.
+std::uint16_t zigzag(std::uint16_t value, std::uint16_t base) {
+    const auto delta = static_cast<std::int16_t>(value - base);
+    return static_cast<std::uint16_t>((delta << 1) ^ (delta >> 15));
+}
+
+std::uint16_t unzigzag(std::uint64_t encoded, std::uint16_t base) {
+    const auto delta = static_cast<std::uint16_t>(
+        (encoded >> 1) ^ (~(encoded & 1) + 1)
+    );
+    return static_cast<std::uint16_t>(base + delta);
+}
+
+void put_u32(std::uint8_t* output, std::uint32_t value) {
+    for (std::size_t i = 0; i < 4; ++i) {
+        output[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+}
+
+void put_u64(std::uint8_t* output, std::uint64_t value) {
+    for (std::size_t i = 0; i < 8; ++i) {
+        output[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+}
+
+std::uint64_t get_le(const std::uint8_t* input, std::size_t size) {
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        value |= static_cast<std::uint64_t>(input[i]) << (8 * i);
+    }
+    return value;
+}
+
+/*
+ * Bounds checked reads from a block.
+ * */
+struct BlockInput {
+    const std::vector<std::uint8_t>& block;
+    std::size_t& position;
+    bool failed = false;
+
+    std::uint8_t byte() {
+        if (position >= block.size()) {
+            failed = true;
+            return 0;
+        }
+        return block[position++];
+    }
+
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for (std::size_t shift = 0; shift < 64; shift += 7) {
+            const auto next = byte();
+            value |= static_cast<std::uint64_t>(next & 0x7F) << shift;
+            if (!(next & 0x80)) {
+                return value;
+            }
+        }
+        failed = true;
+        return 0;
+    }
+};
+
+} // namespace
+
+TraceRecorder::TraceRecorder(TraceSink& trace_sink) : sink(trace_sink) {
+    block.assign(std::begin(MAGIC), std::end(MAGIC));
+    sink.write(block);
+    start_block();
+}
+
+void TraceRecorder::begin(const Cpu& cpu) {
+    if (cpu.get_sequence_counter() != 0 || !cpu.start_stop) {
+        return;
+    }
+    record = TraceRecord{};
+    record.cycle = cycles;
+    record.pc = cpu.registers.get(Registers::PC);
+    record.interrupt = cpu.r;
+    in_instruction = true;
+}
+
+void TraceRecorder::end(const Cpu& cpu, std::size_t dispatch_cycles) {
+    cycles += dispatch_cycles;
+    if (!in_instruction || cpu.get_sequence_counter() != 0) {
+        return;
+    }
+    in_instruction = false;
+
+    if (!record.interrupt) {
+        record.ir = cpu.registers.get(Registers::IR);
+        if (Instruction::is_mri(cpu.instruction)) {
+            // BSA leaves AR past the word it wrote.
+            const auto ar = cpu.registers.get(Registers::AR);
+            record.address = static_cast<std::uint16_t>(
+                (ar - (cpu.instruction == Instr::BSA)) & 0xFFF
+            );
+        }
+    }
+    record.ac = cpu.registers.get(Registers::AC);
+    record.e = cpu.alu.e;
+    encode(record);
+}
+
+void TraceRecorder::flush() {
+    if (block_records == 0) {
+        return;
+    }
+    put_u32(
+        block.data(),
+        static_cast<std::uint32_t>(block.size() - BLOCK_HEADER_SIZE)
+    );
+    put_u32(block.data() + 4, block_records);
+    sink.write(block);
+    start_block();
+}
+
+void TraceRecorder::start_block() {
+    block.clear();
+    block.reserve(BLOCK_SIZE);
+    block.resize(BLOCK_HEADER_SIZE);
+    block_records = 0;
+}
+
+void TraceRecorder::encode(const TraceRecord& next) {
+    if (block_records == 0) {
+        put_u64(block.data() + 8, next.cycle);
+        previous = TraceRecord{};
+        previous.cycle = next.cycle;
+    }
+
+    std::uint8_t flags = 0;
+    if (next.interrupt) {
+        flags |= INTERRUPT;
+    }
+    if (next.e) {
+        flags |= E;
+    }
+    if (next.address) {
+        flags |= ADDRESS;
+    }
+    if (next.pc == ((previous.pc + 1) & 0xFFF)) {
+        flags |= PC_NEXT;
+    }
+    if (next.ac == previous.ac) {
+        flags |= AC_SAME;
+    }
+    if (next.write_address) {
+        flags |= WRITE;
+        if (next.write_address == next.address) {
+            flags |= WRITE_ADDRESS;
+        }
+        if (next.write_value == next.ac) {
+            flags |= WRITE_AC;
+        }
+    }
+
+    block.push_back(flags);
+    put_varint(block, next.cycle - previous.cycle);
+    if (!(flags & PC_NEXT)) {
+        put_varint(block, zigzag(next.pc, previous.pc));
+    }
+    if (!next.interrupt) {
+        block.push_back(static_cast<std::uint8_t>(next.ir));
+        block.push_back(static_cast<std::uint8_t>(next.ir >> 8));
+    }
+    if (!(flags & AC_SAME)) {
+        put_varint(block, zigzag(next.ac, previous.ac));
+    }
+    if (next.address) {
+        put_varint(block, zigzag(*next.address, next.ir & 0xFFF));
+    }
+    if ((flags & WRITE) && !(flags & WRITE_ADDRESS)) {
+        put_varint(block, *next.write_address);
+    }
+    if ((flags & WRITE) && !(flags & WRITE_AC)) {
+        put_varint(block, next.write_value);
+    }
+
+    previous = next;
+    block_records += 1;
+    record_count += 1;
+    if (block.size() + MAX_RECORD_SIZE > BLOCK_SIZE) {
+        flush();
+    }
+}
+
+TraceReader::TraceReader(std::istream& trace_input) : input(trace_input) {
+    char magic[sizeof(MAGIC)];
+    input.read(magic, sizeof(magic));
+    valid = input.gcount() == sizeof(magic)
+            && std::equal(std::begin(magic), std::end(magic), MAGIC);
+}
+
+std::optional<TraceRecord> TraceReader::next() {
+    while (block_records == 0) {
+        if (!read_block()) {
+            return {};
+        }
+    }
+
+    BlockInput in{block, position};
+    TraceRecord next;
+    const auto flags = in.byte();
+    next.interrupt = flags & INTERRUPT;
+    next.e = flags & E;
+    next.cycle = previous.cycle + in.varint();
+    next.pc = (flags & PC_NEXT)
+                  ? static_cast<std::uint16_t>((previous.pc + 1) & 0xFFF)
+                  : unzigzag(in.varint(), previous.pc);
+    if (!next.interrupt) {
+        next.ir = in.byte();
+        next.ir |= static_cast<std::uint16_t>(in.byte() << 8);
+    }
+    next.ac = (flags & AC_SAME) ? previous.ac
+                                : unzigzag(in.varint(), previous.ac);
+    if (flags & ADDRESS) {
+        next.address = unzigzag(in.varint(), next.ir & 0xFFF);
+    }
+    if (flags & WRITE) {
+        next.write_address = (flags & WRITE_ADDRESS)
+                                 ? next.address.value_or(0)
+                                 : static_cast<std::uint16_t>(in.varint());
+        next.write_value = (flags & WRITE_AC)
+                               ? next.ac
+                               : static_cast<std::uint16_t>(in.varint());
+    }
+
+    if (in.failed) {
+        // Corrupt block, stop the trace here.
+        valid = false;
+        block_records = 0;
+        return {};
+    }
+    previous = next;
+    block_records -= 1;
+    return next;
+}
+
+void TraceReader::seek(std::uint64_t offset) {
+    input.clear();
+    input.seekg(static_cast<std::streamoff>(offset));
+    block_records = 0;
+}
+
+bool TraceReader::read_block() {
+    if (!valid) {
+        return false;
+    }
+    block_offset = static_cast<std::uint64_t>(input.tellg());
+    std::uint8_t header[BLOCK_HEADER_SIZE];
+    input.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (input.gcount() != sizeof(header)) {
+        // Truncated unless the trace ends right before the block.
+        valid = input.gcount() == 0;
+        return false;
+    }
+    const auto size = get_le(header, 4);
+    if (size > TraceRecorder::BLOCK_SIZE) {
+        valid = false;
+        return false;
+    }
+    block.resize(size);
+    input.read(
+        reinterpret_cast<char*>(block.data()),
+        static_cast<std::streamsize>(size)
+    );
+    if (static_cast<std::uint64_t>(input.gcount()) != size) {
+        valid = false;
+        return false;
+    }
+    position = 0;
+    block_records = static_cast<std::uint32_t>(get_le(header + 4, 4));
+    previous = TraceRecord{};
+    previous.cycle = get_le(header + 8, 8);
+    return true;
+}
+
+} // namespace mano
@@ -0,0 +1,288 @@
+#include "emulator/trace_index.hpp"
+
+#include <algorithm>
+
+namespace mano {
+
+namespace {
+
+constexpr char INDEX_MAGIC[8] = {'M', 'A', 'N', 'O', 'I', 'D', 'X', '1'};
+constexpr std::size_t LIST_COUNT = 2 * MEMORY_SIZE;
+
+void put_u64(std::vector<std::uint8_t>& output, std::uint64_t value) {
+    for (std::size_t i = 0; i < 8; ++i) {
+        output.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+}
+
+std::uint64_t get_u64(const std::uint8_t* input) {
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < 8; ++i) {
+        value |= static_cast<std::uint64_t>(input[i]) << (8 * i);
+    }
+    return value;
+}
+
+std::optional<std::uint64_t> read_u64(std::istream& input) {
+    std::uint8_t bytes[8];
+    input.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+    if (input.gcount() != sizeof(bytes)) {
+        return {};
+    }
+    return get_u64(bytes);
+}
+
+void write_bytes(std::ostream& output, const std::vector<std::uint8_t>& bytes) {
+    output.write(
+        reinterpret_cast<const char*>(bytes.data()),
+        static_cast<std::streamsize>(bytes.size())
+    );
+}
+
+} // namespace
+
+bool TraceIndex::build(std::istream& trace, std::ostream& index) {
+    TraceReader reader(trace);
+    if (!reader.is_valid()) {
+        return false;
+    }
+
+    index.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    std::uint64_t offset = sizeof(INDEX_MAGIC);
+
+    std::vector<Chunk> blocks;
+    std::vector<List> lists(LIST_COUNT);
+    // Entries of the chunk being filled, per list.
+    std::vector<std::vector<std::uint64_t>> pending(LIST_COUNT);
+    std::vector<std::uint8_t> buffer;
+
+    const auto write_chunk = [&](std::size_t list) {
+        auto& entries = pending[list];
+        lists[list].chunks.push_back({offset, entries.front()});
+        buffer.clear();
+        for (const auto cycle : entries) {
+            put_u64(buffer, cycle);
+        }
+        write_bytes(index, buffer);
+        offset += buffer.size();
+        entries.clear();
+    };
+    const auto append = [&](std::size_t list, std::uint64_t cycle) {
+        pending[list].push_back(cycle);
+        lists[list].entry_count += 1;
+        if (pending[list].size() == CHUNK_ENTRIES) {
+            write_chunk(list);
+        }
+    };
+
+    std::optional<std::uint64_t> block_offset;
+    while (const auto record = reader.next()) {
+        if (block_offset != reader.get_block_offset()) {
+            block_offset = reader.get_block_offset();
+            blocks.push_back({*block_offset, record->cycle});
+        }
+        if (record->write_address) {
+            append(*record->write_address % MEMORY_SIZE, record->cycle);
+        }
+        if (!record->interrupt) {
+            append(MEMORY_SIZE + record->pc % MEMORY_SIZE, record->cycle);
+        }
+    }
+    if (!reader.is_valid()) {
+        return false;
+    }
+    for (std::size_t list = 0; list < LIST_COUNT; ++list) {
+        if (!pending[list].empty()) {
+            write_chunk(list);
+        }
+    }
+
+    buffer.clear();
+    put_u64(buffer, blocks.size());
+    for (const auto& block : blocks) {
+        put_u64(buffer, block.offset);
+        put_u64(buffer, block.first_cycle);
+    }
+    for (const auto& list : lists) {
+        put_u64(buffer, list.entry_count);
+        put_u64(buffer, list.chunks.size());
+        for (const auto& chunk : list.chunks) {
+            put_u64(buffer, chunk.offset);
+            put_u64(buffer, chunk.first_cycle);
+        }
+    }
+    put_u64(buffer, offset);
+    buffer.insert(buffer.end(), std::begin(INDEX_MAGIC), std::end(INDEX_MAGIC));
+    write_bytes(index, buffer);
+    index.flush();
+    return index.good();
+}
+
+TraceIndex::TraceIndex(std::istream& index_input) : input(index_input) {
+    char magic[sizeof(INDEX_MAGIC)];
+    input.read(magic, sizeof(magic));
+    if (input.gcount() != sizeof(magic)
+        || !std::equal(std::begin(magic), std::end(magic), INDEX_MAGIC)) {
+        return;
+    }
+    input.seekg(0, std::ios::end);
+    const auto size = static_cast<std::uint64_t>(input.tellg());
+    if (size < 3 * sizeof(INDEX_MAGIC)) {
+        return;
+    }
+    input.seekg(static_cast<std::streamoff>(size - 2 * sizeof(INDEX_MAGIC)));
+    const auto directory = read_u64(input);
+    if (!directory || *directory >= size) {
+        return;
+    }
+    input.seekg(static_cast<std::streamoff>(*directory));
+
+    // Every count is checked against the file size before allocating.
+    const auto read_chunks = [&](std::vector<Chunk>& chunks) {
+        const auto count = read_u64(input);
+        if (!count || *count > size / 16) {
+            return false;
+        }
+        chunks.resize(*count);
+        for (auto& chunk : chunks) {
+            const auto chunk_offset = read_u64(input);
+            const auto first_cycle = read_u64(input);
+            if (!chunk_offset || !first_cycle) {
+                return false;
+            }
+            chunk = {*chunk_offset, *first_cycle};
+        }
+        return true;
+    };
+
+    if (!read_chunks(blocks)) {
+        return;
+    }
+    for (std::size_t list = 0; list < LIST_COUNT; ++list) {
+        auto& entries = list < MEMORY_SIZE ? writes[list]
+                                           : visits[list - MEMORY_SIZE];
+        const auto entry_count = read_u64(input);
+        if (!entry_count || !read_chunks(entries.chunks)
+            || entries.chunks.size()
+                   != (*entry_count + CHUNK_ENTRIES - 1) / CHUNK_ENTRIES) {
+            return;
+        }
+        entries.entry_count = *entry_count;
+    }
+    valid = true;
+}
+
+std::optional<std::uint64_t> TraceIndex::find_last_write(
+    std::uint16_t address,
+    std::uint64_t cycle
+) {
+    const auto& list = writes[address % MEMORY_SIZE];
+    // Last chunk starting before cycle.
+    const auto chunk = std::partition_point(
+        list.chunks.begin(),
+        list.chunks.end(),
+        [&](const Chunk& next) { return next.first_cycle < cycle; }
+    );
+    if (chunk == list.chunks.begin()) {
+        return {};
+    }
+    const auto& entries = read_chunk(
+        list,
+        static_cast<std::size_t>(chunk - list.chunks.begin() - 1)
+    );
+    const auto entry = std::lower_bound(entries.begin(), entries.end(), cycle);
+    if (entry == entries.begin()) {
+        return {};
+    }
+    return *(entry - 1);
+}
+
+std::optional<std::uint64_t> TraceIndex::find_next_visit(
+    std::uint16_t address,
+    std::uint64_t cycle
+) {
+    const auto& list = visits[address % MEMORY_SIZE];
+    // First chunk starting after cycle, the visit is either in the chunk
+    //     before it or its first entry.
+    const auto chunk = std::partition_point(
+        list.chunks.begin(),
+        list.chunks.end(),
+        [&](const Chunk& next) { return next.first_cycle <= cycle; }
+    );
+    if (chunk != list.chunks.begin()) {
+        const auto& entries = read_chunk(
+            list,
+            static_cast<std::size_t>(chunk - list.chunks.begin() - 1)
+        );
+        const auto entry =
+            std::lower_bound(entries.begin(), entries.end(), cycle);
+        if (entry != entries.end()) {
+            return *entry;
+        }
+    }
+    if (chunk == list.chunks.end()) {
+        return {};
+    }
+    return chunk->first_cycle;
+}
+
+std::optional<TraceRecord> TraceIndex::read_record(
+    std::istream& trace,
+    std::uint64_t cycle
+) const {
+    const auto block = std::partition_point(
+        blocks.begin(),
+        blocks.end(),
+        [&](const Chunk& next) { return next.first_cycle <= cycle; }
+    );
+    if (block == blocks.begin()) {
+        return {};
+    }
+
+    trace.clear();
+    trace.seekg(0);
+    TraceReader reader(trace);
+    reader.seek((block - 1)->offset);
+    while (const auto record = reader.next()) {
+        if (record->cycle == cycle) {
+            return record;
+        }
+        if (record->cycle > cycle) {
+            break;
+        }
+    }
+    return {};
+}
+
+const std::vector<std::uint64_t>& TraceIndex::read_chunk(
+    const List& list,
+    std::size_t chunk
+) {
+    const auto offset = list.chunks[chunk].offset;
+    if (offset == cached_offset) {
+        return cached_entries;
+    }
+    const auto count = chunk + 1 == list.chunks.size()
+                           ? list.entry_count - chunk * CHUNK_ENTRIES
+                           : CHUNK_ENTRIES;
+
+    std::vector<std::uint8_t> bytes(static_cast<std::size_t>(count) * 8);
+    input.clear();
+    input.seekg(static_cast<std::streamoff>(offset));
+    input.read(
+        reinterpret_cast<char*>(bytes.data()),
+        static_cast<std::streamsize>(bytes.size())
+    );
+    cached_entries.clear();
+    if (static_cast<std::size_t>(input.gcount()) != bytes.size()) {
+        cached_offset = UINT64_MAX;
+        return cached_entries;
+    }
+    for (std::size_t i = 0; i < bytes.size(); i += 8) {
+        cached_entries.push_back(get_u64(bytes.data() + i));
+    }
+    cached_offset = offset;
+    return cached_entries;
+}
+
+} // namespace mano
@@ -0,0 +1,191 @@
+#include "headless/batch.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "emulator/assembler.hpp"
+
+namespace mano::headless {
+
+namespace {
+
+/*
+ * Job indices owned by one worker. The owner takes from the front,
+ * thieves take from the back so they rarely contend for the same end.
+ * */
+class JobQueue {
+  public:
+    void push(std::size_t job) {
+        std::scoped_lock lock(mutex);
+        jobs.push_back(job);
+    }
+
+    std::optional<std::size_t> pop() {
+        std::scoped_lock lock(mutex);
+        if (jobs.empty()) {
+            return {};
+        }
+        const auto job = jobs.front();
+        jobs.pop_front();
+        return job;
+    }
+
+    std::optional<std::size_t> steal() {
+        std::scoped_lock lock(mutex);
+        if (jobs.empty()) {
+            return {};
+        }
+        const auto job = jobs.back();
+        jobs.pop_back();
+        return job;
+    }
+
+  private:
+    std::mutex mutex;
+    std::deque<std::size_t> jobs;
+};
+
+} // namespace
+
+std::uint64_t memory_digest(const Memory& memory) {
+    std::uint64_t hash = 0xCBF29CE484222325;
+    for (const auto word : memory) {
+        hash = (hash ^ (word & 0xFF)) * 0x100000001B3;
+        hash = (hash ^ (word >> 8)) * 0x100000001B3;
+    }
+    return hash;
+}
+
+BatchResult run_job(const BatchJob& job) {
+    BatchResult result;
+
+    Assembler assembler;
+    auto emulator = assembler.assemble(job.code);
+    if (!emulator) {
+        for (const auto& error : assembler.get_errors()) {
+            result.errors.push_back(
+                std::to_string(error.line) + ": " + error.message
+            );
+        }
+        return result;
+    }
+    emulator->set_engine(job.options.engine);
+
+    auto run_result = run(*emulator, job.options);
+    const auto& cpu = emulator->cpu;
+    result.halted = run_result.halted;
+    result.timed_out = run_result.timed_out;
+    result.cycles = run_result.cycles;
+    result.ac = cpu.registers.get(Registers::AC);
+    result.e = cpu.alu.e;
+    result.pc = cpu.registers.get(Registers::PC);
+    result.output = std::move(run_result.output);
+    result.memory_digest = memory_digest(emulator->get_memory().get_image());
+    return result;
+}
+
+/*
+ * Calls run(index) for every index below count over the worker threads.
+ * */
+template <typename Function>
+static void
+parallel_for(std::size_t count, std::size_t thread_count, Function&& run) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    thread_count = std::min(thread_count, std::max<std::size_t>(count, 1));
+
+    std::vector<JobQueue> queues(thread_count);
+    for (std::size_t i = 0; i < count; ++i) {
+        queues[i % thread_count].push(i);
+    }
+
+    const auto worker = [&](std::size_t id) {
+        while (true) {
+            auto job = queues[id].pop();
+            for (std::size_t i = 1; !job && i < thread_count; ++i) {
+                job = queues[(id + i) % thread_count].steal();
+            }
+            if (!job) {
+                // Nothing is ever queued again, every queue is empty.
+                return;
+            }
+            run(*job);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t id = 1; id < thread_count; ++id) {
+        threads.emplace_back(worker, id);
+    }
+    worker(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+std::vector<BatchResult>
+run_batch(const std::vector<BatchJob>& jobs, std::size_t thread_count) {
+    // Each result slot is written by exactly one worker, the only
+    //     shared mutable state are the queues.
+    std::vector<BatchResult> results(jobs.size());
+    parallel_for(jobs.size(), thread_count, [&](std::size_t job) {
+        results[job] = run_job(jobs[job]);
+    });
+    return results;
+}
+
+std::vector<BatchResult> run_sweep(
+    const std::string& code,
+    const std::vector<std::string>& inputs,
+    const RunOptions& options,
+    std::size_t thread_count
+) {
+    std::vector<BatchResult> results(inputs.size());
+
+    Assembler assembler;
+    const auto emulator = assembler.assemble(code);
+    if (!emulator) {
+        for (auto& result : results) {
+            for (const auto& error : assembler.get_errors()) {
+                result.errors.push_back(
+                    std::to_string(error.line) + ": " + error.message
+                );
+            }
+        }
+        return results;
+    }
+
+    constexpr auto LANE_COUNT = LaneEngine::LANE_COUNT;
+    const auto group_count = (inputs.size() + LANE_COUNT - 1) / LANE_COUNT;
+    parallel_for(group_count, thread_count, [&](std::size_t group) {
+        const auto first = group * LANE_COUNT;
+        const auto last = std::min(inputs.size(), first + LANE_COUNT);
+        const std::vector<std::string> group_inputs(
+            inputs.begin() + static_cast<std::ptrdiff_t>(first),
+            inputs.begin() + static_cast<std::ptrdiff_t>(last)
+        );
+
+        LaneEngine engine(emulator->get_memory().get_image(), group_inputs.size());
+        auto lane_results = run_lanes(engine, group_inputs, options);
+        for (std::size_t lane = 0; lane < lane_results.size(); ++lane) {
+            auto& result = results[first + lane];
+            result.halted = lane_results[lane].halted;
+            result.timed_out = lane_results[lane].timed_out;
+            result.cycles = lane_results[lane].cycles;
+            result.ac = engine.ac[lane];
+            result.e = engine.e[lane];
+            result.pc = engine.pc[lane];
+            result.output = std::move(lane_results[lane].output);
+            result.memory_digest = memory_digest(
+                engine.get_memory(lane).get_image()
+            );
+        }
+    });
+    return results;
+}
+
+} // namespace mano::headless
@@ -0,0 +1,198 @@
+#include "headless/profile.hpp"
+
+#include <algorithm>
+#include <format>
+#include <vector>
+
+namespace mano::headless {
+
+std::string format_profile(
+    const Profiler& profiler,
+    const Assembler::LineTable& lines,
+    std::string_view code,
+    std::size_t max_lines
+) {
+    std::uint64_t instructions = 0;
+    for (const auto count : profiler.executions) {
+        instructions += count;
+    }
+    std::string report = std::format(
+        "Profile: {} instructions, {} T-states, {} interrupts\n\n",
+        instructions,
+        profiler.total_cycles,
+        profiler.interrupts
+    );
+
+    const auto source = Assembler::split_lines(code);
+    report += std::format(
+        "{:>7} {:>5} {:>12} {:>14} {:>6}  {}\n",
+        "address",
+        "line",
+        "count",
+        "T-states",
+        "%",
+        "source"
+    );
+    for (const auto address : profiler.get_hot_addresses(max_lines)) {
+        const auto line = lines[address];
+        const auto percent =
+            100.0 * static_cast<double>(profiler.cycles[address])
+            / static_cast<double>(
+                std::max<std::uint64_t>(profiler.total_cycles, 1)
+            );
+        report += std::format(
+            "    {:03x} {:>5} {:>12} {:>14} {:>6.2f}  {}\n",
+            address,
+            line != 0 ? std::to_string(line) : "-",
+            profiler.executions[address],
+            profiler.cycles[address],
+            percent,
+            line != 0 && line <= source.size() ? Assembler::trim(source[line - 1]) : ""
+        );
+    }
+
+    report += std::format(
+        "\n{:>7} {:>12} {:>12}\n",
+        "address",
+        "reads",
+        "writes"
+    );
+    for (std::size_t address = 0; address < MEMORY_SIZE; ++address) {
+        if (profiler.reads[address] != 0 || profiler.writes[address] != 0) {
+            report += std::format(
+                "    {:03x} {:>12} {:>12}\n",
+                address,
+                profiler.reads[address],
+                profiler.writes[address]
+            );
+        }
+    }
+    return report;
+}
+
+std::string format_calls(
+    const CallTracker& tracker,
+    const std::unordered_map<std::uint16_t, std::string>& labels
+) {
+    const auto& subroutines = tracker.get_subroutines();
+    std::vector<std::uint16_t> called;
+    for (std::size_t address = 0; address < MEMORY_SIZE; ++address) {
+        if (subroutines[address].calls != 0) {
+            called.push_back(static_cast<std::uint16_t>(address));
+        }
+    }
+    std::sort(
+        called.begin(),
+        called.end(),
+        [&](std::uint16_t a, std::uint16_t b) {
+            return subroutines[a].inclusive_cycles
+                   > subroutines[b].inclusive_cycles;
+        }
+    );
+
+    std::string report = std::format(
+        "{:>12} {:>12} {:>14} {:>14}\n",
+        "subroutine",
+        "calls",
+        "inclusive",
+        "exclusive"
+    );
+    const auto& root = tracker.get_root();
+    report += std::format(
+        "{:>12} {:>12} {:>14} {:>14}\n",
+        "main",
+        "-",
+        root.inclusive_cycles,
+        root.exclusive_cycles
+    );
+    for (const auto address : called) {
+        std::string name = std::format("{:03x}", address);
+        if (const auto label = labels.find(address); label != labels.end()) {
+            name = label->second;
+        } else if (address == 0) {
+            // The interrupt cycle calls through M[0].
+            name = "interrupt";
+        }
+        report += std::format(
+            "{:>12} {:>12} {:>14} {:>14}\n",
+            name,
+            subroutines[address].calls,
+            subroutines[address].inclusive_cycles,
+            subroutines[address].exclusive_cycles
+        );
+    }
+    return report;
+}
+
+std::string format_samples(
+    const Sampler::Report& samples,
+    const Assembler::LineTable& lines,
+    std::string_view code,
+    std::size_t max_lines
+) {
+    const auto total =
+        static_cast<double>(std::max<std::uint64_t>(samples.samples, 1));
+    std::string report = std::format(
+        "Samples: {}, IEN {:.2f}%, R {:.2f}%\n\n",
+        samples.samples,
+        100.0 * static_cast<double>(samples.ien) / total,
+        100.0 * static_cast<double>(samples.r) / total
+    );
+
+    std::vector<std::uint16_t> addresses;
+    for (std::size_t address = 0; address < MEMORY_SIZE; ++address) {
+        if (samples.pc[address] != 0) {
+            addresses.push_back(static_cast<std::uint16_t>(address));
+        }
+    }
+    const auto count = std::min(max_lines, addresses.size());
+    std::partial_sort(
+        addresses.begin(),
+        addresses.begin() + static_cast<std::ptrdiff_t>(count),
+        addresses.end(),
+        [&](std::uint16_t a, std::uint16_t b) {
+            return samples.pc[a] > samples.pc[b]
+                   || (samples.pc[a] == samples.pc[b] && a < b);
+        }
+    );
+    addresses.resize(count);
+
+    const auto source = Assembler::split_lines(code);
+    report += std::format(
+        "{:>7} {:>5} {:>12} {:>6}  {}\n",
+        "address",
+        "line",
+        "samples",
+        "%",
+        "source"
+    );
+    for (const auto address : addresses) {
+        const auto line = lines[address];
+        report += std::format(
+            "    {:03x} {:>5} {:>12} {:>6.2f}  {}\n",
+            address,
+            line != 0 ? std::to_string(line) : "-",
+            samples.pc[address],
+            100.0 * static_cast<double>(samples.pc[address]) / total,
+            line != 0 && line <= source.size() ? Assembler::trim(source[line - 1]) : ""
+        );
+    }
+
+    if (!samples.depth.empty()) {
+        report += std::format("\n{:>7} {:>12} {:>6}\n", "depth", "samples", "%");
+        for (std::size_t depth = 0; depth < samples.depth.size(); ++depth) {
+            if (samples.depth[depth] == 0) {
+                continue;
+            }
+            report += std::format(
+                "{:>7} {:>12} {:>6.2f}\n",
+                depth,
+                samples.depth[depth],
+                100.0 * static_cast<double>(samples.depth[depth]) / total
+            );
+        }
+    }
+    return report;
+}
+
+} // namespace mano::headless
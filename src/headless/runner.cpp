@@ -0,0 +1,200 @@
+#include "headless/runner.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#include "emulator/devices.hpp"
+
+namespace mano::headless {
+
+// How often the timeout is checked.
+static constexpr std::uint64_t TIMEOUT_CHECK_CYCLES = 1 << 20;
+
+namespace {
+
+/*
+ * Input and output device of one lane, which has no clock of its own to
+ * run Devices with.
+ * */
+struct LaneDevices {
+    std::string_view input;
+    std::size_t input_index = 0;
+    std::string output;
+
+    void service(Cpu& cpu) {
+        if (!cpu.fgi && input_index < input.size()) {
+            cpu.registers.set(
+                Registers::INPR,
+                static_cast<unsigned char>(input[input_index++])
+            );
+            cpu.fgi = true;
+        }
+        if (!cpu.fgo) {
+            if (const auto outr = cpu.registers.get(Registers::OUTR)) {
+                output += static_cast<char>(outr);
+            }
+            cpu.fgo = true;
+        }
+        cpu.io_pending = false;
+    }
+};
+
+} // namespace
+
+std::optional<Emulator::Engine> parse_engine(std::string_view name) {
+    if (name == "instruction") {
+        return Emulator::Engine::Instruction;
+    }
+    if (name == "block") {
+        return Emulator::Engine::BasicBlock;
+    }
+    if (name == "native") {
+        return Emulator::Engine::Native;
+    }
+    return {};
+}
+
+std::optional<std::string> read_source(const std::string& path) {
+    std::ifstream input(path);
+    if (!input) {
+        return {};
+    }
+    std::stringstream buffer;
+    buffer << input.rdbuf();
+
+    std::string code;
+    for (const char c : buffer.str()) {
+        if (c == '\t') {
+            code += "  ";
+        } else {
+            code += static_cast<char>(std::toupper(c));
+        }
+    }
+    return code;
+}
+
+RunResult run(Emulator& emulator, const RunOptions& options) {
+    auto& cpu = emulator.cpu;
+    Devices devices;
+    devices.input_latency = options.input_latency;
+    devices.output_latency = options.output_latency;
+    devices.set_timer_period(options.timer_period);
+    devices.output_open = options.output_open;
+    for (const char c : options.input) {
+        devices.input.push(c);
+    }
+    RunResult result;
+
+    cpu.fgo = options.output_open;
+    cpu.interrupts.mask = options.interrupt_mask;
+    cpu.interrupts.vectored = options.vector_base.has_value();
+    if (options.vector_base) {
+        cpu.interrupts.vector_base = *options.vector_base & 0xFFF;
+    }
+    devices.update(cpu);
+
+    const bool has_timeout = options.timeout.count() > 0;
+    const auto deadline = std::chrono::steady_clock::now() + options.timeout;
+    std::uint64_t next_check = TIMEOUT_CHECK_CYCLES;
+
+    while (result.cycles < options.cycle_budget && cpu.start_stop) {
+        auto slice = options.cycle_budget - result.cycles;
+        if (has_timeout) {
+            if (result.cycles >= next_check) {
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    result.timed_out = true;
+                    break;
+                }
+                next_check = result.cycles + TIMEOUT_CHECK_CYCLES;
+            }
+            slice = std::min(slice, next_check - result.cycles);
+        }
+        slice = std::min(slice, devices.get_cycles_to_event());
+        const auto cycles = emulator.run(static_cast<std::size_t>(
+            std::min<std::uint64_t>(slice, SIZE_MAX)
+        ));
+        result.cycles += cycles;
+        devices.advance(cpu, cycles);
+    }
+    result.halted = !cpu.start_stop;
+    if (result.halted) {
+        // The ports finish the characters they were moving at the halt.
+        devices.set_timer_period(0);
+        for (auto cycles = devices.get_cycles_to_event();
+             cycles != Devices::NO_EVENT;
+             cycles = devices.get_cycles_to_event()) {
+            devices.advance(cpu, cycles);
+        }
+    }
+    while (const auto character = devices.output.pop()) {
+        result.output += *character;
+    }
+    result.devices = devices.get_stats();
+    result.input_wait_cycles = Devices::get_input_wait_cycles(cpu);
+    result.output_wait_cycles = Devices::get_output_wait_cycles(cpu);
+    return result;
+}
+
+std::vector<RunResult> run_lanes(
+    LaneEngine& engine,
+    const std::vector<std::string>& inputs,
+    const RunOptions& options
+) {
+    const auto lane_count = std::min(inputs.size(), engine.get_lane_count());
+    std::vector<LaneDevices> devices(lane_count);
+    for (std::size_t lane = 0; lane < lane_count; ++lane) {
+        devices[lane].input = inputs[lane];
+        auto cpu = engine.get_cpu(lane);
+        cpu.fgo = true;
+        devices[lane].service(cpu);
+        engine.set_cpu(lane, cpu);
+    }
+
+    const bool has_timeout = options.timeout.count() > 0;
+    const auto deadline = std::chrono::steady_clock::now() + options.timeout;
+    const auto budget = options.cycle_budget;
+    std::uint64_t limit =
+        has_timeout ? std::min(budget, TIMEOUT_CHECK_CYCLES) : budget;
+    bool timed_out = false;
+
+    while (true) {
+        engine.run(limit);
+
+        bool serviced = false;
+        for (std::size_t lane = 0; lane < lane_count; ++lane) {
+            if (engine.io_pending[lane]) {
+                auto cpu = engine.get_cpu(lane);
+                devices[lane].service(cpu);
+                engine.set_cpu(lane, cpu);
+                serviced = true;
+            }
+        }
+        if (serviced) {
+            continue;
+        }
+
+        // Every lane halted or reached the limit.
+        if (limit >= budget) {
+            break;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            timed_out = true;
+            break;
+        }
+        limit = std::min(budget, limit + TIMEOUT_CHECK_CYCLES);
+    }
+
+    std::vector<RunResult> results(lane_count);
+    for (std::size_t lane = 0; lane < lane_count; ++lane) {
+        results[lane].halted = !engine.start_stop[lane];
+        results[lane].timed_out = timed_out && engine.start_stop[lane]
+                                  && engine.cycles[lane] < budget;
+        results[lane].cycles = engine.cycles[lane];
+        results[lane].output = std::move(devices[lane].output);
+    }
+    return results;
+}
+
+} // namespace mano::headless
@@ -0,0 +1,66 @@
+#include "headless/trace_file.hpp"
+
+namespace mano::headless {
+
+TraceFileWriter::TraceFileWriter(const std::string& path) :
+    output(path, std::ios::binary | std::ios::trunc) {
+    if (output.is_open()) {
+        writer = std::thread([this] { write_blocks(); });
+    }
+}
+
+TraceFileWriter::~TraceFileWriter() {
+    close();
+}
+
+void TraceFileWriter::write(std::vector<std::uint8_t>& block) {
+    std::unique_lock lock(mutex);
+    written.wait(lock, [this] { return !has_pending; });
+    if (!writer.joinable()) {
+        block.clear();
+        return;
+    }
+    // Hands back the buffer of the block written last.
+    std::swap(pending, block);
+    block.clear();
+    has_pending = true;
+    ready.notify_one();
+}
+
+bool TraceFileWriter::close() {
+    if (writer.joinable()) {
+        {
+            std::lock_guard lock(mutex);
+            closing = true;
+        }
+        ready.notify_one();
+        writer.join();
+        output.close();
+        failed = failed || output.fail();
+    }
+    return !failed;
+}
+
+void TraceFileWriter::write_blocks() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        ready.wait(lock, [this] { return has_pending || closing; });
+        if (!has_pending) {
+            return;
+        }
+        // The recorder only touches pending again after has_pending is
+        //     cleared, so it's written without the lock.
+        lock.unlock();
+        output.write(
+            reinterpret_cast<const char*>(pending.data()),
+            static_cast<std::streamsize>(pending.size())
+        );
+        const bool write_failed = output.fail();
+        lock.lock();
+        failed = failed || write_failed;
+        has_pending = false;
+        written.notify_one();
+    }
+}
+
+} // namespace mano::headless
@@ -0,0 +1,48 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "emulator/assembler.hpp"
+#include "emulator/cpp_translator.hpp"
+#include "headless/runner.hpp"
+
+/*
+ * mano-aot <input.asm> [output.cpp]
+ * Assembles the program and writes it as a standalone C++ program.
+ * */
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " <input.asm> [output.cpp]\n";
+        return 1;
+    }
+
+    const auto code = mano::headless::read_source(argv[1]);
+    if (!code) {
+        std::cerr << "Error: Could not open " << argv[1] << '\n';
+        return 1;
+    }
+
+    mano::Assembler assembler;
+    auto emulator = assembler.assemble(*code);
+    if (!emulator) {
+        for (const auto& error : assembler.get_errors()) {
+            std::cerr << argv[1] << ':' << error.line << ": " << error.message
+                      << '\n';
+        }
+        return 1;
+    }
+
+    mano::CppTranslator translator;
+    const auto source = translator.translate(emulator->get_memory().get_image());
+    if (argc == 3) {
+        std::ofstream output(argv[2]);
+        if (!output) {
+            std::cerr << "Error: Could not open " << argv[2] << '\n';
+            return 1;
+        }
+        output << source;
+    } else {
+        std::cout << source;
+    }
+    return 0;
+}
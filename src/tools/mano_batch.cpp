@@ -0,0 +1,209 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "headless/batch.hpp"
+
+static void print_usage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " [--threads N] [--cycles N] [--timeout-ms N]"
+                 " [--engine instruction|block|native] [--input TEXT]"
+                 " [--list FILE] [--sweep FILE] <input.asm>...\n";
+}
+
+static std::string json_string(std::string_view text) {
+    std::string result = "\"";
+    for (const char c : text) {
+        switch (c) {
+            case '"':
+                result += "\\\"";
+                break;
+            case '\\':
+                result += "\\\\";
+                break;
+            default:
+            {
+                // Paths and errors may hold any bytes, the ones past ASCII
+                //     are escaped as the code points of the same value.
+                const auto byte = static_cast<unsigned char>(c);
+                if (byte < 0x20 || byte >= 0x80) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", byte);
+                    result += escaped;
+                } else {
+                    result += c;
+                }
+                break;
+            }
+        }
+    }
+    return result + '"';
+}
+
+static void print_result(
+    std::string_view path,
+    std::optional<std::size_t> input,
+    const mano::headless::BatchResult& result
+) {
+    std::string line = "{\"file\":" + json_string(path);
+    if (input) {
+        line += ",\"input\":" + std::to_string(*input);
+    }
+    if (!result.errors.empty()) {
+        line += ",\"errors\":[";
+        for (std::size_t j = 0; j < result.errors.size(); ++j) {
+            line += (j != 0 ? "," : "") + json_string(result.errors[j]);
+        }
+        std::cout << line << "]}\n";
+        return;
+    }
+
+    std::string output_hex;
+    for (const char c : result.output) {
+        char hex[3];
+        std::snprintf(hex, sizeof(hex), "%02x", static_cast<unsigned char>(c));
+        output_hex += hex;
+    }
+    char fields[256];
+    std::snprintf(
+        fields,
+        sizeof(fields),
+        ",\"halted\":%s,\"timed_out\":%s,\"cycles\":%llu,"
+        "\"ac\":%u,\"e\":%d,\"pc\":%u,\"memory_digest\":\"%016llx\"",
+        result.halted ? "true" : "false",
+        result.timed_out ? "true" : "false",
+        static_cast<unsigned long long>(result.cycles),
+        result.ac,
+        result.e,
+        result.pc,
+        static_cast<unsigned long long>(result.memory_digest)
+    );
+    std::cout << line << fields << ",\"output\":\"" << output_hex << "\"}\n";
+}
+
+/*
+ * mano-batch [options] <input.asm>...
+ * Runs every program in parallel and prints one JSON object per program,
+ * in the order they were given. The output bytes are hex encoded.
+ * With --sweep each program is run once per line of the sweep file instead,
+ * as the input, on the lane engine.
+ * */
+int main(int argc, char** argv) {
+    mano::headless::RunOptions options;
+    std::size_t thread_count = 0;
+    std::vector<std::string> paths;
+    std::optional<std::vector<std::string>> sweep_inputs;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == "--threads" && has_value) {
+                thread_count = std::stoul(argv[++i]);
+            } else if (arg == "--cycles" && has_value) {
+                options.cycle_budget = std::stoull(argv[++i]);
+            } else if (arg == "--timeout-ms" && has_value) {
+                options.timeout =
+                    std::chrono::milliseconds(std::stoll(argv[++i]));
+            } else if (arg == "--engine" && has_value) {
+                const auto engine = mano::headless::parse_engine(argv[++i]);
+                if (!engine) {
+                    std::cerr << "Error: Unknown engine " << argv[i] << '\n';
+                    return 1;
+                }
+                options.engine = *engine;
+            } else if (arg == "--input" && has_value) {
+                options.input = argv[++i];
+            } else if (arg == "--list" && has_value) {
+                // One path per line.
+                std::ifstream list(argv[++i]);
+                if (!list) {
+                    std::cerr << "Error: Could not open " << argv[i] << '\n';
+                    return 1;
+                }
+                for (std::string line; std::getline(list, line);) {
+                    if (!line.empty()) {
+                        paths.push_back(line);
+                    }
+                }
+            } else if (arg == "--sweep" && has_value) {
+                std::ifstream sweep(argv[++i]);
+                if (!sweep) {
+                    std::cerr << "Error: Could not open " << argv[i] << '\n';
+                    return 1;
+                }
+                sweep_inputs.emplace();
+                for (std::string line; std::getline(sweep, line);) {
+                    sweep_inputs->push_back(line);
+                }
+            } else if (!arg.starts_with("--")) {
+                paths.emplace_back(arg);
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::invalid_argument&) {
+        print_usage(argv[0]);
+        return 1;
+    } catch (const std::out_of_range&) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (paths.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<mano::headless::BatchJob> jobs;
+    jobs.reserve(paths.size());
+    for (const auto& path : paths) {
+        auto code = mano::headless::read_source(path);
+        if (!code) {
+            std::cerr << "Error: Could not open " << path << '\n';
+            return 1;
+        }
+        jobs.push_back({std::move(*code), options});
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (sweep_inputs) {
+        std::size_t run_count = 0;
+        std::uint64_t total_cycles = 0;
+        for (std::size_t i = 0; i < jobs.size(); ++i) {
+            const auto results = mano::headless::run_sweep(
+                jobs[i].code, *sweep_inputs, options, thread_count
+            );
+            for (std::size_t input = 0; input < results.size(); ++input) {
+                total_cycles += results[input].cycles;
+                print_result(paths[i], input, results[input]);
+            }
+            run_count += results.size();
+        }
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        std::cerr << run_count << " runs, " << total_cycles << " cycles in "
+                  << elapsed.count() << " s\n";
+        return 0;
+    }
+
+    const auto results = mano::headless::run_batch(jobs, thread_count);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::uint64_t total_cycles = 0;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        total_cycles += results[i].cycles;
+        print_result(paths[i], {}, results[i]);
+    }
+
+    std::cerr << results.size() << " programs, " << total_cycles
+              << " cycles in " << elapsed.count() << " s\n";
+    return 0;
+}
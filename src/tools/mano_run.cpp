@@ -0,0 +1,351 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "emulator/assembler.hpp"
+#include "headless/profile.hpp"
+#include "headless/runner.hpp"
+#include "headless/trace_file.hpp"
+
+static void print_usage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " [--cycles N] [--engine instruction|block|native]"
+                 " [--input TEXT | --input-file FILE]"
+                 " [--input-latency N] [--output-latency N] [--timer N]"
+                 " [--no-output] [--interrupt-mask N] [--vectors ADDRESS]"
+                 " [--dump-memory]"
+                 " [--trace FILE] [--profile] [--calls] [--folded FILE]"
+                 " [--sample N]"
+                 " <input.asm>\n";
+}
+
+/*
+ * Characters the port moved, per 1000 T-states too, the T-states it was busy
+ * and the ones the program spent polling it.
+ * */
+static void print_port(
+    const char* name,
+    std::uint64_t characters,
+    std::uint64_t busy_cycles,
+    std::uint64_t wait_cycles,
+    std::uint64_t cycles
+) {
+    double wait_share = 0.0;
+    if (cycles != 0) {
+        wait_share = 100.0 * static_cast<double>(wait_cycles)
+                     / static_cast<double>(cycles);
+    }
+    std::printf(
+        "%s: %llu characters, %.3f per kilocycle, busy %llu T-states, "
+        "polled %llu T-states (%.1f%%)\n",
+        name,
+        static_cast<unsigned long long>(characters),
+        mano::Devices::get_rate(characters, cycles),
+        static_cast<unsigned long long>(busy_cycles),
+        static_cast<unsigned long long>(wait_cycles),
+        wait_share
+    );
+}
+
+/*
+ * Interrupts of the source, how long its flag waited for them and how long
+ * the service routines ran, on average and in all.
+ * */
+static void print_interrupts(
+    std::string_view name,
+    const mano::Devices::InterruptStats& stats,
+    std::uint64_t cycles
+) {
+    const auto average = [](std::uint64_t total, std::uint64_t count) {
+        return count == 0 ? 0.0
+                          : static_cast<double>(total)
+                                / static_cast<double>(count);
+    };
+    double service_share = 0.0;
+    if (cycles != 0) {
+        service_share = 100.0 * static_cast<double>(stats.service_cycles)
+                        / static_cast<double>(cycles);
+    }
+    std::printf(
+        "%.*s interrupts: %llu, latency %.1f T-states average, %llu max, "
+        "service %.1f T-states average, %llu T-states (%.1f%%)\n",
+        static_cast<int>(name.size()),
+        name.data(),
+        static_cast<unsigned long long>(stats.interrupts),
+        average(stats.latency_cycles, stats.interrupts),
+        static_cast<unsigned long long>(stats.max_latency),
+        average(stats.service_cycles, stats.services),
+        static_cast<unsigned long long>(stats.service_cycles),
+        service_share
+    );
+}
+
+/*
+ * mano-run [options] <input.asm>
+ * Assembles the program, runs it without the UI and prints the final state.
+ * */
+int main(int argc, char** argv) {
+    mano::headless::RunOptions options;
+    bool dump_memory = false;
+    bool profile = false;
+    bool calls = false;
+    const char* folded_path = nullptr;
+    const char* trace_path = nullptr;
+    std::optional<std::uint64_t> sample_interval;
+    const char* path = nullptr;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == "--cycles" && has_value) {
+                options.cycle_budget = std::stoull(argv[++i]);
+            } else if (arg == "--engine" && has_value) {
+                const auto engine = mano::headless::parse_engine(argv[++i]);
+                if (!engine) {
+                    std::cerr << "Error: Unknown engine " << argv[i] << '\n';
+                    return 1;
+                }
+                options.engine = *engine;
+            } else if (arg == "--input" && has_value) {
+                options.input = argv[++i];
+            } else if (arg == "--input-file" && has_value) {
+                std::ifstream input(argv[++i], std::ios::binary);
+                if (!input) {
+                    std::cerr << "Error: Could not open " << argv[i] << '\n';
+                    return 1;
+                }
+                std::stringstream buffer;
+                buffer << input.rdbuf();
+                options.input = buffer.str();
+            } else if (arg == "--input-latency" && has_value) {
+                options.input_latency = std::stoull(argv[++i]);
+            } else if (arg == "--output-latency" && has_value) {
+                options.output_latency = std::stoull(argv[++i]);
+            } else if (arg == "--timer" && has_value) {
+                options.timer_period = std::stoull(argv[++i]);
+            } else if (arg == "--no-output") {
+                options.output_open = false;
+            } else if (arg == "--interrupt-mask" && has_value) {
+                options.interrupt_mask = static_cast<std::uint8_t>(
+                    std::stoul(argv[++i], nullptr, 0)
+                );
+            } else if (arg == "--vectors" && has_value) {
+                options.vector_base = static_cast<std::uint16_t>(
+                    std::stoul(argv[++i], nullptr, 0)
+                );
+            } else if (arg == "--trace" && has_value) {
+                trace_path = argv[++i];
+            } else if (arg == "--profile") {
+                profile = true;
+            } else if (arg == "--calls") {
+                calls = true;
+            } else if (arg == "--folded" && has_value) {
+                folded_path = argv[++i];
+            } else if (arg == "--sample" && has_value) {
+                sample_interval = std::stoull(argv[++i]);
+            } else if (arg == "--dump-memory") {
+                dump_memory = true;
+            } else if (!arg.starts_with("--") && !path) {
+                path = argv[i];
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::invalid_argument&) {
+        print_usage(argv[0]);
+        return 1;
+    } catch (const std::out_of_range&) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!path) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const auto code = mano::headless::read_source(path);
+    if (!code) {
+        std::cerr << "Error: Could not open " << path << '\n';
+        return 1;
+    }
+
+    mano::Assembler assembler;
+    auto emulator = assembler.assemble(*code);
+    if (!emulator) {
+        for (const auto& error : assembler.get_errors()) {
+            std::cerr << path << ':' << error.line << ": " << error.message
+                      << '\n';
+        }
+        return 1;
+    }
+    emulator->set_engine(options.engine);
+    emulator->set_profiling(profile);
+    emulator->set_call_tracking(calls || folded_path);
+
+    std::unique_ptr<mano::headless::TraceFileWriter> trace_file;
+    std::unique_ptr<mano::TraceRecorder> trace;
+    if (trace_path) {
+        trace_file =
+            std::make_unique<mano::headless::TraceFileWriter>(trace_path);
+        if (!trace_file->is_open()) {
+            std::cerr << "Error: Could not open " << trace_path << '\n';
+            return 1;
+        }
+        trace = std::make_unique<mano::TraceRecorder>(*trace_file);
+        emulator->set_trace(trace.get());
+    }
+
+    std::unique_ptr<mano::Sampler> sampler;
+    if (sample_interval) {
+        sampler = std::make_unique<mano::Sampler>(
+            *sample_interval,
+            *sample_interval / 2
+        );
+        emulator->set_sampler(sampler.get());
+    }
+
+    const auto result = mano::headless::run(*emulator, options);
+
+    if (trace) {
+        emulator->set_trace(nullptr);
+        trace->flush();
+        if (!trace_file->close()) {
+            std::cerr << "Error: Could not write " << trace_path << '\n';
+            return 1;
+        }
+    }
+
+    const auto& cpu = emulator->cpu;
+    std::printf(
+        "%s after %llu cycles\n"
+        "AC: %04x E: %d PC: %03x OUTR: %02x\n",
+        result.halted ? "Halted" : "Stopped",
+        static_cast<unsigned long long>(result.cycles),
+        cpu.registers.get(mano::Registers::AC),
+        cpu.alu.e,
+        cpu.registers.get(mano::Registers::PC),
+        cpu.registers.get(mano::Registers::OUTR)
+    );
+    if (!result.output.empty()) {
+        // Printed by its size, %s would stop at a NUL.
+        std::fputs("Output: ", stdout);
+        std::fwrite(result.output.data(), 1, result.output.size(), stdout);
+        std::fputc('\n', stdout);
+    }
+    const auto& devices = result.devices;
+    if (devices.input_characters != 0 || result.input_wait_cycles != 0) {
+        print_port(
+            "Input",
+            devices.input_characters,
+            devices.input_busy_cycles,
+            result.input_wait_cycles,
+            result.cycles
+        );
+    }
+    if (devices.output_characters != 0 || result.output_wait_cycles != 0) {
+        print_port(
+            "Output",
+            devices.output_characters,
+            devices.output_busy_cycles,
+            result.output_wait_cycles,
+            result.cycles
+        );
+    }
+    if (devices.timer_ticks != 0) {
+        std::printf(
+            "Timer: %llu ticks, %llu missed\n",
+            static_cast<unsigned long long>(devices.timer_ticks),
+            static_cast<unsigned long long>(devices.missed_ticks)
+        );
+    }
+    for (std::size_t i = 0; i < devices.interrupts.size(); ++i) {
+        if (devices.interrupts[i].interrupts != 0) {
+            print_interrupts(
+                mano::InterruptController::get_name(
+                    static_cast<mano::InterruptController::Source>(i)
+                ),
+                devices.interrupts[i],
+                result.cycles
+            );
+        }
+    }
+    if (trace) {
+        std::printf(
+            "Trace: %llu instructions\n",
+            static_cast<unsigned long long>(trace->get_record_count())
+        );
+    }
+
+    if (profile) {
+        static constexpr std::size_t PROFILE_LINES = 20;
+        std::printf(
+            "\n%s",
+            mano::headless::format_profile(
+                *emulator->get_profiler(),
+                assembler.get_line_table(),
+                *code,
+                PROFILE_LINES
+            )
+                .c_str()
+        );
+    }
+
+    if (sampler) {
+        static constexpr std::size_t SAMPLE_LINES = 20;
+        sampler->drain();
+        std::printf(
+            "\n%s",
+            mano::headless::format_samples(
+                sampler->get_report(),
+                assembler.get_line_table(),
+                *code,
+                SAMPLE_LINES
+            )
+                .c_str()
+        );
+    }
+
+    if (calls) {
+        std::printf(
+            "\n%s",
+            mano::headless::format_calls(
+                *emulator->get_call_tracker(),
+                assembler.get_labels()
+            )
+                .c_str()
+        );
+    }
+    if (folded_path) {
+        std::ofstream folded(folded_path);
+        if (!folded) {
+            std::cerr << "Error: Could not open " << folded_path << '\n';
+            return 1;
+        }
+        folded << emulator->get_call_tracker()->get_folded_stacks(
+            assembler.get_labels()
+        );
+    }
+
+    if (dump_memory) {
+        const auto& memory = emulator->get_memory();
+        static constexpr std::size_t WORDS_PER_ROW = 8;
+        for (std::size_t address = 0; address < memory.size();
+             address += WORDS_PER_ROW) {
+            std::printf("%03zx:", address);
+            for (std::size_t i = 0; i < WORDS_PER_ROW; ++i) {
+                std::printf(" %04x", memory[address + i]);
+            }
+            std::printf("\n");
+        }
+    }
+    return result.halted ? 0 : 2;
+}
@@ -0,0 +1,172 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "emulator/trace.hpp"
+#include "emulator/trace_index.hpp"
+
+static void print_usage(const char* name) {
+    std::cerr << "Usage: " << name << " dump <input.trace>\n"
+              << "       " << name << " index <input.trace>\n"
+              << "       " << name
+              << " last-write <input.trace> <address> [--before CYCLE]\n"
+              << "       " << name
+              << " visits <input.trace> <address> [--from CYCLE] [--count N]\n"
+              << "Addresses are hex, the index is read from <input.trace>.idx\n";
+}
+
+static void print_record(const mano::TraceRecord& record) {
+    std::printf(
+        "%12llu %03x: ",
+        static_cast<unsigned long long>(record.cycle),
+        record.pc
+    );
+    if (record.interrupt) {
+        // The interrupt cycle doesn't fetch an instruction.
+        std::printf("----");
+    } else {
+        std::printf("%04x", record.ir);
+    }
+    std::printf(" AC: %04x E: %d", record.ac, record.e);
+    if (record.address) {
+        std::printf(" EA: %03x", *record.address);
+    }
+    if (record.write_address) {
+        std::printf(
+            " M[%03x] <- %04x",
+            *record.write_address,
+            record.write_value
+        );
+    }
+    std::printf("\n");
+}
+
+static int dump(const std::string& path, std::ifstream& input) {
+    mano::TraceReader reader(input);
+    if (!reader.is_valid()) {
+        std::cerr << "Error: " << path << " is not a trace file\n";
+        return 1;
+    }
+    while (const auto record = reader.next()) {
+        print_record(*record);
+    }
+    if (!reader.is_valid()) {
+        std::cerr << "Error: " << path << " is truncated or corrupt\n";
+        return 1;
+    }
+    return 0;
+}
+
+static int build_index(const std::string& path, std::ifstream& input) {
+    std::ofstream index(path + ".idx", std::ios::binary | std::ios::trunc);
+    if (!index) {
+        std::cerr << "Error: Could not open " << path << ".idx\n";
+        return 1;
+    }
+    if (!mano::TraceIndex::build(input, index)) {
+        std::cerr << "Error: Could not index " << path << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * mano-trace <command> <input.trace> [arguments]
+ * Prints the records of a trace written by mano-run --trace, builds its
+ * index and answers queries from the index:
+ *     last-write  the last instruction that wrote the address before a cycle,
+ *     visits      the next times the instruction at the address ran.
+ * */
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const std::string_view command = argv[1];
+    const std::string path = argv[2];
+
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        std::cerr << "Error: Could not open " << path << '\n';
+        return 1;
+    }
+    if (command == "dump" && argc == 3) {
+        return dump(path, input);
+    }
+    if (command == "index" && argc == 3) {
+        return build_index(path, input);
+    }
+    if ((command != "last-write" && command != "visits") || argc < 4) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::uint16_t address = 0;
+    std::optional<std::uint64_t> cycle;
+    std::uint64_t count = 1;
+    try {
+        address = static_cast<std::uint16_t>(
+            std::stoul(argv[3], nullptr, 16) % mano::MEMORY_SIZE
+        );
+        for (int i = 4; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == (command == "visits" ? "--from" : "--before")
+                && has_value) {
+                cycle = std::stoull(argv[++i]);
+            } else if (command == "visits" && arg == "--count"
+                       && has_value) {
+                count = std::stoull(argv[++i]);
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::invalid_argument&) {
+        print_usage(argv[0]);
+        return 1;
+    } catch (const std::out_of_range&) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::ifstream index_input(path + ".idx", std::ios::binary);
+    mano::TraceIndex index(index_input);
+    if (!index.is_valid()) {
+        std::cerr << "Error: Could not read " << path
+                  << ".idx, run the index command first\n";
+        return 1;
+    }
+
+    if (command == "last-write") {
+        const auto write =
+            index.find_last_write(address, cycle.value_or(UINT64_MAX));
+        if (!write) {
+            std::printf("M[%03x] not written\n", address);
+            return 0;
+        }
+        if (const auto record = index.read_record(input, *write)) {
+            print_record(*record);
+        }
+        return 0;
+    }
+
+    std::printf(
+        "%03x executed %llu times\n",
+        address,
+        static_cast<unsigned long long>(index.get_visit_count(address))
+    );
+    auto visit = index.find_next_visit(address, cycle.value_or(0));
+    for (std::uint64_t i = 0; i < count && visit; ++i) {
+        if (const auto record = index.read_record(input, *visit)) {
+            print_record(*record);
+        }
+        visit = index.find_next_visit(address, *visit + 1);
+    }
+    return 0;
+}
@@ -289,14 +289,13 @@ Scheme::Scheme(
     );
 }
 
-void Scheme::update(Emulator& emulator) {
-    if (emulator.bus.last_source != Bus::Selection::None
-        && emulator.bus.last_dest != Bus::Selection::None) {
-        auto& source =
-            boxes[static_cast<std::size_t>(emulator.bus.last_source)];
-        auto& dest = boxes[static_cast<std::size_t>(emulator.bus.last_dest)];
-
-        Animation animation {emulator.bus.transfer_value};
+void Scheme::update(const EmulatorThread::Snapshot& snapshot) {
+    if (snapshot.last_source != Bus::Selection::None
+        && snapshot.last_dest != Bus::Selection::None) {
+        auto& source = boxes[static_cast<std::size_t>(snapshot.last_source)];
+        auto& dest = boxes[static_cast<std::size_t>(snapshot.last_dest)];
+
+        Animation animation {snapshot.transfer_value};
         animation.set_points({
             ImVec2(source.x, source.y + source.height / 2),
             ImVec2(x + BUS_X, source.y + source.height / 2),
@@ -304,10 +303,6 @@ void Scheme::update(Emulator& emulator) {
             ImVec2(dest.x, dest.y + dest.height / 2),
         });
         animations.push_back(std::move(animation));
-
-        emulator.bus.last_dest = Bus::Selection::None;
-        emulator.bus.last_source = Bus::Selection::None;
-        emulator.bus.transfer_value = 0;
     }
     auto add_animation = [&](Registers::Id reg, std::uint16_t value) {
         Animation animation {value};
@@ -339,28 +334,28 @@ void Scheme::update(Emulator& emulator) {
         animations.push_back(std::move(animation));
     };
 
-    if (emulator.cpu.alu.a_register) {
-        add_animation(emulator.cpu.alu.a_register.value(), emulator.cpu.alu.a);
+    const auto& cpu = snapshot.cpu;
+    if (cpu.alu.a_register) {
+        add_animation(cpu.alu.a_register.value(), cpu.alu.a);
     }
-    if (emulator.cpu.alu.b_register) {
-        add_animation(emulator.cpu.alu.b_register.value(), emulator.cpu.alu.a);
+    if (cpu.alu.b_register) {
+        add_animation(cpu.alu.b_register.value(), cpu.alu.a);
     }
 
-    emulator.cpu.alu.a_register = {};
-    emulator.cpu.alu.b_register = {};
-
     old_registers = new_registers;
-    new_registers = emulator.cpu.registers;
+    new_registers = cpu.registers;
 
     old_memory_io = new_memory_io;
-    new_memory_io =
-        emulator.get_memory()[emulator.cpu.registers.get(Registers::AR)];
+    new_memory_io = snapshot.memory[cpu.registers.get(Registers::AR)];
 
     old_alu = new_alu;
-    new_alu = emulator.cpu.alu;
+    new_alu = cpu.alu;
 }
 
-void Scheme::render(Emulator& emulator) {
+void Scheme::render(EmulatorThread& emulator) {
+    using Command = EmulatorThread::Command;
+    const auto& snapshot = emulator.get_snapshot();
+
     ImGui::SetNextWindowPos(ImVec2(x, y));
     ImGui::SetNextWindowSize(ImVec2(width, height));
     ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(1.0f, 1.0f, 1.0f, 1.0f));
@@ -406,8 +401,7 @@ void Scheme::render(Emulator& emulator) {
             ImGui::PushItemWidth(40.0f);
 
             std::uint16_t mem =
-                emulator
-                    .get_memory()[emulator.cpu.registers.get(Registers::AR)];
+                snapshot.memory[snapshot.cpu.registers.get(Registers::AR)];
 
             if (new_memory_io != old_memory_io) {
                 ImGui::PushStyleColor(
@@ -424,7 +418,11 @@ void Scheme::render(Emulator& emulator) {
                     nullptr,
                     "%04X"
                 )) {
-                emulator.cpu.registers.set(i, mem);
+                emulator.send({
+                    .kind = Command::Kind::SetRegister,
+                    .address = static_cast<std::uint16_t>(i),
+                    .value = mem,
+                });
             }
 
             if (new_memory_io != old_memory_io) {
@@ -474,7 +472,8 @@ void Scheme::render(Emulator& emulator) {
                 );
             }
 
-            std::uint16_t value = emulator.cpu.registers.get(register_index);
+            std::uint16_t value =
+                snapshot.cpu.registers.get(register_index);
             std::string input_id = "##" + box.name;
 
             if (ImGui::InputScalar(
@@ -485,7 +484,11 @@ void Scheme::render(Emulator& emulator) {
                     nullptr,
                     format
                 )) {
-                emulator.cpu.registers.set(register_index, value);
+                emulator.send({
+                    .kind = Command::Kind::SetRegister,
+                    .address = static_cast<std::uint16_t>(register_index),
+                    .value = value,
+                });
             }
 
             if (old_registers.get(register_index)
@@ -511,8 +514,8 @@ void Scheme::render(Emulator& emulator) {
     char operation_str[20] = {};
     std::memcpy(
         operation_str,
-        emulator.cpu.alu.operation.data(),
-        emulator.cpu.alu.operation.size()
+        snapshot.cpu.alu.operation.data(),
+        snapshot.cpu.alu.operation.size()
     );
     ImGui::SetCursorScreenPos(ImVec2(alu.x + 5.0f, alu.y + 5.0f));
     ImGui::InputText("##op", operation_str, sizeof(operation_str));
@@ -575,7 +578,14 @@ void Scheme::render(Emulator& emulator) {
     auto& e = boxes[boxes.size() - 1];
     ImGui::SetCursorScreenPos(ImVec2(e.x + e.width - 25.0f, e.y + 5.f));
 
-    ImGui::Checkbox("##E", &emulator.cpu.alu.e);
+    bool carry = snapshot.cpu.alu.e;
+    if (ImGui::Checkbox("##E", &carry)) {
+        emulator.send({
+            .kind = Command::Kind::SetFlag,
+            .enabled = carry,
+            .flag = Condition::Flag::E,
+        });
+    }
 
     for (auto it = animations.begin(); it != animations.end();) {
         if (it - 1 != animations.end() && (it - 1)->get_render_count() < 5) {
@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <random>
+
+#include "emulator/emulator.hpp"
+#include "random_program.hpp"
+
+using namespace mano;
+
+static constexpr int PROGRAM_COUNT = 600;
+static constexpr int STEP_COUNT = 200000;
+
+/*
+ * Tracks the calls of random programs stepped one T-state at a time, and
+ * again run in random slices on every engine up to the same T-state, then
+ * compares the stacks, the totals and the folded stacks. The programs turn
+ * interrupts on, so the interrupt cycle calls too.
+ * */
+int main() {
+    std::mt19937 rng(13);
+    for (int program = 0; program < PROGRAM_COUNT; ++program) {
+        auto memory =
+            tests::random_program(rng, program % 2 ? 64 : MEMORY_SIZE);
+        memory[0x10] = 0xF080; // ION
+        Emulator stepped(memory);
+        Emulator ran(memory);
+        ran.set_engine(static_cast<Emulator::Engine>(program % 3));
+        for (auto* emulator : {&stepped, &ran}) {
+            emulator->cpu.fgo = true;
+            emulator->set_profiling(true);
+            emulator->set_call_tracking(true);
+        }
+
+        for (int step = 0; step < STEP_COUNT && stepped.cpu.start_stop;
+             ++step) {
+            stepped.cycle();
+        }
+        while (stepped.cpu.get_sequence_counter() != 0) {
+            stepped.cycle();
+        }
+        // The profiler counts the T-states the tracker saw.
+        const auto target = stepped.get_profiler()->total_cycles;
+        while (ran.get_profiler()->total_cycles < target
+               && ran.cpu.start_stop) {
+            const auto left = target - ran.get_profiler()->total_cycles;
+            ran.run(left > 8 ? 1 + rng() % (left - 7) : 1);
+        }
+
+        const auto& expected = *stepped.get_call_tracker();
+        const auto& actual = *ran.get_call_tracker();
+        if (expected.get_stack() != actual.get_stack()
+            || expected.get_subroutines() != actual.get_subroutines()
+            || expected.get_root() != actual.get_root()
+            || expected.get_folded_stacks({})
+                   != actual.get_folded_stacks({})) {
+            std::fprintf(
+                stderr,
+                "Program %d, engine %d: calls differ\n",
+                program,
+                program % 3
+            );
+            return 1;
+        }
+    }
+    return 0;
+}
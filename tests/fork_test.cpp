@@ -0,0 +1,74 @@
+#include <cstdio>
+#include <random>
+
+#include "emulator/lockstep.hpp"
+#include "random_program.hpp"
+
+using namespace mano;
+
+static constexpr int PROGRAM_COUNT = 1000;
+static constexpr std::size_t MAX_RUN_CYCLES = 5000;
+
+/*
+ * Runs a fresh emulator with the image and CPU of the machine for the
+ * T-states it ran, and compares the two.
+ * */
+static std::optional<std::string> compare_with_fresh_run(
+    const Memory& image,
+    const Cpu& cpu,
+    const Emulator& emulator,
+    std::size_t cycles
+) {
+    Emulator fresh(image);
+    fresh.cpu = cpu;
+    for (std::size_t i = 0; i < cycles; ++i) {
+        fresh.cycle();
+    }
+    return Lockstep::compare(fresh, emulator);
+}
+
+/*
+ * Forks random programs mid-run on every engine, then runs the fork and
+ * the original, and a fork of the fork, each for the same T-states. Every
+ * one of them has to match a fresh emulator started from the state at the
+ * fork, which they can't if a write leaks between them.
+ * */
+int main() {
+    std::mt19937 rng(3);
+    for (int program = 0; program < PROGRAM_COUNT; ++program) {
+        const auto engine = static_cast<Emulator::Engine>(program % 3);
+        const auto memory =
+            tests::random_program(rng, program % 2 ? 64 : MEMORY_SIZE);
+        Emulator original(memory);
+        original.set_engine(engine);
+        original.run(1 + rng() % MAX_RUN_CYCLES);
+        while (original.cpu.get_sequence_counter() != 0) {
+            original.cycle();
+        }
+
+        const auto image = original.get_memory().get_image();
+        const auto cpu = original.cpu;
+        auto fork = original.fork();
+        auto second_fork = fork.fork();
+        const auto run_cycles = 1 + rng() % MAX_RUN_CYCLES;
+
+        for (auto* emulator : {&fork, &original, &second_fork}) {
+            const auto cycles = emulator->run(run_cycles);
+            const auto difference =
+                compare_with_fresh_run(image, cpu, *emulator, cycles);
+            if (difference) {
+                std::fprintf(
+                    stderr,
+                    "Program %d, %s: %s\n",
+                    program,
+                    emulator == &fork       ? "fork"
+                    : emulator == &original ? "original"
+                                            : "fork of the fork",
+                    difference->c_str()
+                );
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "emulator/lockstep.hpp"
+#include "headless/runner.hpp"
+#include "random_program.hpp"
+
+using namespace mano;
+
+static constexpr int PROGRAM_COUNT = 3000;
+static constexpr std::size_t MAX_CYCLE_BUDGET = 30000;
+static constexpr std::size_t MAX_INPUT_SIZE = 20;
+
+/*
+ * Moves the characters right away like the lane devices of run_lanes.
+ * */
+struct LaneDevices {
+    std::string input;
+    std::size_t input_index = 0;
+    std::string output;
+
+    void service(Cpu& cpu) {
+        if (!cpu.fgi && input_index < input.size()) {
+            cpu.registers.set(
+                Registers::INPR,
+                static_cast<unsigned char>(input[input_index++])
+            );
+            cpu.fgi = true;
+        }
+        if (!cpu.fgo) {
+            if (const auto outr = cpu.registers.get(Registers::OUTR)) {
+                output += static_cast<char>(outr);
+            }
+            cpu.fgo = true;
+        }
+        cpu.io_pending = false;
+    }
+};
+
+/*
+ * Runs the program on the T-state engine one T-state at a time, with the
+ * devices serviced after every INP and OUT.
+ * */
+static headless::RunResult
+run_reference(Emulator& reference, LaneDevices& devices, std::uint64_t budget) {
+    auto& cpu = reference.cpu;
+    cpu.fgo = true;
+    devices.service(cpu);
+    headless::RunResult result;
+    while (cpu.start_stop && result.cycles < budget) {
+        do {
+            reference.cycle();
+            result.cycles += 1;
+        } while (cpu.start_stop && cpu.get_sequence_counter() != 0);
+        if (cpu.io_pending) {
+            devices.service(cpu);
+        }
+    }
+    result.halted = !cpu.start_stop;
+    result.output = devices.output;
+    return result;
+}
+
+/*
+ * Runs random programs with random inputs on up to 16 lanes and every lane
+ * again on its own on the T-state engine, then compares their state,
+ * memory, T-states and output.
+ * */
+int main() {
+    std::mt19937 rng(5);
+    for (int program = 0; program < PROGRAM_COUNT; ++program) {
+        const auto memory = tests::random_program(rng, MEMORY_SIZE);
+        std::vector<std::string> inputs(1 + rng() % LaneEngine::LANE_COUNT);
+        for (auto& input : inputs) {
+            input.resize(rng() % MAX_INPUT_SIZE);
+            for (auto& c : input) {
+                c = static_cast<char>(1 + rng() % 255);
+            }
+        }
+        headless::RunOptions options;
+        options.cycle_budget = 1 + rng() % MAX_CYCLE_BUDGET;
+
+        LaneEngine lanes(memory, inputs.size());
+        const auto results = headless::run_lanes(lanes, inputs, options);
+        for (std::size_t lane = 0; lane < inputs.size(); ++lane) {
+            Emulator reference(memory);
+            LaneDevices devices;
+            devices.input = inputs[lane];
+            const auto expected =
+                run_reference(reference, devices, options.cycle_budget);
+
+            Emulator actual(lanes.get_memory(lane).get_image());
+            actual.cpu = lanes.get_cpu(lane);
+            auto difference = Lockstep::compare(reference, actual);
+            if (!difference && expected.cycles != results[lane].cycles) {
+                difference = "T-states differ";
+            }
+            if (!difference && expected.halted != results[lane].halted) {
+                difference = "Halt differs";
+            }
+            if (!difference && expected.output != results[lane].output) {
+                difference = "Output differs";
+            }
+            if (difference) {
+                std::fprintf(
+                    stderr,
+                    "Program %d, lane %zu: %s\n",
+                    program,
+                    lane,
+                    difference->c_str()
+                );
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+#include <cstdio>
+#include <random>
+
+#include "emulator/lockstep.hpp"
+#include "random_program.hpp"
+
+using namespace mano;
+
+static constexpr int PROGRAM_COUNT = 3000;
+static constexpr std::size_t CYCLE_BUDGET = 20000;
+
+/*
+ * Runs random programs on every engine next to the T-state engine. Every
+ * other program only fills 64 words so its blocks get hot enough to be
+ * translated.
+ * */
+int main() {
+    for (const auto engine : {Emulator::Engine::Instruction,
+                              Emulator::Engine::BasicBlock,
+                              Emulator::Engine::Native}) {
+        std::mt19937 rng(11);
+        for (int program = 0; program < PROGRAM_COUNT; ++program) {
+            const auto memory =
+                tests::random_program(rng, program % 2 ? 64 : MEMORY_SIZE);
+            Lockstep lockstep(memory, engine);
+            if (const auto difference = lockstep.run(CYCLE_BUDGET)) {
+                std::fprintf(
+                    stderr,
+                    "Engine %d, program %d: %s\n",
+                    static_cast<int>(engine),
+                    program,
+                    difference->c_str()
+                );
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <random>
+
+#include "emulator/emulator.hpp"
+#include "random_program.hpp"
+
+using namespace mano;
+
+static constexpr int PROGRAM_COUNT = 600;
+static constexpr int STEP_COUNT = 200000;
+
+/*
+ * Profiles random programs stepped one T-state at a time, and again run in
+ * random slices on every engine up to the same T-state, then compares
+ * every counter. The programs turn interrupts on, so interrupt cycles are
+ * counted too.
+ * */
+int main() {
+    std::mt19937 rng(11);
+    for (int program = 0; program < PROGRAM_COUNT; ++program) {
+        auto memory =
+            tests::random_program(rng, program % 2 ? 64 : MEMORY_SIZE);
+        memory[0x10] = 0xF080; // ION
+        Emulator stepped(memory);
+        Emulator ran(memory);
+        ran.set_engine(static_cast<Emulator::Engine>(program % 3));
+        for (auto* emulator : {&stepped, &ran}) {
+            emulator->cpu.fgo = true;
+            emulator->set_profiling(true);
+        }
+
+        for (int step = 0; step < STEP_COUNT && stepped.cpu.start_stop;
+             ++step) {
+            stepped.cycle();
+        }
+        while (stepped.cpu.get_sequence_counter() != 0) {
+            stepped.cycle();
+        }
+        const auto& expected = *stepped.get_profiler();
+        const auto& actual = *ran.get_profiler();
+        // Slices end at the first instruction boundary past them, the
+        //     longest instruction takes 7 T-states.
+        while (actual.total_cycles < expected.total_cycles
+               && ran.cpu.start_stop) {
+            const auto left = expected.total_cycles - actual.total_cycles;
+            ran.run(left > 8 ? 1 + rng() % (left - 7) : 1);
+        }
+
+        if (expected.executions != actual.executions
+            || expected.cycles != actual.cycles
+            || expected.reads != actual.reads
+            || expected.writes != actual.writes
+            || expected.interrupts != actual.interrupts
+            || expected.interrupt_cycles != actual.interrupt_cycles
+            || expected.total_cycles != actual.total_cycles) {
+            std::fprintf(
+                stderr,
+                "Program %d, engine %d: counters differ\n",
+                program,
+                program % 3
+            );
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef MANO_TESTS_RANDOM_PROGRAM_HPP
+#define MANO_TESTS_RANDOM_PROGRAM_HPP
+
+#include <cstdint>
+#include <random>
+
+#include "emulator/memory.hpp"
+
+namespace mano::tests {
+
+/*
+ * Random memory image for the differential tests. A quarter of the words
+ * are random, a quarter register or I/O instructions and the rest memory
+ * reference instructions with their operands in the first span words, so
+ * small spans loop, call and write over their own code often.
+ * */
+inline Memory random_program(std::mt19937& rng, std::size_t span) {
+    static constexpr std::uint16_t NON_MEMORY[] = {
+        0x7800, 0x7400, 0x7200, 0x7100, 0x7080, 0x7040,
+        0x7020, 0x7010, 0x7008, 0x7004, 0x7002, 0x7001,
+        0xF800, 0xF400, 0xF200, 0xF100, 0xF080, 0xF040,
+    };
+    Memory memory{};
+    for (std::size_t address = 0; address < span; ++address) {
+        switch (rng() % 4) {
+            case 0:
+                memory[address] = static_cast<std::uint16_t>(rng());
+                break;
+            case 1:
+                memory[address] = NON_MEMORY[rng() % std::size(NON_MEMORY)];
+                break;
+            default:
+                memory[address] = static_cast<std::uint16_t>(
+                    ((rng() & 1) << 15) | ((rng() % 7) << 12) | (rng() % span)
+                );
+                break;
+        }
+    }
+    return memory;
+}
+
+} // namespace mano::tests
+
+#endif
@@ -0,0 +1,94 @@
+#include <cstdio>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "emulator/lockstep.hpp"
+#include "random_program.hpp"
+
+using namespace mano;
+
+static constexpr int PROGRAM_COUNT = 300;
+static constexpr int STEP_COUNT = 2000;
+static constexpr std::size_t MAX_RUN_CYCLES = 50;
+
+/*
+ * Takes random T-state, instruction and run steps through random programs
+ * on every engine with the journal on, with the device flags changed
+ * between some of them, and forks the machine before every step. Then
+ * steps back to the start, and after every reverse_step the machine has to
+ * match the fork taken before the step it undid.
+ * */
+int main() {
+    std::mt19937 rng(9);
+    for (int program = 0; program < PROGRAM_COUNT; ++program) {
+        const auto memory =
+            tests::random_program(rng, program % 2 ? 64 : MEMORY_SIZE);
+        Emulator emulator(memory);
+        emulator.set_engine(static_cast<Emulator::Engine>(program % 3));
+        emulator.set_journal(true);
+
+        std::vector<Emulator> forks;
+        std::vector<std::string_view> cycle_names;
+        for (int step = 0; step < STEP_COUNT; ++step) {
+            if (rng() % 7 == 0) {
+                emulator.cpu.fgi = true;
+                emulator.cpu.registers.set(Registers::INPR, rng() & 0xFF);
+            }
+            if (rng() % 9 == 0) {
+                emulator.cpu.fgo = true;
+            }
+            forks.push_back(emulator.fork());
+            cycle_names.push_back(emulator.cpu.get_cycle_name());
+
+            // Whole instructions only start at an instruction boundary.
+            const auto kind =
+                emulator.cpu.get_sequence_counter() == 0 ? rng() % 3 : 0;
+            if (kind == 0) {
+                emulator.cycle();
+            } else if (kind == 1) {
+                emulator.step_instruction();
+            } else if (emulator.run(1 + rng() % MAX_RUN_CYCLES) == 0) {
+                // Halted, nothing was recorded.
+                forks.pop_back();
+                cycle_names.pop_back();
+            }
+        }
+
+        for (auto step = forks.size(); step-- > 0;) {
+            if (emulator.reverse_step() == 0) {
+                std::fprintf(
+                    stderr,
+                    "Program %d, step %zu: journal empty\n",
+                    program,
+                    step
+                );
+                return 1;
+            }
+            auto difference = Lockstep::compare(forks[step], emulator);
+            if (!difference
+                && cycle_names[step] != emulator.cpu.get_cycle_name()) {
+                difference = "Cycle name differs";
+            }
+            if (!difference
+                && forks[step].cpu.io_pending != emulator.cpu.io_pending) {
+                difference = "io_pending differs";
+            }
+            if (difference) {
+                std::fprintf(
+                    stderr,
+                    "Program %d, step %zu: %s\n",
+                    program,
+                    step,
+                    difference->c_str()
+                );
+                return 1;
+            }
+        }
+        if (emulator.reverse_step() != 0) {
+            std::fprintf(stderr, "Program %d: journal not empty\n", program);
+            return 1;
+        }
+    }
+    return 0;
+}
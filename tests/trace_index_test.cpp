@@ -0,0 +1,128 @@
+#include <array>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "emulator/emulator.hpp"
+#include "emulator/trace_index.hpp"
+#include "random_program.hpp"
+
+using namespace mano;
+
+static constexpr int PROGRAM_COUNT = 40;
+static constexpr std::size_t RUN_CYCLES = 3000000;
+static constexpr int QUERY_COUNT = 3000;
+
+/*
+ * Keeps the whole trace in memory.
+ * */
+struct StringSink : TraceSink {
+    std::string data;
+
+    void write(std::vector<std::uint8_t>& block) override {
+        data.append(block.begin(), block.end());
+        block.clear();
+    }
+};
+
+/*
+ * Traces random programs, indexes the traces and answers random queries
+ * from the index and from the records a TraceReader scans out of the trace.
+ * A third of the queries start right at a visit, the edge of both searches.
+ * */
+int main() {
+    std::mt19937 rng(7);
+    for (int program = 0; program < PROGRAM_COUNT; ++program) {
+        const auto memory =
+            tests::random_program(rng, program % 2 ? 64 : MEMORY_SIZE);
+        Emulator emulator(memory);
+        emulator.cpu.fgo = true;
+        StringSink sink;
+        TraceRecorder recorder(sink);
+        emulator.set_trace(&recorder);
+        emulator.run(RUN_CYCLES);
+        recorder.flush();
+
+        std::istringstream trace(sink.data);
+        std::stringstream index_stream;
+        if (!TraceIndex::build(trace, index_stream)) {
+            std::fprintf(stderr, "Program %d: build failed\n", program);
+            return 1;
+        }
+        TraceIndex index(index_stream);
+        if (!index.is_valid()) {
+            std::fprintf(stderr, "Program %d: index invalid\n", program);
+            return 1;
+        }
+
+        // Cycles of the writes and visits of every address, in order.
+        std::array<std::vector<std::uint64_t>, MEMORY_SIZE> writes;
+        std::array<std::vector<std::uint64_t>, MEMORY_SIZE> visits;
+        std::map<std::uint64_t, TraceRecord> records;
+        std::istringstream scan_input(sink.data);
+        TraceReader reader(scan_input);
+        while (const auto record = reader.next()) {
+            if (record->write_address) {
+                writes[*record->write_address].push_back(record->cycle);
+            }
+            if (!record->interrupt) {
+                visits[record->pc].push_back(record->cycle);
+            }
+            records[record->cycle] = *record;
+        }
+        if (records.empty()) {
+            continue;
+        }
+
+        const auto cycle_end = records.rbegin()->first + 10;
+        for (int query = 0; query < QUERY_COUNT; ++query) {
+            const auto address =
+                static_cast<std::uint16_t>(rng() % MEMORY_SIZE);
+            const auto& address_writes = writes[address];
+            const auto& address_visits = visits[address];
+            auto cycle = rng() % cycle_end;
+            if (query % 3 == 0 && !address_visits.empty()) {
+                cycle = address_visits[rng() % address_visits.size()];
+            }
+
+            std::optional<std::uint64_t> last_write;
+            for (const auto write : address_writes) {
+                if (write < cycle) {
+                    last_write = write;
+                }
+            }
+            std::optional<std::uint64_t> next_visit;
+            for (const auto visit : address_visits) {
+                if (visit >= cycle) {
+                    next_visit = visit;
+                    break;
+                }
+            }
+
+            const auto found_visit = index.find_next_visit(address, cycle);
+            bool matches = index.find_last_write(address, cycle) == last_write
+                           && found_visit == next_visit
+                           && index.get_write_count(address)
+                                  == address_writes.size()
+                           && index.get_visit_count(address)
+                                  == address_visits.size();
+            if (matches && found_visit) {
+                const auto record = index.read_record(trace, *found_visit);
+                matches = record && *record == records[*found_visit];
+            }
+            if (!matches) {
+                std::fprintf(
+                    stderr,
+                    "Program %d: query at %03x, cycle %llu differs\n",
+                    program,
+                    address,
+                    static_cast<unsigned long long>(cycle)
+                );
+                return 1;
+            }
+        }
+    }
+    return 0;
+}